@@ -0,0 +1,300 @@
+#include "batch_report.h"
+
+#include "absl/strings/str_format.h"
+#include "parallel.h"
+#include "utils.h"
+#include "wave_stats.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+namespace sv {
+namespace {
+
+// Number of distinct waves loaded at once. Large enough for the wave file reader to be efficient,
+// small enough to keep all worker threads busy.
+constexpr int kBatchSize = 1024;
+
+std::string ScopePath(const WaveData::SignalScope *scope) {
+  std::string path = scope->name;
+  for (scope = scope->parent; scope != nullptr; scope = scope->parent) {
+    path = absl::StrFormat("%s.%s", scope->name, path);
+  }
+  return path;
+}
+
+// Generalization of ForEachSignalSamples over several wave files. Each row holds one signal of
+// every wave file, stored flat so that rows[row * waves.size() + i] is a signal of waves[i], and
+// fn(row, samples) gets the samples in the same order.
+void ForEachRowSamples(
+    const std::vector<const WaveData *> &waves, const std::vector<const WaveData::Signal *> &rows,
+    uint64_t start_time, uint64_t end_time, size_t memory_budget,
+    const std::function<void(int row, std::span<const std::span<const WaveData::Sample>>)> &fn) {
+  const int num_waves = waves.size();
+  const size_t num_rows = rows.size() / num_waves;
+  struct Batch {
+    size_t first_row = 0;
+    size_t num_rows = 0;
+    // For each row and wave file, the index of its samples below. Aliases share them.
+    std::vector<int> slots;
+    std::vector<std::span<const WaveData::Sample>> samples;
+    // Samples taken out of the wave data, which the spans above may point into.
+    std::vector<std::vector<WaveData::Sample>> owned;
+    size_t bytes = 0;
+  };
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t pending_bytes = 0;
+  WorkerPool pool;
+  for (size_t batch_start = 0; batch_start < num_rows; batch_start += kBatchSize) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [&] { return pending_bytes < memory_budget; });
+    }
+    auto batch = std::make_shared<Batch>();
+    batch->first_row = batch_start;
+    batch->num_rows = std::min(num_rows, batch_start + kBatchSize) - batch_start;
+    batch->slots.resize(batch->num_rows * num_waves);
+    batch->owned.reserve(batch->slots.size());
+    for (int w = 0; w < num_waves; ++w) {
+      absl::flat_hash_map<uint32_t, int> slot_by_id;
+      std::vector<const WaveData::Signal *> to_load;
+      std::vector<bool> resident;
+      for (size_t r = 0; r < batch->num_rows; ++r) {
+        const WaveData::Signal *signal = rows[(batch_start + r) * num_waves + w];
+        auto [it, inserted] =
+            slot_by_id.try_emplace(signal->id, batch->samples.size() + to_load.size());
+        if (inserted) {
+          to_load.push_back(signal);
+          resident.push_back(waves[w]->SamplesValid(signal, start_time, end_time));
+        }
+        batch->slots[r * num_waves + w] = it->second;
+      }
+      waves[w]->LoadSignalSamples(to_load, start_time, end_time);
+      for (int i = 0; i < to_load.size(); ++i) {
+        // Samples that something else loaded over the range are left alone. Further loads don't
+        // touch them. Others are replaced, and loaded again by their users when needed.
+        if (resident[i]) {
+          batch->samples.push_back(waves[w]->Wave(to_load[i]));
+        } else {
+          batch->owned.push_back(waves[w]->TakeSamples(to_load[i]));
+          batch->bytes += WaveData::SampleBytes(batch->owned.back());
+          batch->samples.push_back(batch->owned.back());
+        }
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending_bytes += batch->bytes;
+    }
+    pool.Submit([&, batch, num_waves] {
+      std::vector<std::span<const WaveData::Sample>> row_samples(num_waves);
+      for (size_t r = 0; r < batch->num_rows; ++r) {
+        for (int w = 0; w < num_waves; ++w) {
+          row_samples[w] = batch->samples[batch->slots[r * num_waves + w]];
+        }
+        fn(batch->first_row + r, row_samples);
+      }
+      batch->owned.clear();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending_bytes -= batch->bytes;
+      }
+      cv.notify_all();
+    });
+  }
+  pool.Wait();
+}
+
+} // namespace
+
+std::vector<const WaveData::Signal *> AllSignals(const WaveData &waves) {
+  std::vector<const WaveData::Signal *> signals;
+  std::vector<const WaveData::SignalScope *> stack;
+  for (const auto &root : waves.Roots()) {
+    stack.push_back(&root);
+  }
+  while (!stack.empty()) {
+    const WaveData::SignalScope *scope = stack.back();
+    stack.pop_back();
+    waves.LoadScope(scope);
+    for (const auto &signal : scope->signals) {
+      signals.push_back(&signal);
+    }
+    for (const auto &child : scope->children) {
+      stack.push_back(&child);
+    }
+  }
+  return signals;
+}
+
+std::vector<const WaveData::Signal *> LoadedSignals(const WaveData &waves) {
+  std::vector<const WaveData::Signal *> signals;
+  std::vector<const WaveData::SignalScope *> stack;
+  for (const auto &root : waves.Roots()) {
+    stack.push_back(&root);
+  }
+  while (!stack.empty()) {
+    const WaveData::SignalScope *scope = stack.back();
+    stack.pop_back();
+    if (!scope->loaded) continue;
+    for (const auto &signal : scope->signals) {
+      signals.push_back(&signal);
+    }
+    for (const auto &child : scope->children) {
+      stack.push_back(&child);
+    }
+  }
+  return signals;
+}
+
+void ForEachSignalSamples(
+    const WaveData &waves, const std::vector<const WaveData::Signal *> &signals,
+    uint64_t start_time, uint64_t end_time, size_t memory_budget,
+    const std::function<void(int idx, std::span<const WaveData::Sample> samples)> &fn) {
+  // Aliases only need to be loaded once, so each row is a distinct ID.
+  absl::flat_hash_map<uint32_t, int> row_by_id;
+  std::vector<const WaveData::Signal *> rows;
+  std::vector<std::vector<int>> row_indices;
+  for (int i = 0; i < signals.size(); ++i) {
+    auto [it, inserted] = row_by_id.try_emplace(signals[i]->id, rows.size());
+    if (inserted) {
+      rows.push_back(signals[i]);
+      row_indices.emplace_back();
+    }
+    row_indices[it->second].push_back(i);
+  }
+  ForEachRowSamples({&waves}, rows, start_time, end_time, memory_budget,
+                    [&](int row, std::span<const std::span<const WaveData::Sample>> samples) {
+                      for (const int idx : row_indices[row]) {
+                        fn(idx, samples[0]);
+                      }
+                    });
+}
+
+ActivityReport ComputeActivity(const WaveData &waves,
+                               const std::vector<const WaveData::Signal *> &signals,
+                               uint64_t start_time, uint64_t end_time, size_t memory_budget) {
+  ActivityReport report;
+  report.start_time = start_time;
+  report.end_time = end_time;
+  // Each worker writes its own elements.
+  std::vector<uint64_t> toggles(signals.size());
+  ForEachSignalSamples(waves, signals, start_time, end_time, memory_budget,
+                       [&](int idx, std::span<const WaveData::Sample> samples) {
+                         toggles[idx] = CountToggles(samples, start_time, end_time);
+                       });
+  report.signals.reserve(signals.size());
+  for (int i = 0; i < signals.size(); ++i) {
+    report.signals.push_back({.signal = signals[i], .toggles = toggles[i]});
+    for (auto *scope = signals[i]->scope; scope != nullptr; scope = scope->parent) {
+      ActivityReport::ScopeActivity &activity = report.scopes[scope];
+      activity.toggles += toggles[i];
+      activity.num_signals++;
+      if (toggles[i] == 0) activity.num_idle++;
+    }
+  }
+  return report;
+}
+
+absl::StatusOr<WaveDiff> DiffWaves(const WaveData &waves, const WaveData &golden,
+                                   uint64_t start_time, uint64_t end_time, size_t memory_budget) {
+  if (waves.Log10TimeUnits() != golden.Log10TimeUnits()) {
+    return absl::InvalidArgumentError("Golden waves have different time units");
+  }
+  absl::flat_hash_map<std::string, const WaveData::Signal *> golden_by_path;
+  for (const WaveData::Signal *signal : AllSignals(golden)) {
+    golden_by_path[WaveData::SignalToPath(signal)] = signal;
+  }
+  WaveDiff diff;
+  // Rows of signal pairs, compared signal first.
+  std::vector<const WaveData::Signal *> rows;
+  for (const WaveData::Signal *signal : AllSignals(waves)) {
+    const auto it = golden_by_path.find(WaveData::SignalToPath(signal));
+    if (it == golden_by_path.end()) {
+      diff.num_only_compared++;
+      continue;
+    }
+    rows.push_back(signal);
+    rows.push_back(it->second);
+  }
+  diff.num_compared = rows.size() / 2;
+  diff.num_only_golden = golden_by_path.size() - diff.num_compared;
+  // Each worker writes its own elements.
+  std::vector<std::optional<uint64_t>> first_difference(diff.num_compared);
+  ForEachRowSamples({&waves, &golden}, rows, start_time, end_time, memory_budget,
+                    [&](int row, std::span<const std::span<const WaveData::Sample>> samples) {
+                      first_difference[row] =
+                          FirstDifference(samples[0], samples[1], start_time, end_time);
+                    });
+  for (int i = 0; i < diff.num_compared; ++i) {
+    if (first_difference[i]) diff.mismatches.push_back({rows[2 * i], *first_difference[i]});
+  }
+  std::stable_sort(diff.mismatches.begin(), diff.mismatches.end(),
+                   [](const auto &a, const auto &b) { return a.time < b.time; });
+  return diff;
+}
+
+void WriteActivityReport(const ActivityReport &report, std::ostream &os) {
+  std::vector<std::pair<std::string, ActivityReport::ScopeActivity>> scopes;
+  for (const auto &[scope, activity] : report.scopes) {
+    scopes.push_back({ScopePath(scope), activity});
+  }
+  std::sort(scopes.begin(), scopes.end(), [](const auto &a, const auto &b) {
+    return a.second.toggles != b.second.toggles ? a.second.toggles > b.second.toggles
+                                                : a.first < b.first;
+  });
+  std::vector<std::pair<std::string, uint64_t>> signals;
+  int num_idle = 0;
+  for (const auto &s : report.signals) {
+    signals.push_back({WaveData::SignalToPath(s.signal), s.toggles});
+    if (s.toggles == 0) num_idle++;
+  }
+  std::sort(signals.begin(), signals.end(), [](const auto &a, const auto &b) {
+    return a.second != b.second ? a.second > b.second : a.first < b.first;
+  });
+
+  os << absl::StrFormat("Activity from %d to %d: %s signals, %s without any toggles\n\n",
+                        report.start_time, report.end_time, AddDigitSeparators(signals.size()),
+                        AddDigitSeparators(num_idle));
+  os << "Scopes, including everything below them:\n";
+  os << absl::StrFormat("%16s %10s %10s  %s\n", "toggles", "signals", "idle", "scope");
+  for (const auto &[path, activity] : scopes) {
+    os << absl::StrFormat("%16s %10s %10s  %s\n", AddDigitSeparators(activity.toggles),
+                          AddDigitSeparators(activity.num_signals),
+                          AddDigitSeparators(activity.num_idle), path);
+  }
+  os << "\nSignals:\n";
+  os << absl::StrFormat("%16s  %s\n", "toggles", "signal");
+  for (const auto &[path, toggles] : signals) {
+    os << absl::StrFormat("%16s  %s\n", AddDigitSeparators(toggles), path);
+  }
+}
+
+int RunActivityReport(const WaveData &waves, const ReportOptions &options) {
+  const auto [first_time, last_time] = waves.TimeRange();
+  const uint64_t start_time = options.start_time.value_or(first_time);
+  const uint64_t end_time = options.end_time.value_or(last_time);
+  PhaseTimer timer;
+  const ActivityReport report =
+      ComputeActivity(waves, AllSignals(waves), start_time, end_time, options.memory_budget);
+  timer.Finish("counting");
+  std::ofstream file;
+  if (options.output_file != "-") {
+    file.open(options.output_file);
+    if (!file.is_open()) {
+      std::cout << "Cannot write " << options.output_file << "\n";
+      return -1;
+    }
+  }
+  WriteActivityReport(report, options.output_file == "-" ? std::cout : file);
+  timer.Finish("writing");
+  std::cerr << "Activity report: " << timer.Report() << "\n";
+  return 0;
+}
+
+} // namespace sv
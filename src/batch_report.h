@@ -0,0 +1,87 @@
+#pragma once
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "wave_data.h"
+
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace sv {
+
+// Options for reports that run without the UI, given on the command line.
+struct ReportOptions {
+  // Where the report goes, "-" for stdout.
+  std::string output_file;
+  // Time window, defaulting to the whole wave.
+  std::optional<uint64_t> start_time;
+  std::optional<uint64_t> end_time;
+  // Upper bound for sample memory that is loaded but not processed yet.
+  size_t memory_budget = size_t{2} << 30;
+};
+
+// All signals in the hierarchy, reading any scopes that were not loaded yet.
+std::vector<const WaveData::Signal *> AllSignals(const WaveData &waves);
+// Signals in the scopes that were read already, without reading any more.
+std::vector<const WaveData::Signal *> LoadedSignals(const WaveData &waves);
+
+// Loads the samples of many signals in batches on the calling thread, and calls fn(index, samples)
+// for each of them on a pool of worker threads. Aliased signals share one load. Samples that were
+// not loaded already over the whole time range are dropped after use, and no more batches are
+// loaded while more than memory_budget bytes wait to be processed.
+void ForEachSignalSamples(
+    const WaveData &waves, const std::vector<const WaveData::Signal *> &signals,
+    uint64_t start_time, uint64_t end_time, size_t memory_budget,
+    const std::function<void(int idx, std::span<const WaveData::Sample> samples)> &fn);
+
+// Number of value changes of every signal, rolled up per scope, to find dead logic and hot spots.
+struct ActivityReport {
+  uint64_t start_time = 0;
+  uint64_t end_time = 0;
+  struct SignalActivity {
+    const WaveData::Signal *signal;
+    uint64_t toggles;
+  };
+  std::vector<SignalActivity> signals;
+  // Totals of a scope, including all scopes below it.
+  struct ScopeActivity {
+    uint64_t toggles = 0;
+    int num_signals = 0;
+    int num_idle = 0;
+  };
+  absl::flat_hash_map<const WaveData::SignalScope *, ScopeActivity> scopes;
+};
+ActivityReport ComputeActivity(const WaveData &waves,
+                               const std::vector<const WaveData::Signal *> &signals,
+                               uint64_t start_time, uint64_t end_time, size_t memory_budget);
+// Sorted tables of scopes and signals, most active first.
+void WriteActivityReport(const ActivityReport &report, std::ostream &os);
+
+// Comparison of a wave file against a golden one, with signals matched by hierarchical path.
+struct WaveDiff {
+  struct Mismatch {
+    // Signal of the compared waves, not the golden ones.
+    const WaveData::Signal *signal;
+    uint64_t time;
+  };
+  // Earliest first divergence first.
+  std::vector<Mismatch> mismatches;
+  int num_compared = 0;
+  // Signals present in just one of the two files.
+  int num_only_compared = 0;
+  int num_only_golden = 0;
+};
+// Finds the first divergence of every signal in [start_time, end_time], loading both files in
+// batches like ForEachSignalSamples. Both files need the same time units.
+absl::StatusOr<WaveDiff> DiffWaves(const WaveData &waves, const WaveData &golden,
+                                   uint64_t start_time, uint64_t end_time, size_t memory_budget);
+
+// Runs the activity report for the --activity-report command line option. Returns the process
+// exit code.
+int RunActivityReport(const WaveData &waves, const ReportOptions &options);
+
+} // namespace sv
@@ -0,0 +1,175 @@
+#include "fst_hier_buffer.h"
+#include "external/libfst/src/lz4.h"
+
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+
+namespace sv {
+namespace {
+
+uint64_t ReadBigEndian64(std::istream &in) {
+  unsigned char bytes[8];
+  if (!in.read(reinterpret_cast<char *>(bytes), sizeof(bytes))) return 0;
+  uint64_t val = 0;
+  for (unsigned char b : bytes) {
+    val = (val << 8) | b;
+  }
+  return val;
+}
+
+// Varint used by FST: 7 bits at a time, least significant group first.
+uint64_t DecodeVarint(const std::string &data, size_t *pos) {
+  uint64_t val = 0;
+  int shift = 0;
+  while (*pos < data.size()) {
+    const unsigned char b = data[(*pos)++];
+    val |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if ((b & 0x80) == 0) break;
+    shift += 7;
+  }
+  return val;
+}
+
+bool Inflate(const std::string &compressed, std::string *out) {
+  z_stream stream = {};
+  // 32 added to the window bits enables automatic detection of the gzip header.
+  if (inflateInit2(&stream, 15 + 32) != Z_OK) return false;
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+  stream.avail_in = compressed.size();
+  stream.next_out = reinterpret_cast<Bytef *>(out->data());
+  stream.avail_out = out->size();
+  const int result = inflate(&stream, Z_FINISH);
+  inflateEnd(&stream);
+  return result == Z_STREAM_END && stream.avail_out == 0;
+}
+
+bool Lz4Decompress(const char *src, size_t src_size, std::string *out) {
+  const int size = LZ4_decompress_safe(src, out->data(), src_size, out->size());
+  return size == out->size();
+}
+
+} // namespace
+
+std::optional<FstHierBuffer> FstHierBuffer::Read(const std::string &file_name) {
+  std::ifstream in(file_name, std::ios::binary);
+  if (!in) return std::nullopt;
+  in.seekg(0, std::ios::end);
+  const uint64_t file_size = in.tellg();
+  // Each block is a type byte and a section length, where the length includes itself. The
+  // hierarchy is usually at the end, but walking the headers is cheap.
+  uint64_t pos = 0;
+  while (pos + 9 <= file_size) {
+    in.seekg(pos);
+    const int block_type = in.get();
+    const uint64_t section_length = ReadBigEndian64(in);
+    if (!in || section_length < 8) return std::nullopt;
+    switch (block_type) {
+    case FST_BL_ZWRAPPER: return std::nullopt;
+    case FST_BL_HIER:
+    case FST_BL_HIER_LZ4:
+    case FST_BL_HIER_LZ4DUO: {
+      if (section_length < 16) return std::nullopt;
+      const uint64_t uncompressed_length = ReadBigEndian64(in);
+      std::string compressed(section_length - 16, '\0');
+      if (!in.read(compressed.data(), compressed.size())) return std::nullopt;
+      std::string data(uncompressed_length, '\0');
+      bool ok = false;
+      if (block_type == FST_BL_HIER) {
+        ok = Inflate(compressed, &data);
+      } else if (block_type == FST_BL_HIER_LZ4) {
+        ok = Lz4Decompress(compressed.data(), compressed.size(), &data);
+      } else {
+        // Compressed twice, with the intermediate length stored up front.
+        size_t offset = 0;
+        std::string intermediate(DecodeVarint(compressed, &offset), '\0');
+        ok = Lz4Decompress(compressed.data() + offset, compressed.size() - offset,
+                           &intermediate) &&
+             Lz4Decompress(intermediate.data(), intermediate.size(), &data);
+      }
+      if (!ok) return std::nullopt;
+      return FstHierBuffer(std::move(data));
+    }
+    }
+    pos += 1 + section_length;
+  }
+  return std::nullopt;
+}
+
+unsigned char FstHierBuffer::ReadByte() {
+  if (pos_ >= data_.size()) {
+    pos_++;
+    return 0;
+  }
+  return data_[pos_++];
+}
+
+uint64_t FstHierBuffer::ReadVarint() { return DecodeVarint(data_, &pos_); }
+
+const char *FstHierBuffer::ReadString(uint32_t *length) {
+  if (pos_ >= data_.size()) {
+    *length = 0;
+    pos_++;
+    return "";
+  }
+  const char *s = data_.c_str() + pos_;
+  const size_t end = data_.find('\0', pos_);
+  *length = (end == std::string::npos ? data_.size() : end) - pos_;
+  pos_ += *length + 1;
+  return s;
+}
+
+const fstHier *FstHierBuffer::Next() {
+  if (pos_ >= data_.size()) return nullptr;
+  const unsigned char tag = ReadByte();
+  std::memset(&hier_, 0, sizeof(hier_));
+  switch (tag) {
+  case FST_ST_VCD_SCOPE:
+    hier_.htyp = FST_HT_SCOPE;
+    hier_.u.scope.typ = ReadByte();
+    hier_.u.scope.name = ReadString(&hier_.u.scope.name_length);
+    hier_.u.scope.component = ReadString(&hier_.u.scope.component_length);
+    break;
+  case FST_ST_VCD_UPSCOPE: hier_.htyp = FST_HT_UPSCOPE; break;
+  case FST_ST_GEN_ATTRBEGIN:
+    hier_.htyp = FST_HT_ATTRBEGIN;
+    hier_.u.attr.typ = ReadByte();
+    hier_.u.attr.subtype = ReadByte();
+    hier_.u.attr.name = ReadString(&hier_.u.attr.name_length);
+    hier_.u.attr.arg = ReadVarint();
+    if (hier_.u.attr.name_length > 0 && hier_.u.attr.typ == FST_AT_MISC &&
+        (hier_.u.attr.subtype == FST_MT_SOURCESTEM || hier_.u.attr.subtype == FST_MT_SOURCEISTEM)) {
+      // The name holds a varint path ID for these.
+      size_t name_pos = hier_.u.attr.name - data_.c_str();
+      hier_.u.attr.arg_from_name = DecodeVarint(data_, &name_pos);
+    }
+    break;
+  case FST_ST_GEN_ATTREND: hier_.htyp = FST_HT_ATTREND; break;
+  default: {
+    if (tag > FST_VT_MAX) return nullptr; // Corrupt, stop here.
+    hier_.htyp = FST_HT_VAR;
+    hier_.u.var.typ = tag;
+    hier_.u.var.direction = ReadByte();
+    hier_.u.var.name = ReadString(&hier_.u.var.name_length);
+    hier_.u.var.length = ReadVarint();
+    if (tag == FST_VT_VCD_PORT) {
+      // Ports store the length in a different form.
+      hier_.u.var.length -= 2;
+      hier_.u.var.length /= 3;
+    }
+    // Zero means a new handle, anything else is an alias of an earlier one.
+    const fstHandle alias = ReadVarint();
+    if (alias == 0) {
+      hier_.u.var.handle = ++current_handle_;
+    } else {
+      hier_.u.var.handle = alias;
+      hier_.u.var.is_alias = 1;
+    }
+  } break;
+  }
+  // Guard against a truncated last record.
+  if (pos_ > data_.size()) return nullptr;
+  return &hier_;
+}
+
+} // namespace sv
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "external/libfst/src/fstapi.h"
+
+#include <functional>
+#include <optional>
+#include <string>
+
+namespace sv {
+
+// Unpacks the hierarchy section of an FST file into memory, and iterates over it producing the
+// same records as fstReaderIterateHier(). The FST library instead decompresses the hierarchy into
+// a temporary file first, which makes opening slow and unreliable when /tmp is small or slow.
+class FstHierBuffer {
+ public:
+  // Returns nullopt when the hierarchy can't be found or decoded, for example in files that are
+  // compressed as a whole. The FST library should be used in that case.
+  static std::optional<FstHierBuffer> Read(const std::string &file_name);
+  // Next hierarchy record, or nullptr at the end. The record is only valid until the next call.
+  const fstHier *Next();
+  // Hash of the unpacked hierarchy, to detect if it changed between reads of the file.
+  size_t Hash() const { return std::hash<std::string>{}(data_); }
+
+ private:
+  explicit FstHierBuffer(std::string data) : data_(std::move(data)) {}
+  // Readers that don't run past the end of the buffer. Past the end only zeroes are returned.
+  unsigned char ReadByte();
+  uint64_t ReadVarint();
+  // Returns the zero-terminated string at the current position and moves past it.
+  const char *ReadString(uint32_t *length);
+  std::string data_;
+  size_t pos_ = 0;
+  fstHandle current_handle_ = 0;
+  fstHier hier_;
+};
+
+} // namespace sv
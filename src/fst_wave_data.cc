@@ -1,6 +1,8 @@
 #include "fst_wave_data.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "external/libfst/src/fstapi.h"
+#include "fst_hier_buffer.h"
 #include <stack>
 
 namespace sv {
@@ -26,64 +28,120 @@ std::string ParseSignalLsb(const std::string &s, int *lsb) {
 
 absl::StatusOr<std::unique_ptr<FstWaveData>> FstWaveData::Create(const std::string &file_name,
                                                                  bool keep_glitches) {
-  fstReaderContext *reader = fstReaderOpen(file_name.c_str());
-  if (reader == nullptr) return absl::InternalError("Error opening wave file.");
   std::unique_ptr<FstWaveData> waves(new FstWaveData(file_name, keep_glitches));
-  waves->reader_ = reader;
-  waves->ReadScopes();
+  PhaseTimer timer;
+  if (!waves->Open(&timer).ok()) return absl::InternalError("Error opening wave file.");
+  waves->open_timings_ = timer.Report();
   return waves;
 }
 
 FstWaveData::FstWaveData(const std::string &file_name, bool keep_glitches)
     : WaveData(file_name, keep_glitches) {}
 
-FstWaveData::~FstWaveData() { fstReaderClose(reader_); }
+FstWaveData::~FstWaveData() {
+  if (reader_ != nullptr) fstReaderClose(reader_);
+}
+
+absl::Status FstWaveData::Open(PhaseTimer *timer) {
+  // This reads the header and geometry. Those are small, and the geometry is only unpacked to a
+  // temporary file when the whole file is compressed.
+  reader_ = fstReaderOpen(file_name_.c_str());
+  if (reader_ == nullptr) return absl::InternalError("Unable to open wave file.");
+  timer->Finish("header");
+  // The FST library unpacks the hierarchy into a temporary file on the first iteration, avoid that
+  // by reading it straight into memory when possible.
+  std::optional<FstHierBuffer> hier = FstHierBuffer::Read(file_name_);
+  hierarchy_hash_ = hier ? hier->Hash() : 0;
+  if (hier) {
+    timer->Finish("hierarchy unpack");
+    ReadScopes([&] { return hier->Next(); });
+  } else {
+    ReadScopes([&] { return fstReaderIterateHier(reader_); });
+  }
+  timer->Finish(hier ? "hierarchy index" : "hierarchy (libfst)");
+  return absl::OkStatus();
+}
 
 int FstWaveData::Log10TimeUnits() const { return fstReaderGetTimescale(reader_); }
 
-void FstWaveData::ReadScopes() {
+void FstWaveData::ReadScopes(const std::function<const fstHier *()> &next_record) {
   int enum_id_to_use = -1;
-  std::stack<SignalScope *> stack;
-  fstHier *h;
-  while ((h = fstReaderIterateHier(reader_))) {
+  // Source stems apply to the next scope or variable.
+  std::optional<SourceStem> stem;
+  // Track the most recently added child and variable of each open scope, to be able to append to
+  // the linked lists.
+  struct OpenScope {
+    uint32_t idx;
+    uint32_t last_child = kNone;
+    uint32_t last_var = kNone;
+  };
+  std::stack<OpenScope> stack;
+  auto add_name = [&](const char *name, uint32_t length) {
+    const uint32_t offset = names_.size();
+    names_.append(name, length);
+    names_.push_back('\0');
+    return offset;
+  };
+  const fstHier *h;
+  while ((h = next_record())) {
     switch (h->htyp) {
     case FST_HT_SCOPE: {
-      std::string name(h->u.scope.name, h->u.scope.name_length);
+      const uint32_t idx = scopes_.size();
+      scopes_.push_back({.name = add_name(h->u.scope.name, h->u.scope.name_length)});
+      if (stem) scope_stems_[idx] = *stem;
+      stem.reset();
       if (stack.empty()) {
         // A root node just needs the name.
         SignalScope root;
-        root.name = name;
+        root.name = std::string(h->u.scope.name, h->u.scope.name_length);
+        root.loaded = false;
+        root.lazy_id = idx;
         roots_.push_back(root);
-        // This can be safely done since the roots vector won't be modified
-        // until the stack is empty.
-        stack.push(&roots_.back());
       } else {
-        stack.top()->children.push_back({});
-        stack.top()->children.back().name = name;
-        stack.push(&stack.top()->children.back());
+        OpenScope &parent = stack.top();
+        if (parent.last_child == kNone) {
+          scopes_[parent.idx].first_child = idx;
+        } else {
+          scopes_[parent.last_child].next_sibling = idx;
+        }
+        parent.last_child = idx;
       }
+      stack.push({.idx = idx});
     } break;
-    case FST_HT_UPSCOPE: stack.pop(); break;
+    case FST_HT_UPSCOPE:
+      if (!stack.empty()) stack.pop();
+      break;
     case FST_HT_VAR: {
-      std::string name(h->u.var.name, h->u.var.name_length);
-      stack.top()->signals.push_back({});
-      auto &signal = stack.top()->signals.back();
-      signal.id = h->u.var.handle;
-      signal.width = h->u.var.length;
-      signal.name = ParseSignalLsb(name, &signal.lsb);
-      if (enum_id_to_use >= 0) {
-        signal.enum_id = enum_id_to_use;
-        enum_id_to_use = -1; // Don't apply to the next signal automatically.
-      }
+      // Variables outside of any scope have nowhere to be shown.
+      if (stack.empty()) break;
+      if (h->u.var.is_alias) num_aliases_[h->u.var.handle]++;
+      const uint32_t idx = vars_.size();
+      if (stem) var_stems_[idx] = *stem;
+      stem.reset();
+      CompactVar var = {
+          .name = add_name(h->u.var.name, h->u.var.name_length),
+          .width = h->u.var.length,
+          .handle = h->u.var.handle,
+          .enum_id = enum_id_to_use,
+          .direction = Signal::kUnknown,
+          .type = h->u.var.typ == FST_VT_VCD_PARAMETER ? Signal::kParameter : Signal::kNet,
+      };
+      // Don't apply to the next signal automatically.
+      enum_id_to_use = -1;
       switch (h->u.var.direction) {
-      case FST_VD_IMPLICIT: signal.direction = Signal::kInternal; break;
-      case FST_VD_INOUT: signal.direction = Signal::kInout; break;
-      case FST_VD_INPUT: signal.direction = Signal::kInput; break;
-      case FST_VD_OUTPUT: signal.direction = Signal::kOutput; break;
+      case FST_VD_IMPLICIT: var.direction = Signal::kInternal; break;
+      case FST_VD_INOUT: var.direction = Signal::kInout; break;
+      case FST_VD_INPUT: var.direction = Signal::kInput; break;
+      case FST_VD_OUTPUT: var.direction = Signal::kOutput; break;
       }
-      if (h->u.var.typ == FST_VT_VCD_PARAMETER) {
-        signal.type = Signal::kParameter;
+      vars_.push_back(var);
+      OpenScope &parent = stack.top();
+      if (parent.last_var == kNone) {
+        scopes_[parent.idx].first_var = idx;
+      } else {
+        vars_[parent.last_var].next = idx;
       }
+      parent.last_var = idx;
     } break;
     case FST_HT_ATTRBEGIN: {
       switch (h->u.attr.typ) {
@@ -103,6 +161,18 @@ void FstWaveData::ReadScopes() {
           // Perform manual cleanup, FST library doesn't do any of that.
           fstUtilityFreeEnumTable(enum_table);
         } break;
+        case FST_MT_PATHNAME:
+          source_paths_[h->u.attr.arg] = add_name(h->u.attr.name, h->u.attr.name_length);
+          break;
+        case FST_MT_SOURCESTEM:
+          stem = {.path_id = static_cast<uint32_t>(h->u.attr.arg_from_name),
+                  .line = static_cast<uint32_t>(h->u.attr.arg)};
+          break;
+        case FST_MT_SOURCEISTEM:
+          // Instantiation locations don't help finding declarations, but shouldn't be mistaken for
+          // the declaration of the next item either.
+          stem.reset();
+          break;
         }
         break;
       } break;
@@ -111,11 +181,62 @@ void FstWaveData::ReadScopes() {
     }
     }
   }
-  // Now that everything has been read and allocated, recurse the tree and fill
-  // in parents. Can't do this on the fly since vectors get re-allocated and
-  // shuffled around, so pointers derived there won't necessarily be correct
-  // after wave data reading is finished.
-  BuildParents();
+}
+
+void FstWaveData::ReadScope(SignalScope *scope) const {
+  const CompactScope &compact = scopes_[scope->lazy_id];
+  // Count first, so that the vectors are allocated exactly once.
+  int num_children = 0;
+  for (uint32_t idx = compact.first_child; idx != kNone; idx = scopes_[idx].next_sibling) {
+    num_children++;
+  }
+  int num_signals = 0;
+  for (uint32_t idx = compact.first_var; idx != kNone; idx = vars_[idx].next) {
+    num_signals++;
+  }
+  scope->children.reserve(num_children);
+  for (uint32_t idx = compact.first_child; idx != kNone; idx = scopes_[idx].next_sibling) {
+    scope->children.push_back({});
+    SignalScope &child = scope->children.back();
+    child.name = &names_[scopes_[idx].name];
+    child.loaded = false;
+    child.lazy_id = idx;
+  }
+  scope->signals.reserve(num_signals);
+  for (uint32_t idx = compact.first_var; idx != kNone; idx = vars_[idx].next) {
+    const CompactVar &var = vars_[idx];
+    scope->signals.push_back({});
+    Signal &signal = scope->signals.back();
+    signal.id = var.handle;
+    signal.width = var.width;
+    signal.name = ParseSignalLsb(&names_[var.name], &signal.lsb);
+    signal.enum_id = var.enum_id;
+    signal.direction = var.direction;
+    signal.type = var.type;
+  }
+}
+
+std::optional<WaveData::SourceLocation> FstWaveData::SignalSource(const Signal *signal) const {
+  const SignalScope *scope = signal->scope;
+  if (scope == nullptr) return std::nullopt;
+  std::optional<SourceStem> stem;
+  if (!var_stems_.empty()) {
+    // Signals are in the same order as the scope's variable list.
+    uint32_t idx = scopes_[scope->lazy_id].first_var;
+    for (int i = 0; i < signal - scope->signals.data() && idx != kNone; ++i) {
+      idx = vars_[idx].next;
+    }
+    if (const auto it = var_stems_.find(idx); it != var_stems_.end()) stem = it->second;
+  }
+  if (!stem) {
+    if (const auto it = scope_stems_.find(scope->lazy_id); it != scope_stems_.end()) {
+      stem = it->second;
+    }
+  }
+  if (!stem) return std::nullopt;
+  const auto path = source_paths_.find(stem->path_id);
+  if (path == source_paths_.end()) return std::nullopt;
+  return SourceLocation{.file = &names_[path->second], .line = static_cast<int>(stem->line)};
 }
 
 std::pair<uint64_t, uint64_t> FstWaveData::TimeRange() const {
@@ -125,34 +246,54 @@ std::pair<uint64_t, uint64_t> FstWaveData::TimeRange() const {
   return range;
 }
 
-void FstWaveData::LoadSignalSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
-                                    uint64_t end_time) const {
+void FstWaveData::LoadFileSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                                  uint64_t end_time) const {
   // Build a map to know where each result goes during the unpredictable order
   // in callbacks.
   fstReaderClrFacProcessMaskAll(reader_);
+  // Aliased signals share a handle, which only needs to be read once.
+  absl::flat_hash_set<fstHandle> handles;
   for (const auto &s : signals) {
     if (s == nullptr) continue;
     // Don't re-read existing waves.
-    if (s->valid_start_time <= start_time && s->valid_end_time >= end_time) {
-      continue;
-    }
+    if (SamplesValid(s, start_time, end_time)) continue;
+    if (!handles.insert(s->id).second) continue;
     waves_[s->id].clear();
+    glitches_.erase(s->id);
     // Save the time over where the samples are valid.
-    s->valid_start_time = start_time;
-    s->valid_end_time = end_time;
+    valid_ranges_[s->id] = {start_time, end_time};
     // Tell the reader to include this signal while reading the large data
     // blocks.
     fstReaderSetFacProcessMask(reader_, s->id);
   }
+  if (handles.empty()) return;
 
   // This is more of a hint, data blocks can read data outside these limits.
   fstReaderSetLimitTimeRange(reader_, start_time, end_time);
+  ReadBlocks(std::nullopt);
+
+  // Update the valid range based on sample data actually received.
+  for (const fstHandle handle : handles) {
+    const auto &wave = waves_[handle];
+    if (wave.empty()) continue;
+    auto &range = valid_ranges_[handle];
+    range.first = std::min(range.first, wave.front().time);
+    range.second = std::max(range.second, wave.back().time);
+  }
+}
 
+void FstWaveData::ReadBlocks(std::optional<uint64_t> append_after) const {
+  struct Context {
+    const FstWaveData *fst;
+    std::optional<uint64_t> append_after;
+  } context = {.fst = this, .append_after = append_after};
   fstReaderIterBlocks(
       reader_,
       +[](void *user_callback_data_pointer, uint64_t time, fstHandle facidx,
           const unsigned char *value) {
-        FstWaveData *fst = reinterpret_cast<FstWaveData *>(user_callback_data_pointer);
+        const Context *context = reinterpret_cast<const Context *>(user_callback_data_pointer);
+        if (context->append_after && time <= *context->append_after) return;
+        const FstWaveData *fst = context->fst;
         std::vector<Sample> &samples = fst->waves_[facidx];
         const char *str_val = reinterpret_cast<const char *>(value);
         if (!fst->keep_glitches_ && !samples.empty()) {
@@ -160,6 +301,7 @@ void FstWaveData::LoadSignalSamples(const std::vector<const Signal *> &signals,
           if (str_val == prev_sample.value) {
             return; // Ignore duplicates.
           } else if (time == prev_sample.time) {
+            fst->RecordGlitch(facidx, time, prev_sample.value);
             // Does this new value make the previous one pointless?
             if (samples.size() > 1 && samples[samples.size() - 2].value == str_val) {
               samples.pop_back();
@@ -172,25 +314,66 @@ void FstWaveData::LoadSignalSamples(const std::vector<const Signal *> &signals,
         }
         samples.push_back({.time = time, .value = str_val});
       },
-      const_cast<FstWaveData *>(this), nullptr);
+      &context, nullptr);
+}
 
-  // Update the valid range based on sample data actually received.
-  for (const auto &s : signals) {
-    if (s == nullptr) continue;
-    auto &wave = waves_[s->id];
-    if (wave.empty()) continue;
-    s->valid_start_time = std::min(s->valid_start_time, wave.front().time);
-    s->valid_end_time = std::max(s->valid_end_time, wave.back().time);
+bool FstWaveData::ReloadAppended() {
+  if (hierarchy_hash_ == 0) return false;
+  std::optional<FstHierBuffer> hier = FstHierBuffer::Read(file_name_);
+  if (!hier || hier->Hash() != hierarchy_hash_) return false;
+  fstReaderContext *reader = fstReaderOpen(file_name_.c_str());
+  if (reader == nullptr) return false;
+  // Some sanity checks to make sure this is the same simulation, just further along. A re-run of
+  // the simulation would have a different creation date.
+  const uint64_t old_end_time = fstReaderGetEndTime(reader_);
+  if (fstReaderGetStartTime(reader) != fstReaderGetStartTime(reader_) ||
+      fstReaderGetEndTime(reader) < old_end_time ||
+      fstReaderGetMaxHandle(reader) != fstReaderGetMaxHandle(reader_) ||
+      std::string_view(fstReaderGetDateString(reader)) != fstReaderGetDateString(reader_)) {
+    fstReaderClose(reader);
+    return false;
+  }
+  fstReaderClose(reader_);
+  reader_ = reader;
+  const uint64_t new_end_time = fstReaderGetEndTime(reader_);
+  if (new_end_time == old_end_time) return true;
+
+  // Waves that were loaded up to the old end of time get extended to the new end. All others
+  // still have valid samples for their own range, and get loaded as usual when needed. Derived
+  // signals are simply computed again.
+  InvalidateDerivedSamples();
+  fstReaderClrFacProcessMaskAll(reader_);
+  bool any_extended = false;
+  for (auto &[handle, range] : valid_ranges_) {
+    if (range.second < old_end_time || waves_[handle].empty()) continue;
+    range.second = new_end_time;
+    fstReaderSetFacProcessMask(reader_, handle);
+    any_extended = true;
   }
+  if (any_extended) {
+    fstReaderSetLimitTimeRange(reader_, old_end_time, new_end_time);
+    ReadBlocks(old_end_time);
+  }
+  return true;
 }
 
 absl::Status FstWaveData::Reload() {
   fstReaderClose(reader_);
   waves_.clear();
+  valid_ranges_.clear();
+  glitches_.clear();
+  num_aliases_.clear();
   roots_.clear();
-  reader_ = fstReaderOpen(file_name_.c_str());
-  if (reader_ == nullptr) return absl::InternalError("Unable to re-read wave file.");
-  ReadScopes();
+  scopes_.clear();
+  vars_.clear();
+  names_.clear();
+  scope_stems_.clear();
+  var_stems_.clear();
+  source_paths_.clear();
+  PhaseTimer timer;
+  if (!Open(&timer).ok()) return absl::InternalError("Unable to re-read wave file.");
+  open_timings_ = timer.Report();
+  RecompileDerivedSignals();
   return absl::OkStatus();
 }
 
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "external/libfst/src/fstapi.h"
+#include "utils.h"
 #include "wave_data.h"
 
+#include <functional>
+
 namespace sv {
 
 // FST implementation of WaveData, based on the FST library from GTKWave.
@@ -13,15 +16,63 @@ class FstWaveData : public WaveData {
   ~FstWaveData() override;
   int Log10TimeUnits() const final;
   std::pair<uint64_t, uint64_t> TimeRange() const final;
-  void LoadSignalSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
-                         uint64_t end_time) const final;
   absl::Status Reload() final;
+  bool ReloadAppended() final;
+  std::optional<SourceLocation> SignalSource(const Signal *signal) const final;
+  bool HasSourceLocations() const final { return !source_paths_.empty(); }
 
  private:
   FstWaveData(const std::string &file_name, bool keep_glitches);
-  void ReadScopes();
+  // Opens the file and reads the hierarchy, recording how long each phase took.
+  absl::Status Open(PhaseTimer *timer);
+  // Single pass over the hierarchy that only records a compact table of scopes and variables.
+  // Records are pulled from the given function until it returns nullptr.
+  void ReadScopes(const std::function<const fstHier *()> &next_record);
+  void ReadScope(SignalScope *scope) const final;
+  void LoadFileSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                       uint64_t end_time) const final;
+  // Reads value changes for all signals selected in the process mask. When appending, samples at
+  // or before the given time are already present and are skipped.
+  void ReadBlocks(std::optional<uint64_t> append_after) const;
   // The FST library is written in C and uses a lot of untyped handles.
   fstReaderContext *reader_ = nullptr;
+  // Used to detect if a reloaded file has the same hierarchy. Zero if unknown.
+  size_t hierarchy_hash_ = 0;
+
+  // Compact form of the hierarchy. Designs can have millions of scopes and variables, so the full
+  // SignalScope and Signal objects are only created when a scope is first looked at. Names are
+  // offsets into names_, and children/variables of a scope form a singly-linked list through the
+  // flat vectors.
+  static constexpr uint32_t kNone = 0xffffffff;
+  struct CompactScope {
+    uint32_t name;
+    uint32_t first_child = kNone;
+    uint32_t next_sibling = kNone;
+    uint32_t first_var = kNone;
+  };
+  struct CompactVar {
+    uint32_t name;
+    uint32_t next = kNone;
+    uint32_t width;
+    fstHandle handle;
+    int enum_id;
+    Signal::Direction direction;
+    Signal::Type type;
+  };
+  std::vector<CompactScope> scopes_;
+  std::vector<CompactVar> vars_;
+  // All names, each terminated by a zero.
+  std::string names_;
+  // Source file and line attributes. Few writers emit these, and typically only for scopes, so
+  // they are kept on the side keyed by compact scope or variable index. Paths are offsets into
+  // names_, keyed by the ID the file gives them.
+  struct SourceStem {
+    uint32_t path_id;
+    uint32_t line;
+  };
+  absl::flat_hash_map<uint32_t, SourceStem> scope_stems_;
+  absl::flat_hash_map<uint32_t, SourceStem> var_stems_;
+  absl::flat_hash_map<uint32_t, uint32_t> source_paths_;
 };
 
 } // namespace sv
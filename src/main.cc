@@ -6,6 +6,10 @@ int main(int argc, char *argv[]) {
     // This function prints plenty of errors if it fails.
     return -1;
   }
+  // Reports run without any UI.
+  if (const auto &report = sv::Workspace::Get().HeadlessReport()) {
+    return sv::RunActivityReport(*sv::Workspace::Get().Waves(), *report);
+  }
 
   // Start the UI and the event loop.
   sv::UI ui;
@@ -49,6 +49,9 @@ class Panel : public TextReceiver {
   std::string Error() const;
   virtual void PrepareForWaveDataReload() {}
   virtual void HandleReloadedWaves() {}
+  // Called instead of the above pair when the wave file only had new data appended. All signal and
+  // scope pointers are still valid.
+  virtual void HandleAppendedWaves() {}
   virtual void PrepareForDesignReload() {}
   virtual void HandleReloadedDesign() {}
 
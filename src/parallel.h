@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sv {
+
+// Splits [0, n) into contiguous chunks of at least min_chunk elements, and calls
+// fn(chunk_idx, begin, end) for each of them on its own thread. There are at most as many chunks
+// as hardware threads, and small ranges run as a single chunk on the calling thread. Returns the
+// number of chunks.
+template <typename Fn>
+int ParallelChunks(size_t n, size_t min_chunk, Fn &&fn) {
+  const size_t max_chunks = std::max(1u, std::thread::hardware_concurrency());
+  const size_t num_chunks = std::clamp<size_t>(n / std::max<size_t>(1, min_chunk), 1, max_chunks);
+  if (num_chunks == 1) {
+    fn(0, size_t{0}, n);
+    return 1;
+  }
+  const size_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  std::vector<std::thread> threads;
+  threads.reserve(num_chunks - 1);
+  // The calling thread does the first chunk itself.
+  for (size_t i = 1; i < num_chunks; ++i) {
+    const size_t begin = i * chunk_size;
+    const size_t end = std::min(n, begin + chunk_size);
+    threads.emplace_back([&fn, i, begin, end] { fn(static_cast<int>(i), begin, end); });
+  }
+  fn(0, size_t{0}, std::min(n, chunk_size));
+  for (auto &t : threads) {
+    t.join();
+  }
+  return num_chunks;
+}
+
+// Fixed set of threads running submitted tasks in order, for work that is produced bit by bit,
+// such as waves that are loaded in batches.
+class WorkerPool {
+ public:
+  // Zero threads means one per hardware thread.
+  explicit WorkerPool(int num_threads = 0) {
+    if (num_threads <= 0) num_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] { Run(); });
+    }
+  }
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+  void Submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    task_cv_.notify_one();
+  }
+  // Blocks until all submitted tasks have finished.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return tasks_.empty() && busy_ == 0; });
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        // Remaining tasks are still done when stopping.
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+        busy_++;
+      }
+      task();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy_--;
+      }
+      idle_cv_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::function<void()>> tasks_;
+  int busy_ = 0;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+} // namespace sv
@@ -1,26 +1,56 @@
 #include "slang_utils.h"
 
+#include "absl/container/flat_hash_set.h"
+#include "parallel.h"
 #include "slang/ast/ASTVisitor.h"
+#include "slang/ast/Compilation.h"
 #include "slang/ast/Scope.h"
 #include "slang/ast/SemanticFacts.h"
 #include "slang/ast/Symbol.h"
 #include "slang/ast/expressions/AssignmentExpressions.h"
 #include "slang/ast/expressions/SelectExpressions.h"
+#include "slang/ast/statements/MiscStatements.h"
 #include "slang/ast/symbols/BlockSymbols.h"
 #include "slang/ast/symbols/InstanceSymbols.h"
 #include "slang/ast/symbols/PortSymbols.h"
+#include "slang/syntax/AllSyntax.h"
+#include "slang/text/SourceManager.h"
+
+#include <algorithm>
+#include <utility>
 
 namespace sv {
 
 namespace {
 
+using DriverOrLoadMap =
+    absl::flat_hash_map<const slang::ast::Symbol *, std::vector<SlangDriverOrLoad>>;
+
+// How nets are connected to each other, for tracing across the hierarchy and through logic.
+struct Connectivity {
+  // The child port that each named value in a port connection expression connects to.
+  absl::flat_hash_map<const slang::ast::NamedValueExpression *, const slang::ast::PortSymbol *>
+      connection_ports;
+  // The nets in the parent that each port is connected to.
+  absl::flat_hash_map<const slang::ast::PortSymbol *, std::vector<const slang::ast::Symbol *>>
+      port_nets;
+  // The nets read by the assignments to each net.
+  absl::flat_hash_map<const slang::ast::Symbol *, std::vector<const slang::ast::Symbol *>> fanin;
+};
+
+void AddUnique(std::vector<const slang::ast::Symbol *> &syms, const slang::ast::Symbol *sym) {
+  if (std::find(syms.begin(), syms.end(), sym) == syms.end()) syms.push_back(sym);
+}
+
 // Helper class to traverse the instance looking for drivers or loads.
 template <bool DRIVERS>
 class DriverOrLoadFinder
     : public slang::ast::ASTVisitor<DriverOrLoadFinder<DRIVERS>, slang::ast::VisitFlags::AllGood> {
  public:
   DriverOrLoadFinder(const slang::ast::Symbol *sym, std::vector<SlangDriverOrLoad> &d)
-      : sym_(sym), drivers_or_loads_(d) {}
+      : sym_(sym), drivers_or_loads_(&d) {}
+  // Finds the drivers or loads of all symbols at once, for the index.
+  DriverOrLoadFinder(DriverOrLoadMap &all, Connectivity &ports) : all_(&all), ports_(&ports) {}
   // Don't traverse into sub-instances, but do inspect the expressions on instance ports.
   void handle(const slang::ast::InstanceSymbol &inst) {
     // Iterate through all ports to find the connections that are driving/loading.
@@ -30,6 +60,7 @@ class DriverOrLoadFinder
             (DRIVERS ? slang::ast::ArgumentDirection::In : slang::ast::ArgumentDirection::Out)) {
           if (const slang::ast::Expression *expr = conn->getExpression()) {
             checking_instance_port_expression_ = true;
+            connection_port_ = port;
             expr->visit(*this);
             checking_instance_port_expression_ = false;
           }
@@ -41,19 +72,31 @@ class DriverOrLoadFinder
   void handle(const slang::ast::PortSymbol &port) {
     if (port.direction !=
             (DRIVERS ? slang::ast::ArgumentDirection::Out : slang::ast::ArgumentDirection::In) &&
-        port.internalSymbol != nullptr && port.internalSymbol == sym_) {
-      drivers_or_loads_.push_back(&port);
+        port.internalSymbol != nullptr && Matches(port.internalSymbol)) {
+      Add(port.internalSymbol, &port);
     }
   }
   // Assignments: make note of which side is being checked. Note that function calls on the right
   // side that have output arguments result in further nested assignments with their own left/right.
   void handle(const slang::ast::AssignmentExpression &assignment) {
+    // Nested assignments have their own fan-in.
+    auto outer_assigned = std::exchange(assigned_, {});
+    auto outer_read = std::exchange(read_, {});
     checking_lhs_ = true;
     assignment.left().visit(*this);
     checking_lhs_ = false;
     checking_rhs_ = true;
     assignment.right().visit(*this);
     checking_rhs_ = false;
+    if (ports_ != nullptr) {
+      for (const slang::ast::Symbol *lhs : assigned_) {
+        for (const slang::ast::Symbol *rhs : read_) {
+          AddUnique(ports_->fanin[lhs], rhs);
+        }
+      }
+    }
+    assigned_ = std::move(outer_assigned);
+    read_ = std::move(outer_read);
   }
   // For selection expressions, only check the value for drivers, not the selector. Both should be
   // checked in the case of loads.
@@ -76,15 +119,27 @@ class DriverOrLoadFinder
   }
   // Under the right conditions, named-value expressions matching the symbol are saved as drivers.
   void handle(const slang::ast::NamedValueExpression &nve) {
-    if (&nve.symbol != sym_) return;
+    if (ports_ != nullptr && checking_instance_port_expression_) {
+      ports_->connection_ports[&nve] = connection_port_;
+      // Inout connections are seen by both the driver and the load search.
+      AddUnique(ports_->port_nets[connection_port_], &nve.symbol);
+    }
+    if (ports_ != nullptr && DRIVERS) {
+      if (checking_lhs_) {
+        assigned_.push_back(&nve.symbol);
+      } else if (checking_rhs_) {
+        AddUnique(read_, &nve.symbol);
+      }
+    }
+    if (!Matches(&nve.symbol)) return;
     if constexpr (DRIVERS) {
       if (checking_instance_port_expression_ || checking_lhs_) {
-        drivers_or_loads_.push_back(&nve);
+        Add(&nve.symbol, &nve);
       }
     } else {
       // Any matching NamedValue is a load unless it's a left-side non-selector.
       if (!(checking_lhs_ && selector_depth_ == 0)) {
-        drivers_or_loads_.push_back(&nve);
+        Add(&nve.symbol, &nve);
       }
     }
   }
@@ -92,14 +147,77 @@ class DriverOrLoadFinder
   void handle(const slang::ast::UninstantiatedDefSymbol &uninst) {}
 
  private:
-  const slang::ast::Symbol *sym_;
-  std::vector<SlangDriverOrLoad> &drivers_or_loads_;
+  bool Matches(const slang::ast::Symbol *sym) const { return all_ != nullptr || sym == sym_; }
+  void Add(const slang::ast::Symbol *sym, SlangDriverOrLoad d) {
+    if (all_ != nullptr) {
+      (*all_)[sym].push_back(d);
+    } else {
+      drivers_or_loads_->push_back(d);
+    }
+  }
+  const slang::ast::Symbol *sym_ = nullptr;
+  std::vector<SlangDriverOrLoad> *drivers_or_loads_ = nullptr;
+  DriverOrLoadMap *all_ = nullptr;
+  Connectivity *ports_ = nullptr;
   bool checking_instance_port_expression_ = false;
+  const slang::ast::PortSymbol *connection_port_ = nullptr;
+  // Nets assigned and read by the current assignment.
+  std::vector<const slang::ast::Symbol *> assigned_;
+  std::vector<const slang::ast::Symbol *> read_;
   bool checking_lhs_ = false;
   bool checking_rhs_ = false;
   int selector_depth_ = 0;
 };
 
+// Collects all instance bodies, without looking at statements and expressions.
+class BodyCollector : public slang::ast::ASTVisitor<BodyCollector, slang::ast::VisitFlags::None> {
+ public:
+  explicit BodyCollector(std::vector<const slang::ast::InstanceBodySymbol *> &b) : bodies_(b) {}
+  void handle(const slang::ast::InstanceSymbol &inst) {
+    bodies_.push_back(&inst.body);
+    visitDefault(inst);
+  }
+  void handle(const slang::ast::GenerateBlockSymbol &gen) {
+    if (!gen.isUninstantiated) visitDefault(gen);
+  }
+
+ private:
+  std::vector<const slang::ast::InstanceBodySymbol *> &bodies_;
+};
+
+// Collects concurrent assertions, keeping track of the procedural block they are in to know their
+// scope.
+class AssertionFinder
+    : public slang::ast::ASTVisitor<AssertionFinder, slang::ast::VisitFlags::AllGood> {
+ public:
+  explicit AssertionFinder(std::vector<SlangAssertion> &a) : assertions_(a) {}
+  void handle(const slang::ast::ProceduralBlockSymbol &proc) {
+    scope_ = proc.getParentScope();
+    visitDefault(proc);
+  }
+  void handle(const slang::ast::ConcurrentAssertionStatement &stmt) {
+    if (scope_ == nullptr || stmt.syntax == nullptr) return;
+    if (stmt.assertionKind != slang::ast::AssertionKind::Assert &&
+        stmt.assertionKind != slang::ast::AssertionKind::Assume) {
+      return;
+    }
+    const auto &syntax = stmt.syntax->as<slang::syntax::ConcurrentAssertionStatementSyntax>();
+    std::string name = scope_->asSymbol().getHierarchicalPath();
+    if (syntax.label != nullptr) {
+      name += "." + std::string(syntax.label->name.valueText());
+    } else {
+      const slang::SourceManager *sm = scope_->getCompilation().getSourceManager();
+      name += ":" + std::to_string(sm->getLineNumber(stmt.sourceRange.start()));
+    }
+    assertions_.push_back(
+        {.scope = scope_, .name = std::move(name), .property = syntax.propertySpec->toString()});
+  }
+
+ private:
+  const slang::ast::Scope *scope_ = nullptr;
+  std::vector<SlangAssertion> &assertions_;
+};
+
 } // namespace
 
 bool SymbolHasSubs(const slang::ast::Symbol *s) {
@@ -153,4 +271,167 @@ std::vector<SlangDriverOrLoad> GetLoads(const slang::ast::Symbol *sym) {
   return loads;
 }
 
+std::vector<SlangAssertion> GetConcurrentAssertions(const slang::ast::Symbol &root) {
+  std::vector<SlangAssertion> assertions;
+  AssertionFinder finder(assertions);
+  root.visit(finder);
+  return assertions;
+}
+
+std::unique_ptr<DriverLoadIndex> DriverLoadIndex::Build(const slang::ast::Symbol &root) {
+  // The finders don't descend into sub-instances, so every body is visited on its own.
+  std::vector<const slang::ast::InstanceBodySymbol *> bodies;
+  BodyCollector collector(bodies);
+  root.visit(collector);
+
+  struct Chunk {
+    DriverOrLoadMap drivers;
+    DriverOrLoadMap loads;
+    Connectivity ports;
+  };
+  std::vector<Chunk> chunks(std::max(1u, std::thread::hardware_concurrency()));
+  const int num_chunks =
+      ParallelChunks(bodies.size(), 16, [&](int chunk, size_t begin, size_t end) {
+        DriverOrLoadFinder</*DRIVERS*/ true> df(chunks[chunk].drivers, chunks[chunk].ports);
+        DriverOrLoadFinder</*DRIVERS*/ false> lf(chunks[chunk].loads, chunks[chunk].ports);
+        for (size_t i = begin; i < end; ++i) {
+          bodies[i]->visit(df);
+          bodies[i]->visit(lf);
+        }
+      });
+  // Merged in body order, so the results are ordered like the single instance search.
+  auto index = std::make_unique<DriverLoadIndex>();
+  for (int i = 0; i < num_chunks; ++i) {
+    for (auto &[sym, drivers] : chunks[i].drivers) {
+      auto &all = index->drivers_[sym];
+      all.insert(all.end(), drivers.begin(), drivers.end());
+    }
+    for (auto &[sym, loads] : chunks[i].loads) {
+      auto &all = index->loads_[sym];
+      all.insert(all.end(), loads.begin(), loads.end());
+    }
+    // A connection is always in one body, so it is only found by one chunk.
+    index->connection_ports_.merge(chunks[i].ports.connection_ports);
+    index->port_nets_.merge(chunks[i].ports.port_nets);
+    for (auto &[sym, fanin] : chunks[i].ports.fanin) {
+      auto &all = index->fanin_[sym];
+      for (const slang::ast::Symbol *f : fanin) AddUnique(all, f);
+    }
+  }
+  return index;
+}
+
+const std::vector<SlangDriverOrLoad> &DriverLoadIndex::Drivers(
+    const slang::ast::Symbol *sym) const {
+  static const std::vector<SlangDriverOrLoad> kNone;
+  const auto it = drivers_.find(sym);
+  return it == drivers_.end() ? kNone : it->second;
+}
+
+const std::vector<SlangDriverOrLoad> &DriverLoadIndex::Loads(const slang::ast::Symbol *sym) const {
+  static const std::vector<SlangDriverOrLoad> kNone;
+  const auto it = loads_.find(sym);
+  return it == loads_.end() ? kNone : it->second;
+}
+
+const std::vector<DriverLoadIndex::Endpoint> &DriverLoadIndex::UltimateDrivers(
+    const slang::ast::Symbol *sym) const {
+  return Trace(sym, /*drivers*/ true);
+}
+
+const std::vector<DriverLoadIndex::Endpoint> &DriverLoadIndex::UltimateLoads(
+    const slang::ast::Symbol *sym) const {
+  return Trace(sym, /*drivers*/ false);
+}
+
+const std::vector<DriverLoadIndex::Endpoint> &DriverLoadIndex::Trace(const slang::ast::Symbol *sym,
+                                                                     bool drivers) const {
+  auto &memo = drivers ? ultimate_drivers_ : ultimate_loads_;
+  if (const auto it = memo.find(sym); it != memo.end()) return it->second;
+  TraceState state;
+  Trace(sym, drivers, &state);
+  return memo.at(sym);
+}
+
+int DriverLoadIndex::Trace(const slang::ast::Symbol *sym, bool drivers, TraceState *state) const {
+  auto &memo = drivers ? ultimate_drivers_ : ultimate_loads_;
+  const int order = state->order.size();
+  state->order.emplace(sym, order);
+  state->open.push_back(sym);
+  int earliest = order;
+  std::vector<Endpoint> endpoints;
+  absl::flat_hash_set<SlangDriverOrLoad> seen;
+  const auto add = [&](const std::vector<Endpoint> &more) {
+    for (const Endpoint &e : more) {
+      if (seen.insert(e.where).second) endpoints.push_back(e);
+    }
+  };
+  const auto follow = [&](const slang::ast::Symbol *net) {
+    if (const auto it = memo.find(net); it != memo.end()) {
+      add(it->second);
+    } else if (const auto it = state->order.find(net); it != state->order.end()) {
+      // Looped back to an open net, whose endpoints are all gathered where the loop started.
+      earliest = std::min(earliest, it->second);
+    } else {
+      earliest = std::min(earliest, Trace(net, drivers, state));
+      const auto done = memo.find(net);
+      add(done != memo.end() ? done->second : state->partial.at(net));
+    }
+  };
+  for (const SlangDriverOrLoad &d : drivers ? Drivers(sym) : Loads(sym)) {
+    if (const auto *port = std::get_if<const slang::ast::PortSymbol *>(&d)) {
+      // A port of this instance: continue in the parent, with what is connected to it.
+      const auto nets = port_nets_.find(*port);
+      if (nets != port_nets_.end()) {
+        for (const slang::ast::Symbol *net : nets->second) follow(net);
+        continue;
+      }
+    } else {
+      // Connected to a port of a child instance: continue inside it.
+      const auto *nve = std::get<const slang::ast::NamedValueExpression *>(d);
+      const auto port = connection_ports_.find(nve);
+      if (port != connection_ports_.end() && port->second->internalSymbol != nullptr) {
+        follow(port->second->internalSymbol);
+        continue;
+      }
+    }
+    if (seen.insert(d).second) endpoints.push_back({.where = d, .net = sym});
+  }
+  if (earliest < order) {
+    // Part of a loop through an earlier net, which completes the endpoints.
+    state->partial[sym] = std::move(endpoints);
+    return earliest;
+  }
+  // The nets opened after this one all loop back to it.
+  while (state->open.back() != sym) {
+    memo[state->open.back()] = endpoints;
+    state->partial.erase(state->open.back());
+    state->open.pop_back();
+  }
+  state->open.pop_back();
+  memo[sym] = std::move(endpoints);
+  return order;
+}
+
+std::vector<const slang::ast::Symbol *> DriverLoadIndex::FanIn(
+    const slang::ast::Symbol *sym) const {
+  std::vector<const slang::ast::Symbol *> fanin;
+  if (const auto it = fanin_.find(sym); it != fanin_.end()) fanin = it->second;
+  // One hop through the ports that drive the net, in either direction.
+  for (const SlangDriverOrLoad &d : Drivers(sym)) {
+    if (const auto *port = std::get_if<const slang::ast::PortSymbol *>(&d)) {
+      if (const auto nets = port_nets_.find(*port); nets != port_nets_.end()) {
+        for (const slang::ast::Symbol *net : nets->second) AddUnique(fanin, net);
+      }
+    } else {
+      const auto *nve = std::get<const slang::ast::NamedValueExpression *>(d);
+      const auto port = connection_ports_.find(nve);
+      if (port != connection_ports_.end() && port->second->internalSymbol != nullptr) {
+        AddUnique(fanin, port->second->internalSymbol);
+      }
+    }
+  }
+  return fanin;
+}
+
 } // namespace sv
@@ -1,10 +1,16 @@
 #pragma once
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/node_hash_map.h"
 #include "slang/ast/Scope.h"
 #include "slang/ast/Symbol.h"
 #include "slang/ast/expressions/MiscExpressions.h"
 #include "slang/ast/symbols/PortSymbols.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 namespace sv {
 
 // Drivers and loads  are typically some named value expression in an assignment. But they could
@@ -24,4 +30,73 @@ bool IsTraceable(const slang::ast::Symbol *sym);
 std::vector<SlangDriverOrLoad> GetDrivers(const slang::ast::Symbol *sym);
 std::vector<SlangDriverOrLoad> GetLoads(const slang::ast::Symbol *sym);
 
+// Drivers and loads of every net and variable in the design, found with a single pass over each
+// instance body so that tracing is a lookup instead of a visit of the whole instance.
+class DriverLoadIndex {
+ public:
+  // Visits the instance bodies in parallel. The design must be fully elaborated beforehand, or the
+  // visits would bind parts of it lazily from several threads at once.
+  static std::unique_ptr<DriverLoadIndex> Build(const slang::ast::Symbol &root);
+  // Same results as GetDrivers() and GetLoads(), empty for unknown symbols.
+  const std::vector<SlangDriverOrLoad> &Drivers(const slang::ast::Symbol *sym) const;
+  const std::vector<SlangDriverOrLoad> &Loads(const slang::ast::Symbol *sym) const;
+
+  // A driver or load found by tracing across the hierarchy, with the net it drives or loads.
+  struct Endpoint {
+    SlangDriverOrLoad where;
+    const slang::ast::Symbol *net;
+  };
+  // Follows the net through instance ports, up into parents and down into children, to the
+  // drivers (or loads) that are not port connections. Ports of the top level, or without a
+  // connection, end the trace. Every net's result is kept, so later traces through it are free,
+  // except while it is part of a loop through inout ports that is still being traced.
+  // Not thread safe.
+  const std::vector<Endpoint> &UltimateDrivers(const slang::ast::Symbol *sym) const;
+  const std::vector<Endpoint> &UltimateLoads(const slang::ast::Symbol *sym) const;
+  // Nets that the net's value is computed from: those read by the assignments to it, and the ones
+  // on the other side of the ports that drive it. Conditions of procedural code are not included.
+  std::vector<const slang::ast::Symbol *> FanIn(const slang::ast::Symbol *sym) const;
+
+ private:
+  const std::vector<Endpoint> &Trace(const slang::ast::Symbol *sym, bool drivers) const;
+  // Nets visited by one trace that are not memoized yet, in visiting order, like Tarjan's strongly
+  // connected components. Loops through inout ports make a net reach itself, and every net in such
+  // a loop has the same endpoints.
+  struct TraceState {
+    absl::flat_hash_map<const slang::ast::Symbol *, int> order;
+    std::vector<const slang::ast::Symbol *> open;
+    // Endpoints found so far for the open nets, which are missing those of the rest of the loop.
+    absl::flat_hash_map<const slang::ast::Symbol *, std::vector<Endpoint>> partial;
+  };
+  // Traces a net that is not memoized yet. Returns the earliest visiting order of an open net that
+  // it reached. When that is its own, the net and the open nets after it are memoized.
+  int Trace(const slang::ast::Symbol *sym, bool drivers, TraceState *state) const;
+
+  absl::flat_hash_map<const slang::ast::Symbol *, std::vector<SlangDriverOrLoad>> drivers_;
+  absl::flat_hash_map<const slang::ast::Symbol *, std::vector<SlangDriverOrLoad>> loads_;
+  // Port connectivity: the child port each named value in a port connection connects to, and the
+  // nets in the parent that each port is connected to.
+  absl::flat_hash_map<const slang::ast::NamedValueExpression *, const slang::ast::PortSymbol *>
+      connection_ports_;
+  absl::flat_hash_map<const slang::ast::PortSymbol *, std::vector<const slang::ast::Symbol *>>
+      port_nets_;
+  absl::flat_hash_map<const slang::ast::Symbol *, std::vector<const slang::ast::Symbol *>> fanin_;
+  // Memoized traces. Node based, so references stay valid while more are added.
+  mutable absl::node_hash_map<const slang::ast::Symbol *, std::vector<Endpoint>> ultimate_drivers_;
+  mutable absl::node_hash_map<const slang::ast::Symbol *, std::vector<Endpoint>> ultimate_loads_;
+};
+
+// A concurrent assert (or assume) property statement in the elaborated design.
+struct SlangAssertion {
+  // Scope in which the names used in the property are looked up.
+  const slang::ast::Scope *scope;
+  // Hierarchical path of the label, or of the scope followed by the source line.
+  std::string name;
+  // The property itself, without the assert keywords and the action block.
+  std::string property;
+};
+
+// All concurrent assertions in every instance below the symbol.
+std::vector<SlangAssertion> GetConcurrentAssertions(const slang::ast::Symbol &root);
+
 } // namespace sv
@@ -0,0 +1,62 @@
+#include "slang_utils.h"
+
+#include "external/googletest/googletest/include/gtest/gtest.h"
+#include "slang/ast/Compilation.h"
+#include "slang/ast/symbols/CompilationUnitSymbols.h"
+#include "slang/ast/symbols/InstanceSymbols.h"
+#include "slang/syntax/SyntaxTree.h"
+
+namespace sv {
+namespace {
+
+// The parent net and the child's inout port are connected both ways, so a trace from either one
+// comes back to where it started.
+constexpr std::string_view kInoutLoop = R"(
+module child(inout wire p);
+  logic x;
+  assign p = x;
+endmodule
+
+module top(input logic a);
+  wire n;
+  assign n = a;
+  child u(.p(n));
+endmodule
+)";
+
+class DriverLoadIndexTest : public testing::Test {
+ protected:
+  DriverLoadIndexTest() {
+    compilation_.addSyntaxTree(slang::syntax::SyntaxTree::fromText(kInoutLoop));
+    const slang::ast::RootSymbol &root = compilation_.getRoot();
+    compilation_.getAllDiagnostics();
+    compilation_.freeze();
+    index_ = DriverLoadIndex::Build(root);
+    const slang::ast::InstanceBodySymbol &top = root.topInstances[0]->body;
+    n_ = top.find("n");
+    const auto &u = top.find("u")->as<slang::ast::InstanceSymbol>();
+    p_ = u.body.getPortList()[0]->as<slang::ast::PortSymbol>().internalSymbol;
+  }
+  slang::ast::Compilation compilation_;
+  std::unique_ptr<DriverLoadIndex> index_;
+  const slang::ast::Symbol *n_ = nullptr;
+  const slang::ast::Symbol *p_ = nullptr;
+};
+
+TEST_F(DriverLoadIndexTest, InoutLoopFromParent) {
+  ASSERT_NE(n_, nullptr);
+  ASSERT_NE(p_, nullptr);
+  // Both assignments drive both nets, whichever of them is traced first.
+  EXPECT_EQ(index_->UltimateDrivers(n_).size(), 2);
+  EXPECT_EQ(index_->UltimateDrivers(p_).size(), 2);
+}
+
+TEST_F(DriverLoadIndexTest, InoutLoopFromChild) {
+  ASSERT_NE(n_, nullptr);
+  ASSERT_NE(p_, nullptr);
+  EXPECT_EQ(index_->UltimateDrivers(p_).size(), 2);
+  EXPECT_EQ(index_->UltimateDrivers(n_).size(), 2);
+}
+
+} // namespace
+} // namespace sv
@@ -1,76 +1,96 @@
 #include "source_buffer.h"
 
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace sv {
 namespace {
 
 constexpr int kTabSize = 4;
 
+// Calls fn with the offset of every newline, carriage return and tab in the buffer, in order.
+// Source text has few of those per 16 bytes, so they are looked for a vector at a time.
+template <typename Fn>
+void ForEachSpecialChar(std::string_view buf, Fn &&fn) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  const __m128i tab = _mm_set1_epi8('\t');
+  for (; i + 16 <= buf.size(); i += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(buf.data() + i));
+    const __m128i found =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, newline),
+                                  _mm_cmpeq_epi8(chunk, carriage_return)),
+                     _mm_cmpeq_epi8(chunk, tab));
+    for (uint32_t mask = _mm_movemask_epi8(found); mask != 0; mask &= mask - 1) {
+      fn(i + std::countr_zero(mask));
+    }
+  }
+#endif
+  for (; i < buf.size(); ++i) {
+    if (buf[i] == '\n' || buf[i] == '\r' || buf[i] == '\t') fn(i);
+  }
+}
+
 } // namespace
 
 void SourceBuffer::ProcessBuffer(std::string_view buf) {
   // Clear to start
-  lines_.clear();
-  tab_expansion_info_.clear();
-  // Helper to process the most recently added line.
-  auto AddTabInfo = [&] {
-    std::string_view s = lines_.back();
-    const int line_idx = lines_.size() - 1;
-    int extra = 0;
-    int pos = 0;
-    bool any_tabs = false;
-    int tab_pos;
-    while ((tab_pos = s.find('\t', pos)) != std::string_view::npos) {
-      pos = tab_pos + 1;
-      const int display_pos = tab_pos + extra;
+  buf_ = buf;
+  line_starts_.clear();
+  line_ends_.clear();
+  tabs_.clear();
+  line_tabs_.assign(1, 0);
+  size_t line_start = 0;
+  int extra = 0;
+  const auto add_line = [&](size_t end) {
+    line_starts_.push_back(line_start);
+    line_ends_.push_back(end);
+    line_tabs_.push_back(tabs_.size());
+    extra = 0;
+  };
+  ForEachSpecialChar(buf, [&](size_t pos) {
+    if (buf[pos] == '\t') {
+      const int tab_pos = pos - line_start;
       // Calculate the number of spaces caused by this tab character, not counting the tab itself.
       // Accumulate since the number of extra spaces up to this location include all previous tabs.
-      extra += kTabSize - display_pos % kTabSize - 1;
-      tab_expansion_info_[line_idx].extra_spaces[pos] = extra;
-      any_tabs = true;
-    }
-    if (any_tabs) tab_expansion_info_[line_idx].line_length = s.size() + extra;
-  };
-  size_t pos = 0;
-  while (pos < buf.length()) {
-    size_t newline_pos = buf.find_first_of("\r\n", pos);
-    const bool is_cr = newline_pos != std::string_view::npos && buf[newline_pos] == '\r';
-    // If a newline is found, extract the substring up to it.
-    if (newline_pos != std::string_view::npos) {
-      lines_.push_back(buf.substr(pos, newline_pos - pos));
-      AddTabInfo();
-      // Advance past the newline character for the next search.
-      pos = newline_pos + 1;
-      // Check for the Windows-style CRLF sequence (\r\n).
-      if (pos < buf.length() && is_cr && buf[pos] == '\n') pos++;
+      extra += kTabSize - (tab_pos + extra) % kTabSize - 1;
+      tabs_.push_back({.col = tab_pos + 1, .extra = extra});
+    } else if (buf[pos] == '\n' && pos == line_start && pos > 0 && buf[pos - 1] == '\r') {
+      // The second half of a Windows-style CRLF sequence (\r\n).
+      line_start = pos + 1;
     } else {
-      // No more newlines found, so add the remaining part of the string and finish.
-      int remainder = buf.length() - pos;
-      // Skip the terminating zero.
-      if (buf[buf.length() - 1] == '\0') remainder--;
-      // Don't add a last blank line.
-      if (remainder > 0) {
-        lines_.push_back(buf.substr(pos, remainder));
-        AddTabInfo();
-      }
-      break;
+      add_line(pos);
+      line_start = pos + 1;
     }
-  }
+  });
+  // Add the remaining part of the string, without the terminating zero.
+  size_t end = buf.size();
+  if (end > line_start && buf[end - 1] == '\0') end--;
+  // Don't add a last blank line.
+  if (end > line_start) add_line(end);
 }
 
 int SourceBuffer::LineLength(int n) const {
-  const auto it = tab_expansion_info_.find(n);
-  if (it == tab_expansion_info_.end()) return lines_[n].size();
-  return it->second.line_length;
+  const int length = line_ends_[n] - line_starts_[n];
+  if (line_tabs_[n] == line_tabs_[n + 1]) return length;
+  return length + tabs_[line_tabs_[n + 1] - 1].extra;
 }
 
 int SourceBuffer::DisplayCol(int row, int col) const {
-  const auto line_map_it = tab_expansion_info_.find(row);
-  if (line_map_it == tab_expansion_info_.end()) return col;
-  const absl::btree_map<int, int> &map = line_map_it->second.extra_spaces;
-  auto it = map.upper_bound(col);
-  if (it == map.begin()) return col;
+  const auto begin = tabs_.begin() + line_tabs_[row];
+  const auto end = tabs_.begin() + line_tabs_[row + 1];
+  // The last tab at or before the column.
+  auto it = std::upper_bound(begin, end, col, [](int c, const Tab &t) { return c < t.col; });
+  if (it == begin) return col;
   it--;
-  return col + it->second;
+  return col + it->extra;
 }
 
 } // namespace sv
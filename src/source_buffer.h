@@ -1,33 +1,39 @@
 #pragma once
 
-#include "absl/container/btree_map.h"
-#include "absl/container/flat_hash_map.h"
+#include <cstddef>
 #include <string_view>
+#include <vector>
 
 namespace sv {
 
+// Splits a source file into lines, and tracks where tabs are expanded when displaying them.
 class SourceBuffer {
  public:
+  // The buffer is not copied, so it has to outlive the lines.
   void ProcessBuffer(std::string_view buf);
-  bool Empty() const { return lines_.empty(); }
-  int NumLines() const { return lines_.size(); }
-  std::string_view operator[](int n) const { return lines_[n]; }
+  bool Empty() const { return line_starts_.empty(); }
+  int NumLines() const { return line_starts_.size(); }
+  std::string_view operator[](int n) const {
+    return buf_.substr(line_starts_[n], line_ends_[n] - line_starts_[n]);
+  }
   // Returns the length of the given source line, accounting for tab expansion.
   int LineLength(int n) const;
   // Compute the column location of the given location, accounting for tab expansion.
   int DisplayCol(int row, int col) const;
 
-  // Allow for range based iteration
-  std::vector<std::string_view>::iterator begin() { return lines_.begin(); }
-  std::vector<std::string_view>::iterator end() { return lines_.end(); }
-
  private:
-  std::vector<std::string_view> lines_;
-  struct TabInfo {
-    int line_length;
-    absl::btree_map<int, int> extra_spaces;
+  std::string_view buf_;
+  // Offsets of the start and end of each line, without the line ending.
+  std::vector<size_t> line_starts_;
+  std::vector<size_t> line_ends_;
+  struct Tab {
+    int col;   // Column just after the tab.
+    int extra; // Display columns added by this and the earlier tabs on the line.
   };
-  absl::flat_hash_map<int, TabInfo> tab_expansion_info_;
+  // The tabs of all lines in order, and where the tabs of each line start in there. The last entry
+  // is where the tabs of the next line would start.
+  std::vector<Tab> tabs_;
+  std::vector<int> line_tabs_;
 };
 
 } // namespace sv
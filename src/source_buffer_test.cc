@@ -2,9 +2,68 @@
 
 #include "external/googletest/googletest/include/gtest/gtest.h"
 
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
 namespace sv {
 namespace {
 
+// Straightforward line splitting and tab expansion, to compare against.
+struct ReferenceLine {
+  std::string_view text;
+  std::vector<int> display_cols; // One per character, plus the line length.
+};
+std::vector<ReferenceLine> ReferenceLines(std::string_view buf) {
+  if (!buf.empty() && buf.back() == '\0') buf.remove_suffix(1);
+  std::vector<ReferenceLine> lines;
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    const size_t end = std::min(buf.find_first_of("\r\n", pos), buf.size());
+    ReferenceLine &line = lines.emplace_back();
+    line.text = buf.substr(pos, end - pos);
+    int col = 0;
+    for (const char c : line.text) {
+      line.display_cols.push_back(col);
+      col += c == '\t' ? 4 - col % 4 : 1;
+    }
+    line.display_cols.push_back(col);
+    pos = end + 1;
+    if (end + 1 < buf.size() && buf[end] == '\r' && buf[end + 1] == '\n') pos++;
+  }
+  return lines;
+}
+
+void ExpectMatchesReference(const SourceBuffer &sb, std::string_view buf) {
+  const std::vector<ReferenceLine> lines = ReferenceLines(buf);
+  ASSERT_EQ(sb.NumLines(), lines.size());
+  for (int i = 0; i < lines.size(); ++i) {
+    ASSERT_EQ(sb[i], lines[i].text) << "line " << i;
+    ASSERT_EQ(sb.LineLength(i), lines[i].display_cols.back()) << "line " << i;
+    for (int col = 0; col < lines[i].text.size(); ++col) {
+      ASSERT_EQ(sb.DisplayCol(i, col), lines[i].display_cols[col])
+          << "line " << i << " col " << col;
+    }
+  }
+}
+
+// Tab-indented lines that look a bit like generated RTL, with some tabs further in as well.
+std::string GenerateSource(int num_lines, std::string_view line_ending) {
+  std::mt19937 rng(1234);
+  std::string src;
+  for (int i = 0; i < num_lines; ++i) {
+    src.append(rng() % 5, '\t');
+    src += "assign wire_" + std::to_string(i) + " =";
+    if (rng() % 3 == 0) src += '\t';
+    src += " reg_" + std::to_string(rng() % 1000) + " & mask_" + std::to_string(i % 64) + ";";
+    if (rng() % 4 == 0) src += "\t// comment";
+    src += line_ending;
+  }
+  return src;
+}
+
 TEST(SourceBuffer, Basic) {
   constexpr std::string_view src = R"(line 1
 line 2
@@ -62,5 +121,48 @@ TEST(SourceBuffer, Tabs) {
   }
 }
 
+TEST(SourceBuffer, LineEndings) {
+  constexpr std::string_view src = "a\r\nb\rc\n\r\n\r\rd\te\0";
+  SourceBuffer sb;
+  sb.ProcessBuffer(src);
+  ExpectMatchesReference(sb, src);
+  ASSERT_EQ(sb.NumLines(), 7);
+  ASSERT_EQ(sb[6], "d\te");
+}
+
+TEST(SourceBuffer, MatchesReference) {
+  for (const std::string_view line_ending : {"\n", "\r\n", "\r"}) {
+    const std::string src = GenerateSource(2000, line_ending) + "\tlast\tline";
+    SourceBuffer sb;
+    sb.ProcessBuffer(src);
+    ExpectMatchesReference(sb, src);
+  }
+}
+
+// Not much of a test, but shows how long large files take to open and draw. Disabled since it
+// generates a large file; run it with --gtest_also_run_disabled_tests.
+TEST(SourceBuffer, DISABLED_Throughput) {
+  const std::string src = GenerateSource(500'000, "\n");
+  SourceBuffer sb;
+  const auto start = std::chrono::steady_clock::now();
+  sb.ProcessBuffer(src);
+  const auto processed = std::chrono::steady_clock::now();
+  // Like drawing every character of the file.
+  int64_t sum = 0;
+  for (int i = 0; i < sb.NumLines(); ++i) {
+    for (int col = 0; col < sb[i].size(); ++col) {
+      sum += sb.DisplayCol(i, col);
+    }
+  }
+  const auto drawn = std::chrono::steady_clock::now();
+  ASSERT_EQ(sb.NumLines(), 500'000);
+  ASSERT_GT(sum, 0);
+  const auto ms = [](auto duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  };
+  std::cout << "Processed " << src.size() / 1e6 << "MB in " << ms(processed - start)
+            << "ms, display columns of all characters in " << ms(drawn - processed) << "ms\n";
+}
+
 } // namespace
 } // namespace sv
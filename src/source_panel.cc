@@ -27,8 +27,14 @@
 #include "workspace.h"
 
 #include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <curses.h>
-#include <curses.h>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <sstream>
 #include <string_view>
 
 namespace sv {
@@ -36,11 +42,18 @@ namespace {
 
 constexpr int kMaxStateStackSize = 500;
 constexpr int kTabSize = 4;
+// Waves are loaded over this fraction of the full time range, around the wave cursor.
+constexpr int kWaveWindowFraction = 64;
+constexpr uint64_t kMaxWaveWindowSpans = 4;
+// Memory limit of the cached source info of recently shown scopes.
+constexpr size_t kSourceInfoCacheBytes = size_t{128} << 20;
+// Most scopes prefetched at once, so that a long list doesn't hold up the next one shown.
+constexpr int kMaxPrefetchScopes = 16;
 
 } // namespace
 
-void SourcePanel::FindSymbols() {
-  const slang::ast::Symbol &top = scope_->asSymbol();
+void SourcePanel::FindSymbols(const slang::ast::Scope *scope, SourceInfoMap *info) {
+  const slang::ast::Symbol &top = scope->asSymbol();
   // Token visitor that finds all identifiers or one particular one based on a string match.
   struct NamedTokenFinder : public slang::syntax::SyntaxVisitor<NamedTokenFinder> {
     std::string_view name_;
@@ -58,8 +71,8 @@ void SourcePanel::FindSymbols() {
   // AST Visitor that finds all navigable things.
   class NavFinder : public slang::ast::ASTVisitor<NavFinder, slang::ast::VisitFlags::AllGood> {
    public:
-    NavFinder(SourcePanel *p)
-        : panel_(p), visible_buffer_(panel_->scope_->asSymbol().location.buffer()) {}
+    NavFinder(const slang::ast::Scope *scope, SourceInfoMap *info)
+        : info_(info), visible_buffer_(scope->asSymbol().location.buffer()) {}
     // Avoid recursing into any instances.
     void handle(const slang::ast::InstanceSymbol &inst) {
       // For array instances, save the location of the array instance, but link to the first actual
@@ -137,7 +150,7 @@ void SourcePanel::FindSymbols() {
     }
 
    private:
-    SourcePanel *panel_;
+    SourceInfoMap *info_;
     const slang::BufferID visible_buffer_;
     const slang::SourceManager *sm_ = Workspace::Get().SourceManager();
     // Save all parameters encountered, to allow for parameter lookup.
@@ -153,8 +166,7 @@ void SourcePanel::FindSymbols() {
       const int line = sm_->getLineNumber(loc_sym.location) - 1;
       const size_t start_col = sm_->getColumnNumber(loc_sym.location) - 1;
       const size_t end_col = start_col + loc_sym.name.size() - 1;
-      panel_->src_info_[line].insert(
-          {.start_col = start_col, .end_col = end_col, .sym = &link_sym});
+      (*info_)[line].insert({.start_col = start_col, .end_col = end_col, .sym = &link_sym});
     }
     // Common variant for when location and to-be-linked item are one and the same.
     void AddNav(const slang::ast::Symbol &sym) { AddNav(sym, sym); }
@@ -169,7 +181,7 @@ void SourcePanel::FindSymbols() {
           const int line = sm_->getLineNumber(tok.location()) - 1;
           const size_t start_col = sm_->getColumnNumber(tok.location()) - 1;
           const size_t end_col = start_col + sym->name.size() - 1;
-          panel_->src_info_[line].insert({.start_col = start_col, .end_col = end_col, .sym = sym});
+          (*info_)[line].insert({.start_col = start_col, .end_col = end_col, .sym = sym});
         });
         expr.syntax->visit(tf);
       } else {
@@ -188,7 +200,7 @@ void SourcePanel::FindSymbols() {
           start_col += sym_loc;
           end_col = start_col + sym->name.size() - 1;
         }
-        panel_->src_info_[line].insert({.start_col = start_col, .end_col = end_col, .sym = sym});
+        (*info_)[line].insert({.start_col = start_col, .end_col = end_col, .sym = sym});
       }
     }
     void FindParametersInTokens(const slang::syntax::SyntaxNode *node) {
@@ -199,40 +211,38 @@ void SourcePanel::FindSymbols() {
           const int line = sm_->getLineNumber(tok.location()) - 1;
           const size_t start_col = sm_->getColumnNumber(tok.location()) - 1;
           const size_t end_col = start_col + it->second->name.size() - 1;
-          panel_->src_info_[line].insert(
-              {.start_col = start_col, .end_col = end_col, .sym = it->second});
+          (*info_)[line].insert({.start_col = start_col, .end_col = end_col, .sym = it->second});
         }
       });
       node->visit(tf);
     }
   };
-  NavFinder finder(this);
+  NavFinder finder(scope, info);
   top.visit(finder);
 }
 
-void SourcePanel::FindKeywordsAndComments() {
+void SourcePanel::FindKeywordsAndComments(const slang::ast::Scope *scope, SourceInfoMap *info) {
   // Iterate over all tokens to find keywords and comments.
   struct TokenVisitor : public slang::syntax::SyntaxVisitor<TokenVisitor> {
     const slang::SourceManager *sm_ = Workspace::Get().SourceManager();
-    SourcePanel *panel_;
+    SourceInfoMap *info_;
     const slang::BufferID visible_buffer;
-    TokenVisitor(SourcePanel *p)
-        : panel_(p), visible_buffer(panel_->scope_->asSymbol().location.buffer()) {}
+    TokenVisitor(const slang::ast::Scope *scope, SourceInfoMap *info)
+        : info_(info), visible_buffer(scope->asSymbol().location.buffer()) {}
     void visitToken(slang::parsing::Token tok) {
       // Don't bother with any tokens in different files.
       if (tok.location().buffer() != visible_buffer) return;
       if (slang::parsing::LexerFacts::isKeyword(tok.kind)) {
         const int line = sm_->getLineNumber(tok.location()) - 1;
         const size_t start_col = sm_->getColumnNumber(tok.range().start()) - 1;
-        panel_->src_info_[line].insert({.start_col = start_col,
-                                        .end_col = start_col + tok.rawText().size() - 1,
-                                        .keyword = true});
+        (*info_)[line].insert({.start_col = start_col,
+                               .end_col = start_col + tok.rawText().size() - 1,
+                               .keyword = true});
       }
       slang::SourceLocation loc = tok.location();
       // Iterate from the last trivia, since they all come before the token. This enables
       // determining the characeter locations of the trivia blocks.
-      const slang::BufferID visible_buffer = panel_->scope_->asSymbol().location.buffer();
-      slang::BufferID buffer_id = panel_->scope_->asSymbol().location.buffer();
+      slang::BufferID buffer_id = visible_buffer;
       for (const slang::parsing::Trivia &t : std::views::reverse(tok.trivia())) {
         slang::SourceLocation end_loc;
         if (std::optional<slang::SourceLocation> explicit_loc = t.getExplicitLocation()) {
@@ -262,24 +272,95 @@ void SourcePanel::FindKeywordsAndComments() {
         const size_t end_col = sm_->getColumnNumber(end_loc) - 1;
         if (start_line == end_line) {
           // Single line comments, insert as usual.
-          panel_->src_info_[start_line].insert(
+          (*info_)[start_line].insert(
               {.start_col = start_col, .end_col = end_col, .comment = true});
         } else {
           // Multi-line comments, create an entry for each line.
           for (int line = start_line; line <= end_line; ++line) {
             const size_t a = line == start_line ? start_col : 0;
             const size_t b = line == end_line ? end_col : std::numeric_limits<int>::max();
-            panel_->src_info_[line].insert({.start_col = a, .end_col = b, .comment = true});
+            (*info_)[line].insert({.start_col = a, .end_col = b, .comment = true});
           }
         }
       }
     }
   };
-  scope_->asSymbol().getSyntax()->visit(TokenVisitor(this));
+  scope->asSymbol().getSyntax()->visit(TokenVisitor(scope, info));
+}
+
+std::shared_ptr<const SourcePanel::SourceInfoMap>
+SourcePanel::ComputeSourceInfo(const slang::ast::Scope *scope) {
+  auto info = std::make_shared<SourceInfoMap>();
+  FindSymbols(scope, info.get());
+  FindKeywordsAndComments(scope, info.get());
+  return info;
+}
+
+std::shared_ptr<const SourcePanel::SourceInfoMap>
+SourcePanel::GetSourceInfo(const slang::ast::Scope *scope) {
+  auto it = info_cache_.find(scope);
+  if (it == info_cache_.end()) {
+    std::promise<std::shared_ptr<const SourceInfoMap>> computed;
+    computed.set_value(ComputeSourceInfo(scope));
+    info_lru_.push_front(scope);
+    it = info_cache_
+             .emplace(scope, CachedSourceInfo{.info = computed.get_future().share(),
+                                              .lru_it = info_lru_.begin()})
+             .first;
+  } else {
+    info_lru_.splice(info_lru_.begin(), info_lru_, it->second.lru_it);
+  }
+  std::shared_ptr<const SourceInfoMap> info = it->second.info.get();
+  EvictSourceInfo();
+  return info;
+}
+
+void SourcePanel::PrefetchSourceInfo(const std::vector<const slang::ast::Scope *> &scopes) {
+  int num_prefetched = 0;
+  for (const slang::ast::Scope *scope : scopes) {
+    if (num_prefetched == kMaxPrefetchScopes) break;
+    if (scope == nullptr || info_cache_.contains(scope)) continue;
+    // Visiting the design from another thread than the UI is only safe once it's frozen.
+    if (!scope->getCompilation().isFrozen()) break;
+    auto task = std::make_shared<std::packaged_task<std::shared_ptr<const SourceInfoMap>()>>(
+        [scope] { return ComputeSourceInfo(scope); });
+    info_lru_.push_back(scope);
+    info_cache_.emplace(scope, CachedSourceInfo{.info = task->get_future().share(),
+                                                .lru_it = std::prev(info_lru_.end())});
+    info_pool_.Submit([task] { (*task)(); });
+    num_prefetched++;
+  }
+}
+
+void SourcePanel::EvictSourceInfo() {
+  size_t total_bytes = 0;
+  for (auto lru_it = info_lru_.begin(); lru_it != info_lru_.end();) {
+    CachedSourceInfo &cached = info_cache_.at(*lru_it);
+    // Info that is still being computed can't be measured or dropped yet.
+    if (cached.info.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++lru_it;
+      continue;
+    }
+    if (cached.bytes == 0) {
+      const SourceInfoMap &info = *cached.info.get();
+      cached.bytes = sizeof(SourceInfoMap) + info.capacity() * sizeof(SourceInfoMap::value_type);
+      for (const auto &[line, line_info] : info) {
+        cached.bytes += line_info.size() * sizeof(SourceInfo);
+      }
+    }
+    // The scope that is shown now is always kept.
+    if (total_bytes + cached.bytes > kSourceInfoCacheBytes && lru_it != info_lru_.begin()) {
+      info_cache_.erase(*lru_it);
+      lru_it = info_lru_.erase(lru_it);
+    } else {
+      total_bytes += cached.bytes;
+      ++lru_it;
+    }
+  }
 }
 
 std::optional<std::pair<int, int>> SourcePanel::CursorLocation() const {
-  if (scope_ == nullptr) return std::nullopt;
+  if (scope_ == nullptr && !file_only_) return std::nullopt;
   // Compute width of the line numbers. Minus 1 to account for the header, but
   // plus one since line numbers start at 1. Add one to the final width to
   // account for the line number margin.
@@ -288,10 +369,15 @@ std::optional<std::pair<int, int>> SourcePanel::CursorLocation() const {
 }
 
 void SourcePanel::BuildHeader() {
-  if (scope_ == nullptr) return;
-  std::string scope_name = scope_->asSymbol().getHierarchicalPath();
-  const std::string separator = " | ";
-  header_ = current_file_ + separator + scope_name;
+  if (file_only_) {
+    header_ = current_file_;
+  } else if (scope_ != nullptr) {
+    std::string scope_name = scope_->asSymbol().getHierarchicalPath();
+    const std::string separator = " | ";
+    header_ = current_file_ + separator + scope_name;
+  } else {
+    return;
+  }
   // Attempt to strip as many leading directories from the front of the header
   // until it fits. If it still doesn't fit then oh well, it will get cut off
   // in the Draw funtion.
@@ -320,7 +406,7 @@ void SourcePanel::BuildHeader() {
 void SourcePanel::Draw() {
   werase(w_);
   wattrset(w_, A_NORMAL);
-  if (scope_ == nullptr) {
+  if (scope_ == nullptr && !file_only_) {
     mvwprintw(w_, 0, 0, "Module instance source code appears here.");
     return;
   }
@@ -335,6 +421,7 @@ void SourcePanel::Draw() {
     mvwprintw(w_, 1, 0, "Unable to open file");
     return;
   }
+  LoadVisibleWaves();
   const auto highlight_attr = (!search_preview_ && has_focus_) ? A_REVERSE : A_UNDERLINE;
   int sel_pos = 0; // Save selection start position.
   for (int y = 1; y < win_h; ++y) {
@@ -361,9 +448,9 @@ void SourcePanel::Draw() {
     // work no matter the horizontal scrolling.
     int screen_x = -scroll_col_ + max_digits + 1;
     int pos = 0;
-    auto line_it = src_info_.find(line_idx);
+    auto line_it = src_info_->find(line_idx);
     std::optional<absl::btree_set<SourceInfo>::iterator> info_it_or_null;
-    if (line_it != src_info_.end()) info_it_or_null = line_it->second.begin();
+    if (line_it != src_info_->end()) info_it_or_null = line_it->second.begin();
 
     while (screen_x < win_w) {
       bool end_of_color = false;
@@ -505,7 +592,7 @@ void SourcePanel::Draw() {
 }
 
 void SourcePanel::UIChar(int ch) {
-  if (scope_ == nullptr) return;
+  if (scope_ == nullptr && !file_only_) return;
   const int win_w = getmaxx(w_);
   const int win_h = getmaxy(w_);
   const int ruler_size = NumDecimalDigits(win_h + scroll_row_ - 1) + 1;
@@ -516,6 +603,7 @@ void SourcePanel::UIChar(int ch) {
   case 'g': SetLineAndScroll(start_line_); break;
   case 'G': SetLineAndScroll(end_line_); break;
   case 'u': {
+    if (scope_ == nullptr) break;
     if (scope_->asSymbol().getHierarchicalParent()->asSymbol().kind ==
         slang::ast::SymbolKind::Root) {
       error_message_ = "This is a top level module.";
@@ -593,14 +681,47 @@ void SourcePanel::UIChar(int ch) {
   case 'L':
     if (sel_ != nullptr) {
       const bool trace_drivers = ch == 'D';
-      if (trace_drivers) {
+      if (const DriverLoadIndex *index = Workspace::Get().DriverLoads()) {
+        drivers_or_loads_ = trace_drivers ? index->Drivers(sel_) : index->Loads(sel_);
+      } else if (trace_drivers) {
+        // The index is still being built.
         drivers_or_loads_ = GetDrivers(sel_);
       } else {
         drivers_or_loads_ = GetLoads(sel_);
       }
+      trace_nets_.clear();
+      trace_idx_ = 0;
+      if (!drivers_or_loads_.empty()) {
+        ShowTrace();
+      } else {
+        error_message_ = trace_drivers ? "No drivers found." : "No loads found.";
+      }
+    }
+    break;
+  case '<':
+  case '>':
+    if (sel_ != nullptr) {
+      const DriverLoadIndex *index = Workspace::Get().DriverLoads();
+      if (index == nullptr) {
+        error_message_ = "Still indexing the design, try again shortly.";
+        break;
+      }
+      const bool trace_drivers = ch == '<';
+      const auto &endpoints =
+          trace_drivers ? index->UltimateDrivers(sel_) : index->UltimateLoads(sel_);
+      drivers_or_loads_.clear();
+      trace_nets_.clear();
+      std::vector<const slang::ast::Scope *> trace_scopes;
+      for (const DriverLoadIndex::Endpoint &e : endpoints) {
+        drivers_or_loads_.push_back(e.where);
+        trace_nets_.push_back(e.net);
+        trace_scopes.push_back(GetScopeForUI(e.net));
+      }
+      // Cycling through them is likely to show the other scopes next.
+      PrefetchSourceInfo(trace_scopes);
       trace_idx_ = 0;
       if (!drivers_or_loads_.empty()) {
-        std::visit([&](auto &&port_or_name) { SetLocation(port_or_name); }, drivers_or_loads_[0]);
+        ShowTrace();
       } else {
         error_message_ = trace_drivers ? "No drivers found." : "No loads found.";
       }
@@ -610,8 +731,7 @@ void SourcePanel::UIChar(int ch) {
     if (drivers_or_loads_.empty()) break;
     trace_idx_++;
     if (trace_idx_ == drivers_or_loads_.size()) trace_idx_ = 0;
-    std::visit([&](auto &&port_or_name) { SetLocation(port_or_name); },
-               drivers_or_loads_[trace_idx_]);
+    ShowTrace();
     break;
   case 'v':
     show_vals_ = !show_vals_;
@@ -640,7 +760,7 @@ void SourcePanel::UIChar(int ch) {
     } else {
       // Go back in the stack if possible.
       if (stack_idx_ == 0) break;
-      if (stack_idx_ == state_stack_.size()) {
+      if (stack_idx_ == state_stack_.size() && scope_ != nullptr) {
         // If not currently doing any kind of stack navigation, get the top of
         // the stack as the new item, but save the current one.
         auto s = state_stack_[stack_idx_ - 1];
@@ -658,7 +778,7 @@ void SourcePanel::UIChar(int ch) {
   }
   case 'p':
     // Go to the next highlightable thing.
-    if (auto it = src_info_.find(line_idx_); it != src_info_.end()) {
+    if (auto it = src_info_->find(line_idx_); it != src_info_->end()) {
       for (const SourceInfo &info : it->second) {
         if (info.start_col > col_idx_) {
           col_idx_ = info.start_col;
@@ -705,8 +825,8 @@ void SourcePanel::UIChar(int ch) {
 
 void SourcePanel::SelectItem() {
   sel_ = nullptr;
-  const auto it = src_info_.find(line_idx_);
-  if (it == src_info_.end()) return;
+  const auto it = src_info_->find(line_idx_);
+  if (it == src_info_->end()) return;
   for (const SourceInfo &info : it->second) {
     if (info.sym != nullptr && col_idx_ >= info.start_col && col_idx_ <= info.end_col) {
       sel_ = info.sym;
@@ -736,6 +856,19 @@ std::optional<const slang::ast::Symbol *> SourcePanel::ItemForWaves() {
   return item;
 }
 
+void SourcePanel::ShowTrace() {
+  // Traces across the hierarchy can end up in other instances.
+  if (trace_idx_ < trace_nets_.size()) {
+    const slang::ast::Symbol *net = trace_nets_[trace_idx_];
+    if (GetScopeForUI(net) != scope_) {
+      SetItem(net);
+      item_for_design_tree_ = &scope_->asSymbol();
+    }
+  }
+  std::visit([&](auto &&port_or_name) { SetLocation(port_or_name); },
+             drivers_or_loads_[trace_idx_]);
+}
+
 void SourcePanel::SetLocation(int line, int col) {
   // Avoid history entries on the same line.
   if (line_idx_ != line) SaveState();
@@ -785,13 +918,12 @@ void SourcePanel::SetItem(const slang::ast::Symbol *item, bool save_state) {
   if (save_state && scope_ != nullptr) SaveState();
 
   scope_ = GetScopeForUI(item);
-  // Clear out old info.
-  src_info_.clear();
+  file_only_ = false;
+  file_text_.clear();
   sel_ = nullptr;
   // tokenizer_ = SimpleTokenizer();
 
-  FindSymbols();
-  FindKeywordsAndComments();
+  src_info_ = GetSourceInfo(scope_);
   //  Extract the lines as individial string_views.
   const slang::ast::Symbol *sym = &scope_->asSymbol();
   const slang::SourceManager *sm = Workspace::Get().SourceManager();
@@ -802,31 +934,91 @@ void SourcePanel::SetItem(const slang::ast::Symbol *item, bool save_state) {
   end_line_ = sm->getLineNumber(sym->getSyntax()->sourceRange().end());
   col_idx_ = src_.DisplayCol(line_idx, sm->getColumnNumber(item->location) - 1);
   max_col_idx_ = col_idx_;
-  current_file_ = sm->getFileName(sym->location);
+  current_file_ = Workspace::Get().FileName(sym->location);
 
   SetLineAndScroll(line_idx);
   BuildHeader();
-  // TODO: This is overkill, reading all wave data on every item set.
-  UpdateWaveData();
 }
 
-void SourcePanel::UpdateWaveData() {
-  WaveData *waves = Workspace::Get().Waves();
-  if (waves == nullptr) return;
-  // Iterate over all variables/nets
+void SourcePanel::SetFileLocation(const std::string &file_name, int line,
+                                  std::string_view identifier) {
+  std::ifstream file(file_name);
+  if (!file.is_open()) {
+    error_message_ = "Unable to open " + file_name;
+    return;
+  }
+  // Allow going back to the design view.
+  if (scope_ != nullptr) SaveState();
+  std::stringstream ss;
+  ss << file.rdbuf();
+  file_text_ = ss.str();
+  file_only_ = true;
+  scope_ = nullptr;
+  sel_ = nullptr;
+  src_info_ = std::make_shared<const SourceInfoMap>();
+  drivers_or_loads_.clear();
+  src_.ProcessBuffer(file_text_);
+  current_file_ = file_name;
+  start_line_ = 1;
+  end_line_ = src_.NumLines();
+  // Attributes in the wave file may point at the enclosing module rather than the declaration
+  // itself, so look for the first whole-word occurrence of the identifier from there.
+  int line_idx = std::clamp(line - 1, 0, std::max(0, src_.NumLines() - 1));
+  int col = 0;
+  const auto is_ident_char = [](char c) { return std::isalnum(c) || c == '_' || c == '$'; };
+  for (int l = line_idx; !identifier.empty() && l < src_.NumLines(); ++l) {
+    const std::string_view s = src_[l];
+    size_t pos = s.find(identifier);
+    while (pos != std::string_view::npos) {
+      const size_t end = pos + identifier.size();
+      if ((pos == 0 || !is_ident_char(s[pos - 1])) && (end >= s.size() || !is_ident_char(s[end]))) {
+        break;
+      }
+      pos = s.find(identifier, pos + 1);
+    }
+    if (pos != std::string_view::npos) {
+      line_idx = l;
+      col = pos;
+      break;
+    }
+  }
+  col_idx_ = src_.DisplayCol(line_idx, col);
+  SetLineAndScroll(line_idx);
+  BuildHeader();
+}
+
+void SourcePanel::LoadVisibleWaves() {
+  const WaveData *waves = Workspace::Get().Waves();
+  if (waves == nullptr || src_info_->empty()) return;
+  const auto [first, last] = waves->TimeRange();
+  const uint64_t cursor = std::clamp(Workspace::Get().WaveCursorTime(), first, last);
   std::vector<const WaveData::Signal *> signals;
-  for (const auto &[line, info_list] : src_info_) {
-    for (const SourceInfo &info : info_list) {
+  const int end_line = scroll_row_ + getmaxy(w_) - 1;
+  for (int line = scroll_row_; line < end_line; ++line) {
+    const auto it = src_info_->find(line);
+    if (it == src_info_->end()) continue;
+    for (const SourceInfo &info : it->second) {
       if (!info.sym) continue;
       // Don't bother loading wave data for parameters.
       if (info.sym->kind == slang::ast::SymbolKind::Parameter) continue;
-      std::vector<const WaveData::Signal *> signals_for_item =
-          Workspace::Get().DesignToSignals(info.sym);
-      signals.insert(signals.end(), signals_for_item.begin(), signals_for_item.end());
+      for (const WaveData::Signal *signal : Workspace::Get().DesignToSignals(info.sym)) {
+        if (!waves->SamplesValid(signal, cursor, cursor)) signals.push_back(signal);
+      }
     }
   }
-  // TODO: Loading for the full range here. Is there a way to bound it?
-  waves->LoadSignalSamples(signals, waves->TimeRange().first, waves->TimeRange().second);
+  if (signals.empty()) return;
+  const uint64_t span = std::max<uint64_t>(1, (last - first) / kWaveWindowFraction);
+  const uint64_t start = cursor - std::min(cursor - first, span / 2);
+  const uint64_t end = std::min(last, cursor + span / 2);
+  // The window grows while the cursor moves around in it, up to a few spans.
+  if (wave_window_ && start <= wave_window_->second + span && end + span >= wave_window_->first &&
+      std::max(end, wave_window_->second) - std::min(start, wave_window_->first) <=
+          kMaxWaveWindowSpans * span) {
+    wave_window_ = {std::min(start, wave_window_->first), std::max(end, wave_window_->second)};
+  } else {
+    wave_window_ = {start, end};
+  }
+  waves->LoadSignalWindow(signals, wave_window_->first, wave_window_->second);
 }
 
 bool SourcePanel::Search(bool search_down) {
@@ -903,6 +1095,7 @@ std::vector<Tooltip> SourcePanel::Tooltips() const {
   tt.push_back({"d", "goto def"});
   tt.push_back({"D", "drivers"});
   tt.push_back({"L", "loads"});
+  tt.push_back({"<>", "drivers/loads thru ports"});
   tt.push_back({"c", "cycle DL"});
   tt.push_back({"b", "back"});
   tt.push_back({"f", "forward"});
@@ -916,12 +1109,21 @@ void SourcePanel::PrepareForDesignReload() {
   state_stack_.clear();
   reload_path_.clear();
   drivers_or_loads_.clear();
-  src_info_.clear();
+  trace_nets_.clear();
+  src_info_ = std::make_shared<const SourceInfoMap>();
+  // Cached info points into the old design.
+  info_pool_.Wait();
+  info_cache_.clear();
+  info_lru_.clear();
   reload_line_idx_ = line_idx_;
   if (scope_ != nullptr) reload_path_ = scope_->asSymbol().getHierarchicalPath();
   scope_ = nullptr;
 }
 
+void SourcePanel::PrepareForWaveDataReload() {
+  wave_window_.reset();
+}
+
 void SourcePanel::HandleReloadedDesign() {
   if (reload_path_.empty()) return;
   size_t limit = reload_path_.size();
@@ -3,12 +3,19 @@
 #include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
 #include "panel.h"
+#include "parallel.h"
 #include "slang/ast/Expression.h"
 #include "slang/ast/Symbol.h"
 #include "source_buffer.h"
 #include "slang_utils.h"
 
+#include <cstdint>
 #include <deque>
+#include <future>
+#include <list>
+#include <memory>
+#include <optional>
+#include <utility>
 #include <vector>
 
 namespace sv {
@@ -22,6 +29,9 @@ class SourcePanel : public Panel {
   std::optional<std::pair<int, int>> CursorLocation() const final;
   std::vector<Tooltip> Tooltips() const final;
   void SetItem(const slang::ast::Symbol *item);
+  // Shows a plain source file without any design information, with the cursor on the first
+  // occurrence of the identifier at or after the given line (1-based).
+  void SetFileLocation(const std::string &file_name, int line, std::string_view identifier);
   std::pair<int, int> ScrollArea() const final;
   std::optional<const slang::ast::Symbol *> ItemForDesignTree();
   std::optional<const slang::ast::Symbol *> ItemForWaves();
@@ -32,6 +42,7 @@ class SourcePanel : public Panel {
   void Resized() final;
   void PrepareForDesignReload() final;
   void HandleReloadedDesign() final;
+  void PrepareForWaveDataReload() final;
 
  private:
   void SaveState();
@@ -48,14 +59,18 @@ class SourcePanel : public Panel {
   void SelectItem();
   // Generates a nice header that probably fits in the current window width.
   void BuildHeader();
-  // Read all wave data for the nets in the current item.
-  void UpdateWaveData();
+  // Reads the waves of the visible nets that have no samples at the wave cursor yet, over a window
+  // of time around it.
+  void LoadVisibleWaves();
 
   // Textual representation of the current item. For things like nets the
   // containing scope is used.
   std::string header_;
   // Show values of highlighted items or not.
   bool show_vals_ = true;
+  // Time window that waves were last loaded over. It grows while the cursor moves around in it, and
+  // moves along when the cursor jumps further away.
+  std::optional<std::pair<uint64_t, uint64_t>> wave_window_;
   // State for tracking horizontal scrolling.
   // TODO: See what can be moved to the Panel class.
   int max_col_idx_ = 0;
@@ -68,6 +83,9 @@ class SourcePanel : public Panel {
   // selected item (this could be the complete instance itself too).
   std::string current_file_;
   SourceBuffer src_;
+  // When showing a file that is not associated with any design scope, the text is held here.
+  bool file_only_ = false;
+  std::string file_text_;
   // Store all relevant sections of each line for syntax highlighting and design tracing.
   struct SourceInfo {
     size_t start_col, end_col;
@@ -76,9 +94,28 @@ class SourcePanel : public Panel {
     const bool comment = false;
     bool operator<(const SourceInfo &rhs) const { return start_col < rhs.start_col; }
   };
-  absl::flat_hash_map<int, absl::btree_set<SourceInfo>> src_info_;
-  void FindSymbols();
-  void FindKeywordsAndComments();
+  using SourceInfoMap = absl::flat_hash_map<int, absl::btree_set<SourceInfo>>;
+  // Never null, and shared with the cache below.
+  std::shared_ptr<const SourceInfoMap> src_info_ = std::make_shared<const SourceInfoMap>();
+  static void FindSymbols(const slang::ast::Scope *scope, SourceInfoMap *info);
+  static void FindKeywordsAndComments(const slang::ast::Scope *scope, SourceInfoMap *info);
+  static std::shared_ptr<const SourceInfoMap> ComputeSourceInfo(const slang::ast::Scope *scope);
+  // Source info of the scope, from the cache if it's there. Waits for it if it's still being
+  // computed in the background.
+  std::shared_ptr<const SourceInfoMap> GetSourceInfo(const slang::ast::Scope *scope);
+  // Starts computing the source info of scopes that are likely to be shown next, if the compilation
+  // is frozen. Otherwise they are computed when shown.
+  void PrefetchSourceInfo(const std::vector<const slang::ast::Scope *> &scopes);
+  // Drops the least recently shown scopes while the cache is over its memory limit.
+  void EvictSourceInfo();
+  struct CachedSourceInfo {
+    std::shared_future<std::shared_ptr<const SourceInfoMap>> info;
+    std::list<const slang::ast::Scope *>::iterator lru_it;
+    size_t bytes = 0; // Estimate, zero until the info is ready.
+  };
+  // Most recently shown first, with prefetched scopes at the end until they are shown.
+  std::list<const slang::ast::Scope *> info_lru_;
+  absl::flat_hash_map<const slang::ast::Scope *, CachedSourceInfo> info_cache_;
   // Limits active scope, for example files with more than one module
   // definition. Text rendering uses this grey out source outside this.
   int start_line_ = 0;
@@ -90,6 +127,10 @@ class SourcePanel : public Panel {
   // Drivers and loads
   int trace_idx_;
   std::vector<SlangDriverOrLoad> drivers_or_loads_;
+  // For traces across the hierarchy, the net of each driver or load, to find its instance.
+  std::vector<const slang::ast::Symbol *> trace_nets_;
+  // Moves to the current driver or load, switching to its scope if needed.
+  void ShowTrace();
 
   // Stack of states, to allow going back/forth while browsing source.
   struct State {
@@ -105,6 +146,8 @@ class SourcePanel : public Panel {
   // after the reload has finished.
   std::string reload_path_;
   int reload_line_idx_ = 0;
+  // Computes prefetched source info. Last, so that it stops before anything else goes away.
+  WorkerPool info_pool_{1};
 };
 
 } // namespace sv
@@ -0,0 +1,143 @@
+#include "table_overlay.h"
+
+#include "color.h"
+
+#include <algorithm>
+
+namespace sv {
+
+namespace {
+// Rows taken by the title and the header.
+constexpr int kHeaderRows = 2;
+constexpr int kColumnGap = 2;
+} // namespace
+
+TableOverlay::TableOverlay(const std::string &title, const std::vector<std::string> &header)
+    : title_(title), header_(header) {
+  for (const auto &h : header_) {
+    col_widths_.push_back(h.size());
+  }
+}
+
+TableOverlay::TableOverlay(const std::string &title, const std::vector<std::string> &header,
+                           int num_rows, RowSource source)
+    : TableOverlay(title, header) {
+  num_rows_ = num_rows;
+  source_ = std::move(source);
+}
+
+void TableOverlay::UpdateWidths(const std::vector<std::string> &cells) const {
+  for (int i = 0; i < cells.size() && i < col_widths_.size(); ++i) {
+    col_widths_[i] = std::max<int>(col_widths_[i], cells[i].size());
+  }
+}
+
+void TableOverlay::AddRow(const std::vector<std::string> &cells, std::optional<uint64_t> time) {
+  rows_.push_back(cells);
+  times_.push_back(time);
+  UpdateWidths(cells);
+}
+
+void TableOverlay::Fetch(int first, int count) const {
+  count = std::min(count, num_rows_ - first);
+  if (!source_ || count <= 0) return;
+  if (first >= first_row_ && first + count <= first_row_ + rows_.size()) return;
+  rows_.clear();
+  times_.clear();
+  first_row_ = first;
+  source_(first, count, &rows_, &times_);
+  for (const auto &cells : rows_) {
+    UpdateWidths(cells);
+  }
+}
+
+std::optional<uint64_t> TableOverlay::SelectedTime() const {
+  if (NumRows() == 0) return std::nullopt;
+  Fetch(sel_, 1);
+  return times_[sel_ - first_row_];
+}
+
+void TableOverlay::Draw(WINDOW *w) const {
+  const int max_w = getmaxx(w);
+  const int max_h = getmaxy(w);
+  page_rows_ = std::max(1, max_h - kHeaderRows);
+  const auto draw_cells = [&](int row, const std::vector<std::string> &cells) {
+    wmove(w, row, 0);
+    int x = 0;
+    for (int i = 0; i < cells.size() && i < col_widths_.size(); ++i) {
+      std::string s = cells[i];
+      s.resize(col_widths_[i] + kColumnGap, ' ');
+      for (const char c : s) {
+        if (x++ >= max_w) return;
+        waddch(w, c);
+      }
+    }
+    while (x++ < max_w) waddch(w, ' ');
+  };
+  // Widths of the fetched rows need to be known before the header is drawn.
+  Fetch(scroll_, page_rows_);
+  SetColor(w, kSourceHeaderPair);
+  wmove(w, 0, 0);
+  for (int x = 0; x < max_w; ++x) {
+    waddch(w, x < title_.size() ? title_[x] : ' ');
+  }
+  SetColor(w, kWavesSignalNamePair);
+  wattron(w, A_BOLD);
+  draw_cells(1, header_);
+  wattroff(w, A_BOLD);
+  SetColor(w, kWavesSignalValuePair);
+  for (int row = kHeaderRows; row < max_h; ++row) {
+    const int idx = scroll_ + row - kHeaderRows;
+    if (idx >= NumRows()) break;
+    if (idx == sel_) wattron(w, A_REVERSE);
+    draw_cells(row, rows_[idx - first_row_]);
+    wattroff(w, A_REVERSE);
+  }
+}
+
+TableOverlay::State TableOverlay::HandleKey(int key) {
+  const int last = std::max(0, NumRows() - 1);
+  switch (key) {
+  case 'k':
+  case 0x103: // up
+    sel_ = std::max(0, sel_ - 1);
+    break;
+  case 'j':
+  case 0x102: // down
+    sel_ = std::min(last, sel_ + 1);
+    break;
+  case 0x15:  // Ctrl-U
+  case 0x153: // PgUp
+    sel_ = std::max(0, sel_ - page_rows_);
+    break;
+  case 0x4:   // Ctrl-D
+  case 0x152: // PgDn
+    sel_ = std::min(last, sel_ + page_rows_);
+    break;
+  case 'g': sel_ = 0; break;
+  case 'G': sel_ = last; break;
+  case 0xd: // Enter
+    if (SelectedTime()) return kSelected;
+    break;
+  case 'q':
+  case 0x1b: // Escape
+    return kClosed;
+  }
+  ScrollToSelection();
+  return kOpen;
+}
+
+void TableOverlay::Select(int row) {
+  sel_ = std::clamp(row, 0, std::max(0, NumRows() - 1));
+  ScrollToSelection();
+}
+
+void TableOverlay::ScrollToSelection() {
+  if (sel_ < scroll_) {
+    scroll_ = sel_;
+  } else if (sel_ >= scroll_ + page_rows_) {
+    scroll_ = sel_ - page_rows_ + 1;
+  }
+}
+
+} // namespace sv
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <curses.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace sv {
+
+// A scrollable table that a panel draws in place of its normal contents, for reports such as
+// signal statistics. Rows can have a time, so that picking one can move the wave cursor there.
+class TableOverlay {
+ public:
+  enum State {
+    kOpen,
+    kClosed,
+    kSelected,
+  };
+  // Appends the cells and time of rows [first, first + count) to the given vectors.
+  using RowSource = std::function<void(int first, int count,
+                                       std::vector<std::vector<std::string>> *rows,
+                                       std::vector<std::optional<uint64_t>> *times)>;
+  TableOverlay(const std::string &title, const std::vector<std::string> &header);
+  // A table whose rows are only produced once they are on screen, for tables too large to build up
+  // front. Columns widen as wider rows are seen.
+  TableOverlay(const std::string &title, const std::vector<std::string> &header, int num_rows,
+               RowSource source);
+  void AddRow(const std::vector<std::string> &cells, std::optional<uint64_t> time = std::nullopt);
+  void Draw(WINDOW *w) const;
+  // Returns the state after the keypress. Enter selects rows that have a time, Escape or q closes.
+  State HandleKey(int key);
+  std::optional<uint64_t> SelectedTime() const;
+  int SelectedRow() const { return sel_; }
+  void Select(int row);
+  int NumRows() const { return source_ ? num_rows_ : rows_.size(); }
+
+ private:
+  // Makes sure rows [first, first + count) are in rows_, getting them from the source if needed.
+  void Fetch(int first, int count) const;
+  void UpdateWidths(const std::vector<std::string> &cells) const;
+  void ScrollToSelection();
+  std::string title_;
+  std::vector<std::string> header_;
+  RowSource source_;
+  int num_rows_ = 0;
+  // With a row source, these hold the rows fetched last, starting at first_row_.
+  mutable std::vector<std::vector<std::string>> rows_;
+  mutable std::vector<std::optional<uint64_t>> times_;
+  mutable int first_row_ = 0;
+  mutable std::vector<int> col_widths_;
+  int sel_ = 0;
+  int scroll_ = 0;
+  // Number of rows that fit, as of the last draw. Used for paging.
+  mutable int page_rows_ = 1;
+};
+
+} // namespace sv
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "wave_data.h"
+
+#include <string>
+#include <vector>
+
+// Waves made up by hand, shared by the tests of the code that works on samples.
+
+namespace sv {
+
+// Wave with a sample every 10 time units, starting at 0.
+inline std::vector<WaveData::Sample> MakeWave(const std::vector<std::string> &values) {
+  std::vector<WaveData::Sample> wave;
+  for (int i = 0; i < values.size(); ++i) {
+    wave.push_back({.time = static_cast<uint64_t>(i * 10), .value = values[i]});
+  }
+  return wave;
+}
+
+// Clock that rises at 5, 15, 25 and so on.
+inline std::vector<WaveData::Sample> MakeClock(int cycles) {
+  std::vector<WaveData::Sample> clock;
+  for (int i = 0; i < cycles; ++i) {
+    clock.push_back({.time = static_cast<uint64_t>(i * 10), .value = "0"});
+    clock.push_back({.time = static_cast<uint64_t>(i * 10 + 5), .value = "1"});
+  }
+  return clock;
+}
+
+} // namespace sv
@@ -0,0 +1,139 @@
+#include "transactions.h"
+
+#include "wave_search.h"
+
+#include <algorithm>
+#include <bit>
+#include <optional>
+
+namespace sv {
+namespace {
+
+bool High(std::string_view value) { return !value.empty() && value.back() == '1'; }
+
+// Walks a wave forward through ascending times, so that a whole pass is linear.
+class Cursor {
+ public:
+  Cursor(const std::vector<WaveData::Sample> &wave, uint64_t start_time) : wave_(wave) {
+    idx_ = std::lower_bound(wave.begin(), wave.end(), start_time,
+                            [](const WaveData::Sample &s, uint64_t t) { return s.time < t; }) -
+           wave.begin() - 1;
+  }
+  // Value just before the time, or at it when inclusive. Empty before the first sample.
+  std::string_view Value(uint64_t time, bool inclusive) {
+    while (idx_ + 1 < wave_.size() &&
+           (wave_[idx_ + 1].time < time || (inclusive && wave_[idx_ + 1].time == time))) {
+      idx_++;
+    }
+    return idx_ < 0 ? std::string_view() : std::string_view(wave_[idx_].value);
+  }
+
+ private:
+  const std::vector<WaveData::Sample> &wave_;
+  int idx_;
+};
+
+} // namespace
+
+void Histogram::Add(uint64_t value) {
+  const int bucket = std::bit_width(value);
+  if (bucket >= buckets_.size()) buckets_.resize(bucket + 1);
+  buckets_[bucket]++;
+  min_ = count_ == 0 ? value : std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+  count_++;
+}
+
+void TransactionTable::Add(uint64_t start_time, uint64_t end_time, uint64_t latency,
+                           const std::vector<std::string_view> &payload) {
+  start_times_.push_back(start_time);
+  end_times_.push_back(end_time);
+  latencies_.push_back(latency);
+  latency_histogram_.Add(latency);
+  for (const std::string_view value : payload) {
+    auto it = value_ids_.find(value);
+    if (it == value_ids_.end()) {
+      // The key refers to the stored copy.
+      values_.emplace_back(value);
+      it = value_ids_.emplace(values_.back(), values_.size() - 1).first;
+    }
+    payload_ids_.push_back(it->second);
+  }
+}
+
+TransactionTable TransactionTable::Extract(const HandshakeWaves &waves, uint64_t start_time,
+                                           uint64_t end_time) {
+  TransactionTable table;
+  table.num_fields_ = waves.payload.size();
+  table.clocked_ = waves.clock != nullptr;
+  std::vector<Cursor> payload;
+  for (const auto *wave : waves.payload) {
+    payload.emplace_back(*wave, start_time);
+  }
+  std::vector<std::string_view> values(payload.size());
+  const auto sample_payload = [&](uint64_t time, bool inclusive) {
+    for (int i = 0; i < payload.size(); ++i) {
+      values[i] = payload[i].Value(time, inclusive);
+    }
+  };
+  // End of the previous transfer, in cycles or time.
+  std::optional<uint64_t> last_end;
+  if (table.clocked_) {
+    const std::vector<uint64_t> edges = RisingEdges(*waves.clock, start_time, end_time);
+    table.span_ = edges.size();
+    Cursor valid(*waves.valid, start_time);
+    Cursor ready(*waves.ready, start_time);
+    // Edge at which the pending transfer was first seen valid.
+    std::optional<int> pending;
+    for (int e = 0; e < edges.size(); ++e) {
+      if (!High(valid.Value(edges[e], /*inclusive*/ false))) {
+        // Valid dropped without a transfer.
+        pending.reset();
+        continue;
+      }
+      if (!pending) pending = e;
+      if (!High(ready.Value(edges[e], /*inclusive*/ false))) continue;
+      sample_payload(edges[e], /*inclusive*/ false);
+      table.Add(edges[*pending], edges[e], e - *pending, values);
+      if (last_end) table.gap_histogram_.Add(e - *last_end);
+      last_end = e;
+      pending.reset();
+    }
+  } else {
+    table.span_ = end_time - start_time;
+    const std::vector<uint64_t> reqs = RisingEdges(*waves.valid, start_time, end_time);
+    const std::vector<uint64_t> acks = RisingEdges(*waves.ready, start_time, end_time);
+    size_t a = 0;
+    for (size_t r = 0; r < reqs.size(); ++r) {
+      while (a < acks.size() && acks[a] < reqs[r]) a++;
+      if (a == acks.size()) break;
+      // An ack after the next request belongs to that one, this request was abandoned.
+      if (r + 1 < reqs.size() && acks[a] >= reqs[r + 1]) continue;
+      sample_payload(reqs[r], /*inclusive*/ true);
+      table.Add(reqs[r], acks[a], acks[a] - reqs[r], values);
+      if (last_end) table.gap_histogram_.Add(acks[a] - *last_end);
+      last_end = acks[a];
+      a++;
+    }
+  }
+  return table;
+}
+
+int TransactionTable::FindTime(uint64_t time) const {
+  return std::lower_bound(start_times_.begin(), start_times_.end(), time) - start_times_.begin();
+}
+
+int TransactionTable::FindPayload(int from, bool forward, int field,
+                                  const std::function<bool(std::string_view)> &matches) const {
+  // Match results per distinct value, -1 until checked.
+  std::vector<int8_t> matched(values_.size(), -1);
+  for (int idx = forward ? from + 1 : from - 1; idx >= 0 && idx < Size(); idx += forward ? 1 : -1) {
+    const uint32_t id = payload_ids_[idx * num_fields_ + field];
+    if (matched[id] < 0) matched[id] = matches(values_[id]);
+    if (matched[id]) return idx;
+  }
+  return -1;
+}
+
+} // namespace sv
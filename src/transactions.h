@@ -0,0 +1,97 @@
+#pragma once
+
+#include "absl/container/flat_hash_map.h"
+#include "wave_data.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// Counts of values in power of two buckets: bucket 0 holds zeros, bucket i holds values in
+// [2^(i-1), 2^i).
+class Histogram {
+ public:
+  void Add(uint64_t value);
+  const std::vector<uint64_t> &Buckets() const { return buckets_; }
+  // Smallest value that falls into the bucket.
+  static uint64_t BucketStart(int bucket) { return bucket == 0 ? 0 : uint64_t{1} << (bucket - 1); }
+  uint64_t Count() const { return count_; }
+  uint64_t Min() const { return min_; }
+  uint64_t Max() const { return max_; }
+  double Mean() const { return count_ == 0 ? 0 : sum_ / count_; }
+
+ private:
+  std::vector<uint64_t> buckets_;
+  uint64_t count_ = 0;
+  uint64_t min_ = 0;
+  uint64_t max_ = 0;
+  double sum_ = 0;
+};
+
+// Signals of a handshake, as sample data. With a clock, this is a valid/ready handshake: a
+// transfer happens at each rising clock edge where valid and ready are both high, and it started
+// at the edge where that valid was first seen high. Without a clock, it is a four-phase req/ack
+// handshake: a transfer starts when req rises and ends when ack rises after it.
+struct HandshakeWaves {
+  const std::vector<WaveData::Sample> *valid = nullptr; // Or req.
+  const std::vector<WaveData::Sample> *ready = nullptr; // Or ack.
+  const std::vector<WaveData::Sample> *clock = nullptr;
+  std::vector<const std::vector<WaveData::Sample> *> payload;
+};
+
+// Transfers decoded from a handshake, stored compactly. Payload values are kept once per distinct
+// value and referred to by index, so that nothing is formatted until it is shown.
+class TransactionTable {
+ public:
+  // Decodes all transfers that end within [start_time, end_time] in a single pass over the waves.
+  // Payload values are the ones the receiver sees: just before the clock edge for valid/ready, and
+  // when req rises for req/ack.
+  static TransactionTable Extract(const HandshakeWaves &waves, uint64_t start_time,
+                                  uint64_t end_time);
+  int Size() const { return start_times_.size(); }
+  int NumFields() const { return num_fields_; }
+  uint64_t StartTime(int idx) const { return start_times_[idx]; }
+  uint64_t EndTime(int idx) const { return end_times_[idx]; }
+  // In clock cycles for valid/ready, time units for req/ack.
+  uint64_t Latency(int idx) const { return latencies_[idx]; }
+  std::string_view Payload(int idx, int field) const {
+    return values_[payload_ids_[idx * num_fields_ + field]];
+  }
+  bool Clocked() const { return clocked_; }
+  // Latency of each transfer, and the time between the ends of consecutive transfers, in the same
+  // units as Latency().
+  const Histogram &Latencies() const { return latency_histogram_; }
+  const Histogram &Gaps() const { return gap_histogram_; }
+  // Number of clock cycles (or time units) covered, for throughput.
+  uint64_t Span() const { return span_; }
+  // Index of the first transfer starting at or after the time, Size() if there is none.
+  int FindTime(uint64_t time) const;
+  // Index of the next transfer after from (or the previous one before it) with a payload field
+  // that matches. Each distinct value is only checked once. Returns -1 if there is none.
+  int FindPayload(int from, bool forward, int field,
+                  const std::function<bool(std::string_view)> &matches) const;
+
+ private:
+  void Add(uint64_t start_time, uint64_t end_time, uint64_t latency,
+           const std::vector<std::string_view> &payload);
+  int num_fields_ = 0;
+  bool clocked_ = false;
+  uint64_t span_ = 0;
+  std::vector<uint64_t> start_times_;
+  std::vector<uint64_t> end_times_;
+  std::vector<uint64_t> latencies_;
+  // num_fields_ entries per transfer.
+  std::vector<uint32_t> payload_ids_;
+  // Distinct payload values, in a deque so the lookup keys stay valid.
+  std::deque<std::string> values_;
+  absl::flat_hash_map<std::string_view, uint32_t> value_ids_;
+  Histogram latency_histogram_;
+  Histogram gap_histogram_;
+};
+
+} // namespace sv
@@ -0,0 +1,61 @@
+#include "transactions.h"
+
+#include "external/googletest/googletest/include/gtest/gtest.h"
+#include "test_waves.h"
+
+namespace sv {
+namespace {
+
+TEST(Transactions, ValidReady) {
+  const auto clock = MakeClock(8);
+  const auto valid = MakeWave({"0", "1", "1", "1", "0", "1", "1", "0"});
+  const auto ready = MakeWave({"0", "0", "0", "1", "0", "1", "1", "0"});
+  const auto data = MakeWave({"00", "a1", "a1", "a1", "00", "b2", "c3", "00"});
+  const TransactionTable t = TransactionTable::Extract(
+      {.valid = &valid, .ready = &ready, .clock = &clock, .payload = {&data}}, 0, 100);
+  ASSERT_EQ(t.Size(), 3);
+  EXPECT_TRUE(t.Clocked());
+  EXPECT_EQ(t.Span(), 8);
+  EXPECT_EQ(t.StartTime(0), 15);
+  EXPECT_EQ(t.EndTime(0), 35);
+  EXPECT_EQ(t.Latency(0), 2);
+  EXPECT_EQ(t.Payload(0, 0), "a1");
+  EXPECT_EQ(t.StartTime(1), 55);
+  EXPECT_EQ(t.Latency(1), 0);
+  EXPECT_EQ(t.Payload(1, 0), "b2");
+  EXPECT_EQ(t.Payload(2, 0), "c3");
+  EXPECT_EQ(t.Latencies().Count(), 3);
+  EXPECT_EQ(t.Latencies().Max(), 2);
+  EXPECT_EQ(t.Latencies().Buckets(), std::vector<uint64_t>({2, 0, 1}));
+  // Ends at cycles 3, 5 and 6.
+  EXPECT_EQ(t.Gaps().Count(), 2);
+  EXPECT_EQ(t.Gaps().Min(), 1);
+  EXPECT_EQ(t.Gaps().Max(), 2);
+  EXPECT_EQ(t.FindTime(20), 1);
+  EXPECT_EQ(t.FindTime(100), 3);
+  const auto is_b2 = [](std::string_view v) { return v == "b2"; };
+  EXPECT_EQ(t.FindPayload(-1, true, 0, is_b2), 1);
+  EXPECT_EQ(t.FindPayload(1, true, 0, is_b2), -1);
+  EXPECT_EQ(t.FindPayload(3, false, 0, is_b2), 1);
+}
+
+TEST(Transactions, ReqAck) {
+  const auto req = MakeWave({"0", "1", "1", "0", "1", "0", "1", "0", "0"});
+  const auto ack = MakeWave({"0", "0", "1", "1", "0", "0", "0", "1", "0"});
+  const auto data = MakeWave({"0", "1", "1", "1", "2", "2", "3", "3", "3"});
+  const TransactionTable t =
+      TransactionTable::Extract({.valid = &req, .ready = &ack, .payload = {&data}}, 0, 100);
+  // The second request is never acknowledged before the third one.
+  ASSERT_EQ(t.Size(), 2);
+  EXPECT_FALSE(t.Clocked());
+  EXPECT_EQ(t.StartTime(0), 10);
+  EXPECT_EQ(t.EndTime(0), 20);
+  EXPECT_EQ(t.Payload(0, 0), "1");
+  EXPECT_EQ(t.StartTime(1), 60);
+  EXPECT_EQ(t.Latency(1), 10);
+  EXPECT_EQ(t.Payload(1, 0), "3");
+  EXPECT_EQ(t.Gaps().Max(), 50);
+}
+
+} // namespace
+} // namespace sv
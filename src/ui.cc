@@ -150,11 +150,13 @@ UI::UI() : search_box_("/") {
 }
 
 bool UI::Reload() {
+  // Live simulations mostly just grow the wave file, which is much cheaper to handle.
+  const bool waves_appended = layout_.has_waves && Workspace::Get().Waves()->ReloadAppended();
   for (Panel *p : panels_) {
     if (layout_.has_design) p->PrepareForDesignReload();
-    if (layout_.has_waves) p->PrepareForWaveDataReload();
+    if (layout_.has_waves && !waves_appended) p->PrepareForWaveDataReload();
   }
-  if (layout_.has_waves) {
+  if (layout_.has_waves && !waves_appended) {
     const absl::Status status = Workspace::Get().Waves()->Reload();
     if (!status.ok()) {
       final_message_ = "Error re-reading waves. File may have been deleted or corrupted.";
@@ -166,6 +168,8 @@ bool UI::Reload() {
     const bool success = Workspace::Get().ReParse();
     if (!success) {
       error_message_ = "Errors reading design.";
+    } else {
+      error_message_ = "Reloaded design: " + Workspace::Get().DesignTimings();
     }
     // Something went badly wrong if there is no design at all now.
     if (Workspace::Get().Design() == nullptr) {
@@ -176,7 +180,13 @@ bool UI::Reload() {
   if (layout_.has_design && layout_.has_waves) Workspace::Get().TryMatchDesignWithWaves();
   for (Panel *p : panels_) {
     if (layout_.has_design) p->HandleReloadedDesign();
-    if (layout_.has_waves) p->HandleReloadedWaves();
+    if (layout_.has_waves) {
+      if (waves_appended) {
+        p->HandleAppendedWaves();
+      } else {
+        p->HandleReloadedWaves();
+      }
+    }
   }
   if (layout_.has_waves) {
     //  Force a refresh on the signals in the refreshed wave data tree.
@@ -359,13 +369,26 @@ void UI::EventLoop() {
       } else if (focused_panel == waves_panel_.get()) {
         if (const std::optional<const WaveData::Signal *> signal =
                 waves_panel_->SignalForSource()) {
-          const slang::ast::Symbol *design_item = Workspace::Get().SignalToDesign(*signal);
-          if (design_item == nullptr) {
-            error_message_ =
-                absl::StrFormat("Signal %s not found in design.", WaveData::SignalToPath(*signal));
-          } else {
+          const slang::ast::Symbol *design_item =
+              layout_.has_design ? Workspace::Get().SignalToDesign(*signal) : nullptr;
+          // The wave file itself may know where the signal is declared, which doesn't depend on
+          // matching the design with the waves.
+          const std::optional<WaveData::SourceLocation> source =
+              Workspace::Get().Waves()->SignalSource(*signal);
+          if (design_item != nullptr) {
             source_panel_->SetItem(design_item);
             design_tree_panel_->SetItem(design_item);
+          } else if (source && layout_.has_design) {
+            source_panel_->SetFileLocation(std::string(source->file), source->line,
+                                           (*signal)->name);
+          } else if (source) {
+            // No source panel without a design, but the location is still useful.
+            error_message_ = absl::StrFormat("%s is declared in %s:%d",
+                                             WaveData::SignalToPath(*signal), source->file,
+                                             source->line);
+          } else {
+            error_message_ =
+                absl::StrFormat("Signal %s not found in design.", WaveData::SignalToPath(*signal));
           }
         }
       }
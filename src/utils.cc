@@ -80,4 +80,36 @@ std::optional<std::string> ActualFileName(const std::string &file_name) {
   return ActualFileName(file_name, /*allow_noexist*/ false);
 }
 
+PhaseTimer::PhaseTimer()
+    : wall_start_(std::chrono::steady_clock::now()), cpu_start_(std::clock()) {}
+
+void PhaseTimer::Finish(std::string_view phase) {
+  const auto wall_now = std::chrono::steady_clock::now();
+  const std::clock_t cpu_now = std::clock();
+  phases_.push_back({
+      .name = std::string(phase),
+      .wall_ms = std::chrono::duration<double, std::milli>(wall_now - wall_start_).count(),
+      .cpu_ms = 1000.0 * (cpu_now - cpu_start_) / CLOCKS_PER_SEC,
+  });
+  wall_start_ = wall_now;
+  cpu_start_ = cpu_now;
+}
+
+void PhaseTimer::Restart() {
+  wall_start_ = std::chrono::steady_clock::now();
+  cpu_start_ = std::clock();
+}
+
+std::string PhaseTimer::Report(bool all_cpu) const {
+  std::string report;
+  for (const Phase &p : phases_) {
+    if (!report.empty()) report += ", ";
+    report += absl::StrFormat("%s %.1fms", p.name, p.wall_ms);
+    if (all_cpu || (p.cpu_ms > 1.5 * p.wall_ms && p.cpu_ms > 1.0)) {
+      report += absl::StrFormat(" (cpu %.1fms)", p.cpu_ms);
+    }
+  }
+  return report;
+}
+
 } // namespace sv
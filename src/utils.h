@@ -1,8 +1,12 @@
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <ctime>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace sv {
 
@@ -23,4 +27,30 @@ std::optional<std::string> ActualFileName(const std::string &file_name);
 // environment variable in the name.
 std::optional<std::string> ActualFileName(const std::string &file_name, bool allow_noexist);
 
+// Measures the wall clock and CPU time of consecutive phases of some longer operation, such as
+// opening a file. Each phase starts where the previous one finished.
+class PhaseTimer {
+ public:
+  PhaseTimer();
+  // Ends the current phase, giving it a name, and starts the next one.
+  void Finish(std::string_view phase);
+  // Starts the next phase without recording the time since the last one, e.g. after waiting for the
+  // user.
+  void Restart();
+  // Something like "header 1.2ms, hierarchy 35.0ms (cpu 80.1ms)". CPU time is only listed when it
+  // differs significantly from the wall time, e.g. when multiple threads were busy, unless all_cpu
+  // is set.
+  std::string Report(bool all_cpu = false) const;
+
+ private:
+  struct Phase {
+    std::string name;
+    double wall_ms;
+    double cpu_ms;
+  };
+  std::vector<Phase> phases_;
+  std::chrono::steady_clock::time_point wall_start_;
+  std::clock_t cpu_start_;
+};
+
 } // namespace sv
@@ -31,8 +31,15 @@ absl::Status VcdWaveData::Reload() {
 
   tokenizer_ = std::move(*tk_or);
   waves_.clear();
+  valid_ranges_.clear();
+  glitches_.clear();
   roots_.clear();
-  return Parse();
+  num_aliases_.clear();
+  signal_id_by_code_.clear();
+  current_id_ = 0;
+  const absl::Status status = Parse();
+  RecompileDerivedSignals();
+  return status;
 }
 
 absl::Status VcdWaveData::Parse() {
@@ -65,11 +72,16 @@ absl::Status VcdWaveData::Parse() {
     scope_stack_.pop();
   // Traverse the completed scope/signal list, and assign parents.
   BuildParents();
-  return ParseSimCommands();
+  if (auto status = ParseSimCommands(); !status.ok()) return status;
+  // Everything is in memory now.
+  for (const auto &[id, wave] : waves_) {
+    valid_ranges_[id] = time_range_;
+  }
+  return absl::OkStatus();
 }
 
-void VcdWaveData::LoadSignalSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
-                                    uint64_t end_time) const {
+void VcdWaveData::LoadFileSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                                  uint64_t end_time) const {
   // Do nothing, all waves are parsed in upon file load.
   // TODO: Lazy / on-demand loading might be useful.
 }
@@ -155,6 +167,7 @@ absl::Status VcdWaveData::ParseVariable() {
     current_id_++;
   } else {
     s.id = signal_id_by_code_[code];
+    num_aliases_[s.id]++;
   }
   return absl::OkStatus();
 }
@@ -204,12 +217,14 @@ absl::Status VcdWaveData::ParseSimCommands() {
   uint64_t time = 0;
   bool first_time = true;
   int prev_percentage = -1;
-  auto add_sample = [&](std::vector<Sample> &samples, const Sample &s) {
+  auto add_sample = [&](uint32_t id, const Sample &s) {
+    std::vector<Sample> &samples = waves_[id];
     if (!keep_glitches_ && !samples.empty()) {
       Sample &prev_sample = samples.back();
       if (s.value == prev_sample.value) {
         return; // Ignore duplicates.
       } else if (time == prev_sample.time) {
+        RecordGlitch(id, time, prev_sample.value);
         // Does this new value make the previous one pointless?
         if (samples.size() > 1 && samples[samples.size() - 2].value == s.value) {
           samples.pop_back();
@@ -245,7 +260,7 @@ absl::Status VcdWaveData::ParseSimCommands() {
       if (signal_id_by_code_.find(tok) == signal_id_by_code_.end()) {
         return absl::InternalError("multi-bit signal value references unknown signal");
       }
-      add_sample(waves_[signal_id_by_code_[tok]], s);
+      add_sample(signal_id_by_code_[tok], s);
     } else if (tok.find_first_of("01xXzZ") == 0) {
       Sample s;
       s.time = time;
@@ -255,7 +270,7 @@ absl::Status VcdWaveData::ParseSimCommands() {
       if (id == signal_id_by_code_.end()) {
         return absl::InternalError("single-bit signal value references unknown signal");
       }
-      add_sample(waves_[id->second], s);
+      add_sample(id->second, s);
     } else {
       return absl::InternalError("Unknown simulation command.");
     }
@@ -15,12 +15,12 @@ class VcdWaveData : public WaveData {
   static void PrintLoadProgress(bool b) { print_progress_ = b; }
   int Log10TimeUnits() const final { return time_units_; }
   std::pair<uint64_t, uint64_t> TimeRange() const final { return time_range_; }
-  void LoadSignalSamples(const std::vector<const Signal *> &signals,
-                         uint64_t start_time, uint64_t end_time) const final;
   absl::Status Reload() final;
 
  private:
   VcdWaveData(const std::string &file_name, bool keep_glitches);
+  void LoadFileSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                       uint64_t end_time) const final;
   // Parse and discard tokens until and $end is encountered.
   absl::Status Parse();
   absl::Status ParseToEofCommand();
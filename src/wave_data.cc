@@ -1,15 +1,35 @@
 #include "wave_data.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
 #include "fst_wave_data.h"
 #include "vcd_wave_data.h"
+#include "wave_expr.h"
+#include <algorithm>
 #include <filesystem>
 #include <optional>
 
 namespace sv {
 
+struct WaveData::DerivedSignal {
+  Signal signal;
+  std::string definition;
+  // Empty when the definition no longer compiles, for example after a reload.
+  std::optional<WaveExpr> expr;
+  // When set, the expression is sampled on the rising edges of this.
+  const Signal *clock = nullptr;
+};
+
+WaveData::WaveData(std::string_view file_name, bool keep_glitches)
+    : file_name_(file_name), keep_glitches_(keep_glitches) {
+  derived_scope_.name = "[derived]";
+}
+
+WaveData::~WaveData() = default;
+
 absl::StatusOr<std::unique_ptr<WaveData>> WaveData::ReadWaveFile(const std::string &file_name,
                                                                  bool keep_glitches) {
   std::string ext = std::filesystem::path(file_name).extension().string();
@@ -23,6 +43,12 @@ absl::StatusOr<std::unique_ptr<WaveData>> WaveData::ReadWaveFile(const std::stri
 }
 
 std::optional<WaveData::Signal *> WaveData::PathToSignal(std::string_view path) {
+  if (absl::ConsumePrefix(&path, derived_scope_.name) && absl::ConsumePrefix(&path, ".")) {
+    for (auto &derived : derived_) {
+      if (derived->signal.name == path) return &derived->signal;
+    }
+    return std::nullopt;
+  }
   std::vector<std::string> levels = absl::StrSplit(path, '.');
   std::vector<SignalScope> *candidates = &roots_;
   SignalScope *candidate = nullptr;
@@ -31,6 +57,7 @@ std::optional<WaveData::Signal *> WaveData::PathToSignal(std::string_view path)
     // Match against the signals for the last element.
     if (level_idx == levels.size() - 1) {
       if (candidate == nullptr) break;
+      LoadScope(candidate);
       for (Signal &signal : candidate->signals) {
         if (signal.name == level) return &signal;
       }
@@ -38,6 +65,7 @@ std::optional<WaveData::Signal *> WaveData::PathToSignal(std::string_view path)
       level_idx++;
       for (SignalScope &scope : *candidates) {
         if (scope.name == level) {
+          LoadScope(&scope);
           candidates = &scope.children;
           candidate = &scope;
           continue;
@@ -64,6 +92,21 @@ std::string WaveData::SignalToPath(const WaveData::Signal *signal) {
   return path;
 }
 
+void WaveData::LoadScope(const SignalScope *scope) const {
+  if (scope->loaded) return;
+  // The scope is only ever reachable through a const pointer, but reading its contents is not
+  // considered a modification of the wave data.
+  auto *s = const_cast<SignalScope *>(scope);
+  ReadScope(s);
+  for (auto &sig : s->signals) {
+    sig.scope = s;
+  }
+  for (auto &sub : s->children) {
+    sub.parent = s;
+  }
+  s->loaded = true;
+}
+
 std::optional<std::string_view> WaveData::GetEnumLabel(int enum_id, std::string_view val) const {
   if (enum_id < 0) return std::nullopt;
   auto enum_it = enums_.find(enum_id);
@@ -74,6 +117,16 @@ std::optional<std::string_view> WaveData::GetEnumLabel(int enum_id, std::string_
   return std::nullopt;
 }
 
+std::optional<std::string_view> WaveData::GetEnumValue(int enum_id, std::string_view label) const {
+  if (enum_id < 0) return std::nullopt;
+  auto enum_it = enums_.find(enum_id);
+  if (enum_it == enums_.end()) return std::nullopt;
+  for (const auto &[val, l] : enum_it->second) {
+    if (l == label) return val;
+  }
+  return std::nullopt;
+}
+
 void WaveData::LoadSignalSamples(const Signal *signal, uint64_t start_time,
                                  uint64_t end_time) const {
   // Use the batch version.
@@ -81,6 +134,183 @@ void WaveData::LoadSignalSamples(const Signal *signal, uint64_t start_time,
   LoadSignalSamples(sigs, start_time, end_time);
 }
 
+void WaveData::LoadSignalSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                                 uint64_t end_time) const {
+  std::vector<const Signal *> file_signals;
+  std::vector<DerivedSignal *> to_compute;
+  for (const Signal *s : signals) {
+    if (s == nullptr) continue;
+    if (!IsDerived(s->id)) {
+      file_signals.push_back(s);
+    } else if (!SamplesValid(s, start_time, end_time)) {
+      to_compute.push_back(derived_[s->id - kDerivedIdBase].get());
+    }
+  }
+  // Inputs from the file are read in the same batch. Derived inputs only depend on earlier derived
+  // signals, so the recursion ends.
+  std::vector<const Signal *> derived_inputs;
+  for (const DerivedSignal *derived : to_compute) {
+    if (!derived->expr) continue;
+    std::vector<const Signal *> inputs = derived->expr->Inputs();
+    if (derived->clock != nullptr) inputs.push_back(derived->clock);
+    for (const Signal *input : inputs) {
+      (IsDerived(input->id) ? derived_inputs : file_signals).push_back(input);
+    }
+  }
+  // Clocked signals start out with the value sampled at their last edge before the range, so their
+  // inputs are read from just before that edge.
+  uint64_t input_start = start_time;
+  for (const DerivedSignal *derived : to_compute) {
+    if (!derived->expr || derived->clock == nullptr) continue;
+    if (const auto edge = LoadLastRisingEdge(derived->clock, start_time, end_time)) {
+      input_start = std::min(input_start, *edge == 0 ? 0 : *edge - 1);
+    }
+  }
+  if (!derived_inputs.empty()) LoadSignalSamples(derived_inputs, input_start, end_time);
+  if (!file_signals.empty()) LoadFileSamples(file_signals, input_start, end_time);
+  for (DerivedSignal *derived : to_compute) {
+    valid_ranges_[derived->signal.id] = {start_time, end_time};
+    std::vector<Sample> wave;
+    if (derived->expr) {
+      ExprWaves input_waves;
+      for (const Signal *input : derived->expr->Inputs()) {
+        input_waves.push_back(&LoadedWave(input));
+      }
+      wave = ExprWave(*derived->expr, input_waves, start_time, end_time,
+                      derived->clock == nullptr ? nullptr : &LoadedWave(derived->clock));
+    }
+    waves_[derived->signal.id] = std::move(wave);
+  }
+}
+
+std::optional<uint64_t> WaveData::LoadLastRisingEdge(const Signal *clock, uint64_t time,
+                                                     uint64_t end_time) const {
+  const uint64_t first = std::min(TimeRange().first, time);
+  // Start with a span as wide as the requested range, and double it each time.
+  uint64_t span = std::max<uint64_t>(end_time - time, 1);
+  uint64_t from = time;
+  while (true) {
+    LoadSignalSamples(clock, from, end_time);
+    if (const auto it = waves_.find(clock->id); it != waves_.end()) {
+      if (const auto edge = LastRisingEdge(it->second, time)) return edge;
+    }
+    if (from <= first) return std::nullopt;
+    from -= std::min(from - first, span);
+    span *= 2;
+  }
+}
+
+void WaveData::LoadSignalWindow(const std::vector<const Signal *> &signals, uint64_t start_time,
+                                uint64_t end_time) const {
+  constexpr uint64_t kMaxKeptWindows = 4;
+  const uint64_t max_width = std::max<uint64_t>(1, end_time - start_time) * kMaxKeptWindows;
+  absl::flat_hash_map<std::pair<uint64_t, uint64_t>, std::vector<const Signal *>> ranges;
+  for (const Signal *signal : signals) {
+    if (SamplesValid(signal, start_time, end_time)) continue;
+    std::pair<uint64_t, uint64_t> range = {start_time, end_time};
+    // Only keep samples that overlap the window, so that the read never spans a gap.
+    const auto loaded = LoadedRange(signal);
+    if (loaded && loaded->first <= end_time && loaded->second >= start_time) {
+      const std::pair<uint64_t, uint64_t> both = {std::min(range.first, loaded->first),
+                                                  std::max(range.second, loaded->second)};
+      if (both.second - both.first <= max_width) range = both;
+    }
+    ranges[range].push_back(signal);
+  }
+  for (const auto &[range, range_signals] : ranges) {
+    LoadSignalSamples(range_signals, range.first, range.second);
+  }
+}
+
+absl::StatusOr<const WaveData::Signal *> WaveData::AddDerivedSignal(
+    std::string_view name, std::string_view definition, const SignalResolver &resolve) {
+  if (name.empty() || name.find_first_of(". []") != std::string_view::npos) {
+    return absl::InvalidArgumentError("Derived signal names can't contain spaces, dots or [].");
+  }
+  auto existing = std::find_if(derived_.begin(), derived_.end(),
+                               [&](const auto &d) { return d->signal.name == name; });
+  // A redefinition may only use signals derived before it, to keep the dependencies acyclic.
+  const int limit = existing - derived_.begin();
+  const auto restricted_resolve = [&](std::string_view n) -> const Signal * {
+    const Signal *s = resolve(n);
+    if (s != nullptr && IsDerived(s->id) && s->id - kDerivedIdBase >= limit) return nullptr;
+    return s;
+  };
+  // An optional clock for sampling, e.g. "@(posedge clk) a + b".
+  std::string_view expr_text = absl::StripAsciiWhitespace(definition);
+  const Signal *clock = nullptr;
+  if (absl::ConsumePrefix(&expr_text, "@(posedge ")) {
+    const size_t close = expr_text.find(')');
+    if (close == std::string_view::npos) return absl::InvalidArgumentError("Missing )");
+    const std::string_view clock_name = absl::StripAsciiWhitespace(expr_text.substr(0, close));
+    clock = restricted_resolve(clock_name);
+    if (clock == nullptr) {
+      return absl::InvalidArgumentError(absl::StrCat("Unknown clock ", clock_name));
+    }
+    expr_text.remove_prefix(close + 1);
+  }
+  absl::StatusOr<WaveExpr> expr = WaveExpr::Compile(expr_text, restricted_resolve);
+  if (!expr.ok()) return expr.status();
+
+  DerivedSignal *derived;
+  if (existing != derived_.end()) {
+    derived = existing->get();
+  } else {
+    derived_.push_back(std::make_unique<DerivedSignal>());
+    derived = derived_.back().get();
+    derived->signal.name = name;
+    derived->signal.id = kDerivedIdBase + derived_.size() - 1;
+    derived->signal.scope = &derived_scope_;
+  }
+  derived->signal.width = expr->Width();
+  derived->definition = expr->Text(SignalToPath);
+  if (clock != nullptr) {
+    derived->definition = absl::StrCat("@(posedge ", SignalToPath(clock), ") ",
+                                       derived->definition);
+  }
+  derived->expr = *std::move(expr);
+  derived->clock = clock;
+  waves_.erase(derived->signal.id);
+  valid_ranges_.erase(derived->signal.id);
+  return &derived->signal;
+}
+
+std::vector<const WaveData::Signal *> WaveData::DerivedSignals() const {
+  std::vector<const Signal *> signals;
+  for (const auto &derived : derived_) {
+    signals.push_back(&derived->signal);
+  }
+  return signals;
+}
+
+std::optional<std::string_view> WaveData::DerivedDefinition(const Signal *signal) const {
+  if (!IsDerived(signal->id)) return std::nullopt;
+  return derived_[signal->id - kDerivedIdBase]->definition;
+}
+
+void WaveData::RecompileDerivedSignals() {
+  const auto resolve = [&](std::string_view path) -> const Signal * {
+    if (auto signal = PathToSignal(path)) return *signal;
+    return nullptr;
+  };
+  for (auto &derived : derived_) {
+    // Keep the definition for a later reload, even if it fails now.
+    const std::string definition = derived->definition;
+    if (!AddDerivedSignal(derived->signal.name, definition, resolve).ok()) {
+      derived->expr.reset();
+      derived->clock = nullptr;
+      waves_.erase(derived->signal.id);
+      valid_ranges_.erase(derived->signal.id);
+    }
+  }
+}
+
+void WaveData::InvalidateDerivedSamples() {
+  for (const auto &derived : derived_) {
+    valid_ranges_.erase(derived->signal.id);
+  }
+}
+
 void WaveData::BuildParents() {
   std::function<void(SignalScope *)> recurse_assign_parents = [&](SignalScope *scope) {
     // Assign to all signals.
@@ -97,6 +327,91 @@ void WaveData::BuildParents() {
   }
 }
 
+bool WaveData::SamplesValid(const Signal *signal, uint64_t start_time, uint64_t end_time) const {
+  const auto it = valid_ranges_.find(signal->id);
+  return it != valid_ranges_.end() && it->second.first <= start_time &&
+         it->second.second >= end_time;
+}
+
+std::optional<std::pair<uint64_t, uint64_t>> WaveData::LoadedRange(const Signal *signal) const {
+  const auto it = valid_ranges_.find(signal->id);
+  if (it == valid_ranges_.end()) return std::nullopt;
+  return it->second;
+}
+
+size_t WaveData::SampleBytes(const std::vector<Sample> &wave) {
+  static const size_t inline_capacity = std::string().capacity();
+  size_t bytes = wave.capacity() * sizeof(Sample);
+  for (const Sample &s : wave) {
+    // Short values are stored inside the string object itself.
+    if (s.value.capacity() > inline_capacity) bytes += s.value.capacity() + 1;
+  }
+  return bytes;
+}
+
+std::vector<WaveData::Sample> WaveData::TakeSamples(const Signal *signal) const {
+  auto it = waves_.find(signal->id);
+  if (it == waves_.end()) return {};
+  std::vector<Sample> wave = std::move(it->second);
+  waves_.erase(it);
+  valid_ranges_.erase(signal->id);
+  glitches_.erase(signal->id);
+  return wave;
+}
+
+void WaveData::RecordGlitch(uint32_t id, uint64_t time, const std::string &dropped) const {
+  std::vector<Glitch> &glitches = glitches_[id];
+  if (!glitches.empty() && glitches.back().time == time) {
+    glitches.back().count++;
+    glitches.back().value = dropped;
+  } else {
+    glitches.push_back({.time = time, .count = 1, .value = dropped});
+  }
+}
+
+std::vector<WaveData::Glitch> WaveData::Glitches(const Signal *signal, uint64_t start_time,
+                                                 uint64_t end_time) const {
+  std::vector<Glitch> result;
+  if (keep_glitches_) {
+    const auto it = waves_.find(signal->id);
+    if (it == waves_.end()) return result;
+    const std::vector<Sample> &wave = it->second;
+    for (int i = 1; i < wave.size() && wave[i].time <= end_time; ++i) {
+      if (wave[i].time < start_time || wave[i].time != wave[i - 1].time) continue;
+      if (!result.empty() && result.back().time == wave[i].time) {
+        result.back().count++;
+        result.back().value = wave[i - 1].value;
+      } else {
+        result.push_back({.time = wave[i].time, .count = 1, .value = wave[i - 1].value});
+      }
+    }
+    return result;
+  }
+  const auto it = glitches_.find(signal->id);
+  if (it == glitches_.end()) return result;
+  const auto first = std::lower_bound(it->second.begin(), it->second.end(), start_time,
+                                      [](const Glitch &g, uint64_t t) { return g.time < t; });
+  for (auto g = first; g != it->second.end() && g->time <= end_time; ++g) {
+    result.push_back(*g);
+  }
+  return result;
+}
+
+WaveData::MemoryUsage WaveData::SampleMemory() const {
+  MemoryUsage usage;
+  for (const auto &[id, wave] : waves_) {
+    if (wave.empty()) continue;
+    const size_t bytes = SampleBytes(wave);
+    usage.num_waves++;
+    usage.num_samples += wave.size();
+    usage.bytes += bytes;
+    if (const auto it = num_aliases_.find(id); it != num_aliases_.end()) {
+      usage.shared_bytes += bytes * it->second;
+    }
+  }
+  return usage;
+}
+
 int WaveData::FindSampleIndex(uint64_t time, const Signal *signal, int left, int right) const {
   auto &wave = waves_[signal->id];
   // Binary search for the right sample.
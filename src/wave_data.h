@@ -2,9 +2,11 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/status/statusor.h"
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace sv {
@@ -56,23 +58,44 @@ class WaveData {
     const SignalScope *scope = nullptr;
     // Modified by design files.
     mutable std::vector<SignalStructMember> struct_members;
-    // This can be loaded / reloaded.
-    mutable uint64_t valid_start_time = 0;
-    mutable uint64_t valid_end_time = 0;
   };
   struct SignalScope {
     std::string name;
-    std::vector<SignalScope> children;
-    std::vector<Signal> signals;
+    // Implementations may defer reading the children and signals of a scope until needed. Call
+    // LoadScope() before accessing them directly.
+    mutable std::vector<SignalScope> children;
+    mutable std::vector<Signal> signals;
     const SignalScope *parent = nullptr;
+    // False while the children and signals have not been read yet.
+    mutable bool loaded = true;
+    // Implementation specific reference to where the unread scope contents can be found.
+    uint32_t lazy_id = 0;
   };
   const std::vector<Sample> &Wave(const Signal *s) const { return waves_[s->id]; }
+  // Like Wave(), but without adding an entry for signals that have no samples. Pointers to waves
+  // that are collected in a loop must use this, since an added entry can move the others.
+  const std::vector<Sample> &LoadedWave(const Signal *s) const {
+    static const std::vector<Sample> kNoSamples;
+    const auto it = waves_.find(s->id);
+    return it == waves_.end() ? kNoSamples : it->second;
+  }
   const std::vector<SignalScope> &Roots() const { return roots_; }
   std::optional<Signal *> PathToSignal(std::string_view path);
   std::optional<const Signal *> PathToSignal(std::string_view path) const;
   static std::string SignalToPath(const WaveData::Signal *signal);
+  // Make sure the children and signals of the given scope are populated.
+  void LoadScope(const SignalScope *scope) const;
   // Loads up the waves_ structure with sample data for the given Signal.
   void LoadSignalSamples(const Signal *signal, uint64_t start_time, uint64_t end_time) const;
+  // Batch variant, which is generally a lot more efficient than loading each signal separately.
+  void LoadSignalSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                         uint64_t end_time) const;
+  // For views that only need a window of time. Loading replaces what was there, so samples that are
+  // loaded already, for instance for the waves panel, are read along when they overlap the window
+  // and that takes at most a few times as long as the window. Otherwise only the window is read, and the other users of the
+  // samples load theirs again when they find them missing.
+  void LoadSignalWindow(const std::vector<const Signal *> &signals, uint64_t start_time,
+                        uint64_t end_time) const;
   // Returns the sample index corresponding to the value at the given time. Search bounds can be
   // constrained to a subset of the wave.
   int FindSampleIndex(uint64_t time, const Signal *signal, int left, int right) const;
@@ -82,29 +105,105 @@ class WaveData {
   std::string FindSampleValue(uint64_t time, const Signal *signal) const;
   // Get an enum value if it exists.
   std::optional<std::string_view> GetEnumLabel(int enum_id, std::string_view val) const;
+  // Reverse of the above, the value that has the given label.
+  std::optional<std::string_view> GetEnumValue(int enum_id, std::string_view label) const;
+  // True if the loaded samples of the signal are complete over the given time range. This is
+  // tracked per ID, so loading one signal makes all its aliases valid too.
+  bool SamplesValid(const Signal *signal, uint64_t start_time, uint64_t end_time) const;
+  // True if any samples of the signal are loaded, for any time range.
+  bool SamplesLoaded(const Signal *signal) const { return valid_ranges_.contains(signal->id); }
+  // Time range over which the samples of the signal are loaded, if any.
+  std::optional<std::pair<uint64_t, uint64_t>> LoadedRange(const Signal *signal) const;
+  struct MemoryUsage {
+    size_t num_waves = 0; // Distinct sample streams, aliases are counted once.
+    size_t num_samples = 0;
+    size_t bytes = 0;
+    // Additional memory that would be needed if every alias held its own copy.
+    size_t shared_bytes = 0;
+  };
+  MemoryUsage SampleMemory() const;
+  // Approximate heap memory held by the samples of one wave.
+  static size_t SampleBytes(const std::vector<Sample> &wave);
+  // Moves the loaded samples of a signal out, for batch jobs that go over many more signals than
+  // fit in memory at once. They are loaded again if needed later. Its glitches are dropped too.
+  std::vector<Sample> TakeSamples(const Signal *signal) const;
+  // Unless glitches are kept, zero-time transitions are dropped from the samples, leaving only the
+  // value each time settles to. What was dropped is remembered, one entry per time.
+  struct Glitch {
+    uint64_t time;
+    // Number of values at this time before the settled one.
+    uint32_t count;
+    // The last of those values, where a zero-time pulse went to.
+    std::string value;
+  };
+  // Glitches in the loaded samples of a signal within [start_time, end_time], ascending in time.
+  // When glitches are kept, they are found in the samples themselves.
+  std::vector<Glitch> Glitches(const Signal *signal, uint64_t start_time, uint64_t end_time) const;
+  // Location of a declaration in the design source code.
+  struct SourceLocation {
+    std::string_view file;
+    int line;
+  };
+  // Some wave files record where signals and scopes are declared. When only the enclosing scope is
+  // known, that location is given instead, and the signal is somewhere inside.
+  virtual std::optional<SourceLocation> SignalSource(const Signal *signal) const {
+    return std::nullopt;
+  }
+  virtual bool HasSourceLocations() const { return false; }
+  // Derived signals are computed from an expression over other signals (see wave_expr.h), for
+  // example "{a, b[3:0]}", or "@(posedge clk) count + 1" to sample on a clock. They live in their
+  // own scope outside of Roots(), and their samples are only computed for the requested range in
+  // LoadSignalSamples(). Defining an existing name again replaces its definition.
+  using SignalResolver = std::function<const Signal *(std::string_view name)>;
+  absl::StatusOr<const Signal *> AddDerivedSignal(std::string_view name,
+                                                  std::string_view definition,
+                                                  const SignalResolver &resolve);
+  // In order of creation, so that each only depends on earlier ones.
+  std::vector<const Signal *> DerivedSignals() const;
+  // Definition with full signal paths, or nullopt if the signal is not derived.
+  std::optional<std::string_view> DerivedDefinition(const Signal *signal) const;
 
   // ------------- Implementation methods --------------
   // returns -9 for nanoseconds, -6 for microseconds, etc.
   virtual int Log10TimeUnits() const = 0;
   // Valid time range in the wave data.
   virtual std::pair<uint64_t, uint64_t> TimeRange() const = 0;
-  // Implementations use a batch processing variant of wave loading, which is
-  // generally a lot more efficient than reading the wave data for each signal
-  // separately.
-  virtual void LoadSignalSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
-                                 uint64_t end_time) const = 0;
+  // Wall and CPU time of each phase of reading the file, for formats that time it. Empty otherwise.
+  const std::string &OpenTimings() const { return open_timings_; }
   virtual absl::Status Reload() = 0;
+  // Picks up data appended to the wave file since it was read, for example by a simulation that is
+  // still running. Returns false if the file changed in any other way, in which case a full
+  // Reload() is needed. When this succeeds, all scopes, signals and loaded samples remain valid.
+  virtual bool ReloadAppended() { return false; }
 
-  virtual ~WaveData() {}
+  virtual ~WaveData();
 
  protected:
   // Not directly constructable.
-  WaveData(std::string_view file_name, bool keep_glitches)
-      : file_name_(file_name), keep_glitches_(keep_glitches) {}
+  WaveData(std::string_view file_name, bool keep_glitches);
   // Traverse the scopes and signals and assign parents. This can only be done after the structure
   // has been fully created, since the parents are pointers to elements of vectors, and thus could
   // be invalidated (point to garbage) if the signal and scope children vectors are modified.
   void BuildParents();
+  // Implementations that create scopes with loaded = false fill in the children and signals here.
+  // Parent pointers are taken care of by the caller.
+  virtual void ReadScope(SignalScope *scope) const {}
+  // Reads the samples of signals from the wave file, for LoadSignalSamples(). Derived signals are
+  // handled by the caller.
+  virtual void LoadFileSamples(const std::vector<const Signal *> &signals, uint64_t start_time,
+                               uint64_t end_time) const = 0;
+  // After a reload, derived signals are compiled again from their definitions, since they refer to
+  // signals that no longer exist.
+  void RecompileDerivedSignals();
+  // Drops the computed samples of derived signals, for when their inputs have changed.
+  void InvalidateDerivedSamples();
+  // For loaders that drop a value because a later one at the same time replaces it.
+  void RecordGlitch(uint32_t id, uint64_t time, const std::string &dropped) const;
+  // Loads the clock further and further back until it has a rising edge at or before the given
+  // time, or the start of the wave data is reached. Returns the time of that edge.
+  std::optional<uint64_t> LoadLastRisingEdge(const Signal *clock, uint64_t time,
+                                             uint64_t end_time) const;
+  static bool IsDerived(uint32_t id) { return id >= kDerivedIdBase; }
   // Waveform data is stored per ID, which is potentially a subset of signals in the wave. This
   // avoids the need to hold copies of identical waveforms for signals who are aliases of eachother.
   // The canonical example here is clocks, which have lots of samples and generally exist all
@@ -113,13 +212,29 @@ class WaveData {
   // that hold a const reference or pointer to this WaveData object can index the map (which is a
   // non-const operation since it may create new empty vectors for new IDs).
   mutable absl::flat_hash_map<uint32_t, std::vector<Sample>> waves_;
+  // Time range over which the samples of each ID in waves_ are complete.
+  mutable absl::flat_hash_map<uint32_t, std::pair<uint64_t, uint64_t>> valid_ranges_;
+  // Zero-time transitions dropped from waves_, per ID. Cleared along with the samples.
+  mutable absl::flat_hash_map<uint32_t, std::vector<Glitch>> glitches_;
+  // Number of additional signals in the hierarchy that share the ID of an earlier one. IDs without
+  // aliases are not present.
+  absl::flat_hash_map<uint32_t, int> num_aliases_;
   // Signals owned from here.
   std::vector<SignalScope> roots_;
   std::string file_name_;
+  std::string open_timings_;
   // When false, glitches are stripped from the wave data.
   bool keep_glitches_;
   // Enum value-to-label maps.
   absl::flat_hash_map<int, absl::flat_hash_map<std::string, std::string>> enums_;
+
+ private:
+  // Derived signals use IDs that wave files don't get anywhere near.
+  static constexpr uint32_t kDerivedIdBase = 0x80000000;
+  struct DerivedSignal;
+  // Held by pointer so that Signal pointers remain valid as more are added.
+  std::vector<std::unique_ptr<DerivedSignal>> derived_;
+  SignalScope derived_scope_;
 };
 
 } // namespace sv
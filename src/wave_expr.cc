@@ -0,0 +1,664 @@
+#include "wave_expr.h"
+
+#include "absl/status/status.h"
+#include "absl/strings/str_format.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <queue>
+
+namespace sv {
+namespace {
+
+constexpr int kMaxWidth = 64;
+
+uint64_t Mask(int width) { return width >= 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1; }
+
+ExprValue Unknown(int width) { return {.bits = 0, .xz = Mask(width), .width = width}; }
+
+ExprValue Bool(bool b) { return {.bits = b ? 1u : 0u, .xz = 0, .width = 1}; }
+
+// All bits known to be zero.
+bool IsFalse(const ExprValue &v) { return (v.bits | v.xz) == 0; }
+
+// Bit range of a sample value, where VCD style shortened values are extended on the left.
+ExprValue ExtractBits(std::string_view s, int lsb, int width) {
+  ExprValue v = {.width = width};
+  const char msb = s.empty() ? '0' : std::tolower(s[0]);
+  const char ext = (msb == 'x' || msb == 'z') ? msb : '0';
+  for (int b = 0; b < width; ++b) {
+    const int pos = lsb + b;
+    const char c = pos < s.size() ? s[s.size() - 1 - pos] : ext;
+    if (c == '1') {
+      v.bits |= uint64_t{1} << b;
+    } else if (c != '0') {
+      v.xz |= uint64_t{1} << b;
+    }
+  }
+  return v;
+}
+
+// Steps through the times at which any of the input waves change, forwards or backwards in time.
+class TransitionWalker {
+ public:
+  TransitionWalker(const ExprWaves &waves, uint64_t time, bool forward)
+      : waves_(waves), forward_(forward), idx_(waves.size()) {
+    for (int i = 0; i < waves.size(); ++i) {
+      const auto &wave = *waves[i];
+      // Last sample at or before the time.
+      idx_[i] = std::upper_bound(wave.begin(), wave.end(), time,
+                                 [](uint64_t t, const WaveData::Sample &s) { return t < s.time; }) -
+                wave.begin() - 1;
+      if (forward_) {
+        if (idx_[i] + 1 < wave.size()) heap_.push({wave[idx_[i] + 1].time, i});
+        if (idx_[i] >= 0) time_ = std::max(time_, wave[idx_[i]].time);
+      } else if (idx_[i] >= 0) {
+        heap_.push({wave[idx_[i]].time, i});
+      }
+    }
+    if (!forward_ && !heap_.empty()) time_ = heap_.top().first;
+  }
+
+  // Start time of the current stretch of time during which no input changes.
+  uint64_t Time() const { return time_; }
+
+  // Passes the current sample of every input to set(input, sample), where the sample is nullptr
+  // before the first one.
+  template <typename SetFn>
+  void LoadAll(SetFn &&set) const {
+    for (int i = 0; i < waves_.size(); ++i) {
+      set(i, idx_[i] >= 0 ? &(*waves_[i])[idx_[i]] : nullptr);
+    }
+  }
+
+  // Moves to the next stretch in the walking direction, passing the inputs that changed to set().
+  // Returns false when there is nothing more.
+  template <typename SetFn>
+  bool Step(SetFn &&set) {
+    if (heap_.empty()) return false;
+    const uint64_t t = heap_.top().first;
+    while (!heap_.empty() && heap_.top().first == t) {
+      const int i = heap_.top().second;
+      heap_.pop();
+      const auto &wave = *waves_[i];
+      int &idx = idx_[i];
+      if (forward_) {
+        // Skip over glitches, only the final value at a time matters.
+        idx++;
+        while (idx + 1 < wave.size() && wave[idx + 1].time == t) idx++;
+        set(i, &wave[idx]);
+        if (idx + 1 < wave.size()) heap_.push({wave[idx + 1].time, i});
+      } else {
+        while (idx >= 0 && wave[idx].time >= t) idx--;
+        if (idx >= 0) {
+          set(i, &wave[idx]);
+          heap_.push({wave[idx].time, i});
+        } else {
+          set(i, nullptr);
+        }
+      }
+    }
+    if (forward_) {
+      time_ = t;
+    } else {
+      time_ = heap_.empty() ? 0 : heap_.top().first;
+    }
+    return true;
+  }
+
+ private:
+  const ExprWaves &waves_;
+  const bool forward_;
+  // Index of the current sample of each input, -1 before the first one.
+  std::vector<int> idx_;
+  uint64_t time_ = 0;
+  // Keyed on the next transition time of each input when walking forward, and on the start time
+  // of its current sample when walking backward. Either way, the top is the next to process.
+  struct Order {
+    bool forward;
+    bool operator()(const std::pair<uint64_t, int> &a, const std::pair<uint64_t, int> &b) const {
+      return forward ? a > b : a < b;
+    }
+  };
+  std::priority_queue<std::pair<uint64_t, int>, std::vector<std::pair<uint64_t, int>>, Order>
+      heap_{Order{forward_}};
+};
+
+// Walker callback that feeds the samples to the expression.
+auto ExprSetter(WaveExpr &expr) {
+  return [&expr](int input, const WaveData::Sample *sample) {
+    if (sample == nullptr) {
+      expr.ClearInput(input);
+    } else {
+      expr.SetInput(input, sample->value);
+    }
+  };
+}
+
+} // namespace
+
+// Recursive descent parser that emits the postfix program directly.
+class ExprParser {
+ public:
+  ExprParser(std::string_view text, const WaveExpr::Resolver &resolve, WaveExpr *expr)
+      : text_(text), resolve_(resolve), expr_(expr) {}
+
+  absl::Status Parse() {
+    if (auto status = ParseBinary(0); !status.ok()) return status;
+    SkipSpace();
+    if (pos_ != text_.size()) return Error("Unexpected text");
+    expr_->width_ = widths_.back();
+    return absl::OkStatus();
+  }
+
+ private:
+  using OpCode = WaveExpr::OpCode;
+  struct BinaryOp {
+    std::string_view token;
+    OpCode code;
+  };
+
+  absl::Status Error(std::string_view what) const {
+    return absl::InvalidArgumentError(absl::StrFormat("%s at position %d", what, pos_ + 1));
+  }
+
+  void SkipSpace() {
+    while (pos_ < text_.size() && std::isspace(text_[pos_])) pos_++;
+  }
+
+  // Consumes the token if it is next, but not when it's the start of a longer operator.
+  bool Accept(std::string_view token) {
+    SkipSpace();
+    if (!text_.substr(pos_).starts_with(token)) return false;
+    const size_t next = pos_ + token.size();
+    if (token.size() == 1 && next < text_.size()) {
+      const char c = text_[next];
+      if ((token == "&" || token == "|") && c == token[0]) return false;
+      if ((token == "<" || token == ">") && (c == token[0] || c == '=')) return false;
+      if (token == "!" && c == '=') return false;
+    }
+    pos_ = next;
+    return true;
+  }
+
+  // Appends to the program, while keeping track of the result widths on the stack. This must
+  // agree with what Evaluate() does.
+  void Emit(OpCode code, int arg = 0) {
+    expr_->program_.push_back({.code = code, .arg = arg});
+    switch (code) {
+    case OpCode::kLeaf: widths_.push_back(expr_->leaves_[arg].width); break;
+    case OpCode::kConst: widths_.push_back(expr_->constants_[arg].width); break;
+    case OpCode::kBitNot:
+    case OpCode::kNegate: break;
+    case OpCode::kLogicalNot:
+    case OpCode::kReduceAnd:
+    case OpCode::kReduceOr:
+    case OpCode::kReduceXor: widths_.back() = 1; break;
+    default: {
+      const int b = widths_.back();
+      widths_.pop_back();
+      int &a = widths_.back();
+      if (code == OpCode::kConcat) {
+        a += b;
+      } else if (code >= OpCode::kLogicalAnd && code <= OpCode::kGe) {
+        a = 1;
+      } else if (code != OpCode::kShl && code != OpCode::kShr) {
+        a = std::max(a, b);
+      }
+    } break;
+    }
+    expr_->max_stack_ = std::max<int>(expr_->max_stack_, widths_.size());
+  }
+
+  absl::Status ParseBinary(int level) {
+    // Lowest precedence first.
+    static const std::vector<std::vector<BinaryOp>> kLevels = {
+        {{"||", OpCode::kLogicalOr}},
+        {{"&&", OpCode::kLogicalAnd}},
+        {{"|", OpCode::kOr}},
+        {{"^", OpCode::kXor}},
+        {{"&", OpCode::kAnd}},
+        {{"==", OpCode::kEq}, {"!=", OpCode::kNe}},
+        {{"<=", OpCode::kLe}, {">=", OpCode::kGe}, {"<", OpCode::kLt}, {">", OpCode::kGt}},
+        {{"<<", OpCode::kShl}, {">>", OpCode::kShr}},
+        {{"+", OpCode::kAdd}, {"-", OpCode::kSub}},
+    };
+    if (level == kLevels.size()) return ParseUnary();
+    if (auto status = ParseBinary(level + 1); !status.ok()) return status;
+    while (true) {
+      const BinaryOp *found = nullptr;
+      for (const BinaryOp &op : kLevels[level]) {
+        if (Accept(op.token)) {
+          found = &op;
+          break;
+        }
+      }
+      if (found == nullptr) return absl::OkStatus();
+      if (auto status = ParseBinary(level + 1); !status.ok()) return status;
+      Emit(found->code);
+    }
+  }
+
+  absl::Status ParseUnary() {
+    static const std::vector<BinaryOp> kUnary = {
+        {"!", OpCode::kLogicalNot}, {"~", OpCode::kBitNot},    {"-", OpCode::kNegate},
+        {"&", OpCode::kReduceAnd},  {"|", OpCode::kReduceOr}, {"^", OpCode::kReduceXor},
+    };
+    for (const BinaryOp &op : kUnary) {
+      if (Accept(op.token)) {
+        if (auto status = ParseUnary(); !status.ok()) return status;
+        Emit(op.code);
+        return absl::OkStatus();
+      }
+    }
+    return ParsePrimary();
+  }
+
+  std::optional<int> ParseInt() {
+    SkipSpace();
+    const size_t start = pos_;
+    int val = 0;
+    while (pos_ < text_.size() && std::isdigit(text_[pos_])) {
+      val = val * 10 + (text_[pos_++] - '0');
+    }
+    if (pos_ == start) return std::nullopt;
+    return val;
+  }
+
+  absl::Status ParsePrimary() {
+    SkipSpace();
+    if (pos_ >= text_.size()) return Error("Missing operand");
+    const char c = text_[pos_];
+    if (Accept("(")) {
+      if (auto status = ParseBinary(0); !status.ok()) return status;
+      if (!Accept(")")) return Error("Missing )");
+      return absl::OkStatus();
+    }
+    if (Accept("{")) {
+      if (auto status = ParseBinary(0); !status.ok()) return status;
+      while (Accept(",")) {
+        if (auto status = ParseBinary(0); !status.ok()) return status;
+        Emit(OpCode::kConcat);
+        if (widths_.back() > kMaxWidth) {
+          return Error(absl::StrFormat("Concatenation wider than %d bits", kMaxWidth));
+        }
+      }
+      if (!Accept("}")) return Error("Missing }");
+      return absl::OkStatus();
+    }
+    if (std::isdigit(c) || c == '\'') return ParseLiteral();
+    if (std::isalpha(c) || c == '_' || c == '\\') return ParseSignal();
+    return Error("Unexpected character");
+  }
+
+  absl::Status ParseLiteral() {
+    const std::optional<int> size = ParseInt();
+    if (pos_ >= text_.size() || text_[pos_] != '\'') {
+      // Plain decimal numbers are 32 bits, as in Verilog.
+      expr_->constants_.push_back({.bits = static_cast<uint64_t>(*size), .xz = 0, .width = 32});
+      Emit(OpCode::kConst, expr_->constants_.size() - 1);
+      return absl::OkStatus();
+    }
+    pos_++;
+    if (pos_ < text_.size() && std::tolower(text_[pos_]) == 's') pos_++;
+    if (pos_ >= text_.size()) return Error("Missing base");
+    int digit_bits = 0;
+    switch (std::tolower(text_[pos_++])) {
+    case 'h': digit_bits = 4; break;
+    case 'o': digit_bits = 3; break;
+    case 'b': digit_bits = 1; break;
+    case 'd': digit_bits = 0; break;
+    default: return Error("Unknown base");
+    }
+    const int width = size.value_or(32);
+    if (width <= 0 || width > kMaxWidth) return Error("Literal width not supported");
+    ExprValue v = {.width = width};
+    const size_t start = pos_;
+    for (; pos_ < text_.size(); ++pos_) {
+      const char d = std::tolower(text_[pos_]);
+      if (d == '_') continue;
+      if (digit_bits == 0) {
+        if (!std::isdigit(d)) break;
+        v.bits = v.bits * 10 + (d - '0');
+        continue;
+      }
+      const bool unknown = d == 'x' || d == 'z' || d == '?';
+      const int val = std::isdigit(d) ? d - '0' : (d >= 'a' && d <= 'f') ? d - 'a' + 10 : 99;
+      if (!unknown && val >= (1 << digit_bits)) break;
+      v.bits = (v.bits << digit_bits) | (unknown ? 0 : val);
+      v.xz = (v.xz << digit_bits) | (unknown ? Mask(digit_bits) : 0);
+    }
+    if (pos_ == start) return Error("Missing digits");
+    v.bits &= Mask(width);
+    v.xz &= Mask(width);
+    expr_->constants_.push_back(v);
+    Emit(OpCode::kConst, expr_->constants_.size() - 1);
+    return absl::OkStatus();
+  }
+
+  absl::Status ParseSignal() {
+    const size_t start = pos_;
+    if (text_[pos_] == '\\') {
+      // Escaped identifiers run up to whitespace.
+      while (pos_ < text_.size() && !std::isspace(text_[pos_])) pos_++;
+    } else {
+      while (pos_ < text_.size() && (std::isalnum(text_[pos_]) || text_[pos_] == '_' ||
+                                     text_[pos_] == '$' || text_[pos_] == '.')) {
+        pos_++;
+      }
+    }
+    const size_t name_length = pos_ - start;
+    const std::string_view name = text_.substr(start, name_length);
+    const WaveData::Signal *signal = resolve_(name);
+    if (signal == nullptr) {
+      return absl::InvalidArgumentError(absl::StrFormat("Unknown signal %s", name));
+    }
+    int msb = signal->lsb + signal->width - 1;
+    int lsb = signal->lsb;
+    if (Accept("[")) {
+      const std::optional<int> first = ParseInt();
+      if (!first) return Error("Missing index");
+      msb = lsb = *first;
+      if (Accept(":")) {
+        const std::optional<int> second = ParseInt();
+        if (!second) return Error("Missing index");
+        lsb = *second;
+      }
+      if (!Accept("]")) return Error("Missing ]");
+      if (std::min(msb, lsb) < signal->lsb || std::max(msb, lsb) >= signal->lsb + signal->width) {
+        return Error("Index out of range");
+      }
+    }
+    const int width = std::abs(msb - lsb) + 1;
+    if (width > kMaxWidth) {
+      return Error(absl::StrFormat("Signals wider than %d bits need a part select", kMaxWidth));
+    }
+    auto it = std::find(expr_->inputs_.begin(), expr_->inputs_.end(), signal);
+    const int input = it - expr_->inputs_.begin();
+    if (it == expr_->inputs_.end()) expr_->inputs_.push_back(signal);
+    expr_->names_.push_back({.pos = start, .length = name_length, .input = input});
+    expr_->leaves_.push_back(
+        {.input = input, .lsb = std::min(msb, lsb) - signal->lsb, .width = width});
+    Emit(OpCode::kLeaf, expr_->leaves_.size() - 1);
+    return absl::OkStatus();
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+  std::vector<int> widths_;
+  const WaveExpr::Resolver &resolve_;
+  WaveExpr *expr_;
+};
+
+absl::StatusOr<WaveExpr> WaveExpr::Compile(std::string_view text, const Resolver &resolve) {
+  WaveExpr expr;
+  expr.text_ = text;
+  ExprParser parser(text, resolve, &expr);
+  if (auto status = parser.Parse(); !status.ok()) return status;
+  expr.input_leaves_.resize(expr.inputs_.size());
+  for (int i = 0; i < expr.leaves_.size(); ++i) {
+    expr.input_leaves_[expr.leaves_[i].input].push_back(i);
+  }
+  expr.leaf_values_.resize(expr.leaves_.size());
+  for (int i = 0; i < expr.leaves_.size(); ++i) {
+    expr.leaf_values_[i] = Unknown(expr.leaves_[i].width);
+  }
+  expr.stack_.resize(expr.max_stack_);
+  return expr;
+}
+
+std::string WaveExpr::Text(
+    const std::function<std::string(const WaveData::Signal *)> &rename) const {
+  std::string result;
+  size_t copied = 0;
+  for (const Name &name : names_) {
+    result += text_.substr(copied, name.pos - copied);
+    result += rename(inputs_[name.input]);
+    copied = name.pos + name.length;
+  }
+  result += text_.substr(copied);
+  return result;
+}
+
+void WaveExpr::SetInput(int input, std::string_view value) {
+  for (const int leaf : input_leaves_[input]) {
+    leaf_values_[leaf] = ExtractBits(value, leaves_[leaf].lsb, leaves_[leaf].width);
+  }
+}
+
+void WaveExpr::ClearInput(int input) {
+  for (const int leaf : input_leaves_[input]) {
+    leaf_values_[leaf] = Unknown(leaves_[leaf].width);
+  }
+}
+
+ExprValue WaveExpr::Evaluate() const {
+  int sp = 0;
+  for (const Op &op : program_) {
+    switch (op.code) {
+    case OpCode::kLeaf: stack_[sp++] = leaf_values_[op.arg]; continue;
+    case OpCode::kConst: stack_[sp++] = constants_[op.arg]; continue;
+    default: break;
+    }
+    if (op.code <= OpCode::kReduceXor) {
+      ExprValue &a = stack_[sp - 1];
+      const uint64_t mask = Mask(a.width);
+      switch (op.code) {
+      case OpCode::kLogicalNot:
+        a = a.IsTrue() ? Bool(false) : IsFalse(a) ? Bool(true) : Unknown(1);
+        break;
+      case OpCode::kBitNot: a.bits = ~a.bits & ~a.xz & mask; break;
+      case OpCode::kNegate:
+        a = a.xz ? Unknown(a.width) : ExprValue{(0 - a.bits) & mask, 0, a.width};
+        break;
+      case OpCode::kReduceAnd:
+        a = (~a.bits & ~a.xz & mask) ? Bool(false) : a.xz ? Unknown(1) : Bool(true);
+        break;
+      case OpCode::kReduceOr: a = a.IsTrue() ? Bool(true) : a.xz ? Unknown(1) : Bool(false); break;
+      case OpCode::kReduceXor:
+        a = a.xz ? Unknown(1) : Bool(std::popcount(a.bits) & 1);
+        break;
+      default: break;
+      }
+      continue;
+    }
+    const ExprValue b = stack_[--sp];
+    ExprValue &a = stack_[sp - 1];
+    const int width = std::max(a.width, b.width);
+    const uint64_t mask = Mask(width);
+    const bool unknown = a.xz != 0 || b.xz != 0;
+    switch (op.code) {
+    case OpCode::kAnd: {
+      const uint64_t ones = a.bits & b.bits;
+      const uint64_t zeros = (~a.bits & ~a.xz) | (~b.bits & ~b.xz);
+      a = {.bits = ones, .xz = ~(ones | zeros) & mask, .width = width};
+    } break;
+    case OpCode::kOr: {
+      const uint64_t ones = a.bits | b.bits;
+      const uint64_t zeros = (~a.bits & ~a.xz) & (~b.bits & ~b.xz);
+      a = {.bits = ones, .xz = ~(ones | zeros) & mask, .width = width};
+    } break;
+    case OpCode::kXor: {
+      const uint64_t xz = (a.xz | b.xz) & mask;
+      a = {.bits = (a.bits ^ b.bits) & ~xz & mask, .xz = xz, .width = width};
+    } break;
+    case OpCode::kLogicalAnd:
+      a = (IsFalse(a) || IsFalse(b)) ? Bool(false)
+          : (a.IsTrue() && b.IsTrue()) ? Bool(true)
+                                       : Unknown(1);
+      break;
+    case OpCode::kLogicalOr:
+      a = (a.IsTrue() || b.IsTrue())      ? Bool(true)
+          : (IsFalse(a) && IsFalse(b)) ? Bool(false)
+                                       : Unknown(1);
+      break;
+    case OpCode::kEq:
+    case OpCode::kNe: {
+      // Known bits that differ decide, even if other bits are unknown.
+      const uint64_t known = ~(a.xz | b.xz) & mask;
+      const bool equal = op.code == OpCode::kEq;
+      a = ((a.bits ^ b.bits) & known) ? Bool(!equal) : unknown ? Unknown(1) : Bool(equal);
+    } break;
+    case OpCode::kLt: a = unknown ? Unknown(1) : Bool(a.bits < b.bits); break;
+    case OpCode::kLe: a = unknown ? Unknown(1) : Bool(a.bits <= b.bits); break;
+    case OpCode::kGt: a = unknown ? Unknown(1) : Bool(a.bits > b.bits); break;
+    case OpCode::kGe: a = unknown ? Unknown(1) : Bool(a.bits >= b.bits); break;
+    case OpCode::kAdd:
+      a = unknown ? Unknown(width) : ExprValue{(a.bits + b.bits) & mask, 0, width};
+      break;
+    case OpCode::kSub:
+      a = unknown ? Unknown(width) : ExprValue{(a.bits - b.bits) & mask, 0, width};
+      break;
+    case OpCode::kShl:
+      a = unknown ? Unknown(a.width)
+                  : ExprValue{b.bits >= 64 ? 0 : (a.bits << b.bits) & Mask(a.width), 0, a.width};
+      break;
+    case OpCode::kShr:
+      a = unknown ? Unknown(a.width) : ExprValue{b.bits >= 64 ? 0 : a.bits >> b.bits, 0, a.width};
+      break;
+    case OpCode::kConcat:
+      // The parser makes sure the result fits.
+      a = {.bits = b.width >= 64 ? b.bits : (a.bits << b.width) | b.bits,
+           .xz = b.width >= 64 ? b.xz : (a.xz << b.width) | b.xz,
+           .width = a.width + b.width};
+      break;
+    default: break;
+    }
+  }
+  return sp > 0 ? stack_[0] : Unknown(1);
+}
+
+std::optional<uint64_t> FindExprMatch(WaveExpr &expr, const ExprWaves &waves, uint64_t time,
+                                      bool forward) {
+  TransitionWalker walker(waves, time, forward);
+  const auto set = ExprSetter(expr);
+  walker.LoadAll(set);
+  if (forward) {
+    bool prev = expr.Evaluate().IsTrue();
+    while (walker.Step(set)) {
+      const bool current = expr.Evaluate().IsTrue();
+      if (current && !prev) return walker.Time();
+      prev = current;
+    }
+  } else {
+    bool current = expr.Evaluate().IsTrue();
+    uint64_t start = walker.Time();
+    while (walker.Step(set)) {
+      const bool before = expr.Evaluate().IsTrue();
+      // A match that starts exactly at the given time is not before it.
+      if (current && !before && start < time) return start;
+      current = before;
+      start = walker.Time();
+    }
+  }
+  return std::nullopt;
+}
+
+int CountExprMatches(WaveExpr &expr, const ExprWaves &waves, uint64_t start_time,
+                     uint64_t end_time) {
+  // Start just before the window, so that a match right at the start is seen as a change.
+  const bool at_zero = start_time == 0;
+  TransitionWalker walker(waves, at_zero ? 0 : start_time - 1, /*forward*/ true);
+  const auto set = ExprSetter(expr);
+  walker.LoadAll(set);
+  bool prev = expr.Evaluate().IsTrue();
+  int count = at_zero && prev ? 1 : 0;
+  while (walker.Step(set) && walker.Time() <= end_time) {
+    const bool current = expr.Evaluate().IsTrue();
+    if (current && !prev) count++;
+    prev = current;
+  }
+  return count;
+}
+
+std::string FormatExprValue(const ExprValue &value) {
+  std::string s(value.width, '0');
+  for (int b = 0; b < value.width; ++b) {
+    const uint64_t bit = uint64_t{1} << b;
+    char &c = s[value.width - 1 - b];
+    if (value.xz & bit) {
+      c = 'x';
+    } else if (value.bits & bit) {
+      c = '1';
+    }
+  }
+  return s;
+}
+
+std::optional<uint64_t> LastRisingEdge(const std::vector<WaveData::Sample> &clock, uint64_t time) {
+  const auto high = [&](int i) { return !clock[i].value.empty() && clock[i].value.back() == '1'; };
+  const auto after =
+      std::upper_bound(clock.begin(), clock.end(), time,
+                       [](uint64_t t, const WaveData::Sample &s) { return t < s.time; });
+  // The first sample has nothing before it to rise from.
+  for (int i = after - clock.begin() - 1; i > 0; --i) {
+    if (high(i) && !high(i - 1)) return clock[i].time;
+  }
+  return std::nullopt;
+}
+
+std::vector<WaveData::Sample> ExprWave(WaveExpr &expr, const ExprWaves &waves,
+                                       uint64_t start_time, uint64_t end_time,
+                                       const std::vector<WaveData::Sample> *clock) {
+  std::vector<WaveData::Sample> result;
+  const auto add = [&](uint64_t time, std::string value) {
+    if (!result.empty() && result.back().value == value) return;
+    result.push_back({.time = time, .value = std::move(value)});
+  };
+  if (clock == nullptr) {
+    TransitionWalker walker(waves, start_time, /*forward*/ true);
+    const auto set = ExprSetter(expr);
+    walker.LoadAll(set);
+    add(start_time, FormatExprValue(expr.Evaluate()));
+    while (walker.Step(set) && walker.Time() <= end_time) {
+      add(walker.Time(), FormatExprValue(expr.Evaluate()));
+    }
+    return result;
+  }
+  // The value held coming into the range was sampled just before the last edge ahead of it.
+  ExprValue held = Unknown(expr.Width());
+  if (const auto edge = LastRisingEdge(*clock, start_time); edge && *edge > 0) {
+    for (int i = 0; i < waves.size(); ++i) {
+      const auto &wave = *waves[i];
+      const auto after =
+          std::upper_bound(wave.begin(), wave.end(), *edge - 1,
+                           [](uint64_t t, const WaveData::Sample &s) { return t < s.time; });
+      ExprSetter(expr)(i, after == wave.begin() ? nullptr : &*std::prev(after));
+    }
+    held = expr.Evaluate();
+  }
+  // The clock is walked as one more input after the expression inputs.
+  ExprWaves all_waves = waves;
+  all_waves.push_back(clock);
+  const int clock_input = waves.size();
+  bool clock_high = false;
+  bool clock_rose = false;
+  bool inputs_changed = false;
+  const auto set = [&](int input, const WaveData::Sample *sample) {
+    if (input == clock_input) {
+      const bool high = sample != nullptr && !sample->value.empty() && sample->value.back() == '1';
+      clock_rose = high && !clock_high;
+      clock_high = high;
+    } else {
+      ExprSetter(expr)(input, sample);
+      inputs_changed = true;
+    }
+  };
+  TransitionWalker walker(all_waves, start_time, /*forward*/ true);
+  walker.LoadAll(set);
+  ExprValue current = expr.Evaluate();
+  add(start_time, FormatExprValue(held));
+  clock_rose = false;
+  inputs_changed = false;
+  while (walker.Step(set) && walker.Time() <= end_time) {
+    // Inputs that change at the same time as the clock edge are too late for it.
+    if (clock_rose) add(walker.Time(), FormatExprValue(current));
+    clock_rose = false;
+    if (inputs_changed) current = expr.Evaluate();
+    inputs_changed = false;
+  }
+  return result;
+}
+
+} // namespace sv
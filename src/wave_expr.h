@@ -0,0 +1,127 @@
+#pragma once
+
+#include "absl/status/statusor.h"
+#include "wave_data.h"
+
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// Four-state value of up to 64 bits. Bits that are set in xz are unknown (x or z), and their
+// corresponding bits in the value are zero.
+struct ExprValue {
+  uint64_t bits = 0;
+  uint64_t xz = 0;
+  int width = 1;
+  // True only if at least one bit is a known 1, like a Verilog if-condition.
+  bool IsTrue() const { return (bits & ~xz) != 0; }
+};
+
+// A boolean/arithmetic expression over signals, using a subset of SystemVerilog syntax, such as
+// "valid && ready && addr[31:28] == 4'h8" or "{a, b[3:0]} + 1". It is compiled once into a small
+// stack program, and then evaluated each time one of its input signals changes.
+class WaveExpr {
+ public:
+  // Looks up a signal by the name used in the expression. Returns nullptr if there is none.
+  using Resolver = std::function<const WaveData::Signal *(std::string_view name)>;
+  static absl::StatusOr<WaveExpr> Compile(std::string_view text, const Resolver &resolve);
+  // Distinct signals used in the expression, in input order.
+  const std::vector<const WaveData::Signal *> &Inputs() const { return inputs_; }
+  // Updates the current sample value of an input. Bit selects of it are extracted here, so that
+  // Evaluate() does not need to look at strings.
+  void SetInput(int input, std::string_view value);
+  // Marks the input as unknown, for times before its first sample.
+  void ClearInput(int input);
+  ExprValue Evaluate() const;
+  // Width of the result, which does not depend on the input values.
+  int Width() const { return width_; }
+  // The expression text with every signal name replaced, for example by its full path.
+  std::string Text(const std::function<std::string(const WaveData::Signal *)> &rename) const;
+
+ private:
+  friend class ExprParser;
+  struct Leaf {
+    int input;
+    int lsb; // Bit offsets from the least significant bit of the signal.
+    int width;
+  };
+  enum class OpCode : uint8_t {
+    kLeaf,
+    kConst,
+    // Unary
+    kLogicalNot,
+    kBitNot,
+    kNegate,
+    kReduceAnd,
+    kReduceOr,
+    kReduceXor,
+    // Binary
+    kAnd,
+    kOr,
+    kXor,
+    kLogicalAnd,
+    kLogicalOr,
+    kEq,
+    kNe,
+    kLt,
+    kLe,
+    kGt,
+    kGe,
+    kAdd,
+    kSub,
+    kShl,
+    kShr,
+    kConcat,
+  };
+  struct Op {
+    OpCode code;
+    int arg = 0; // Leaf or constant index.
+  };
+  std::vector<const WaveData::Signal *> inputs_;
+  std::vector<Leaf> leaves_;
+  std::vector<ExprValue> leaf_values_;
+  // Which leaves use each input.
+  std::vector<std::vector<int>> input_leaves_;
+  std::vector<ExprValue> constants_;
+  // Postfix program.
+  std::vector<Op> program_;
+  int max_stack_ = 0;
+  mutable std::vector<ExprValue> stack_;
+  int width_ = 1;
+  // Source text, with the location of each signal name in it.
+  struct Name {
+    size_t pos;
+    size_t length;
+    int input;
+  };
+  std::string text_;
+  std::vector<Name> names_;
+};
+
+// Sample data for each input of an expression, in the order of WaveExpr::Inputs().
+using ExprWaves = std::vector<const std::vector<WaveData::Sample> *>;
+
+// Finds the first time after (or the last time before) the given time at which the expression
+// becomes true. Only times at which one of the inputs changes are evaluated. The waves must cover
+// the searched range.
+std::optional<uint64_t> FindExprMatch(WaveExpr &expr, const ExprWaves &waves, uint64_t time,
+                                      bool forward);
+// Number of times the expression becomes true within [start_time, end_time].
+int CountExprMatches(WaveExpr &expr, const ExprWaves &waves, uint64_t start_time,
+                     uint64_t end_time);
+// Binary string of the value, with x for unknown bits.
+std::string FormatExprValue(const ExprValue &value);
+// Time of the last rising edge of the clock at or before the given time, if the samples have one.
+std::optional<uint64_t> LastRisingEdge(const std::vector<WaveData::Sample> &clock, uint64_t time);
+// Computes the expression as a wave over [start_time, end_time], with a sample at the start time
+// and wherever the result changes. When a clock is given, the result is instead sampled just
+// before each of its rising edges, like a flip-flop. Until the first edge in the range it holds
+// the value sampled at the last edge before it, or unknown if the waves don't reach back that far.
+std::vector<WaveData::Sample> ExprWave(WaveExpr &expr, const ExprWaves &waves,
+                                       uint64_t start_time, uint64_t end_time,
+                                       const std::vector<WaveData::Sample> *clock = nullptr);
+
+} // namespace sv
@@ -0,0 +1,164 @@
+#include "wave_expr.h"
+
+#include "external/googletest/googletest/include/gtest/gtest.h"
+
+namespace sv {
+namespace {
+
+class WaveExprTest : public testing::Test {
+ protected:
+  WaveExprTest() {
+    a_.name = "a";
+    a_.width = 1;
+    b_.name = "b";
+    b_.width = 1;
+    bus_.name = "bus";
+    bus_.width = 8;
+    bus_.lsb = 0;
+  }
+
+  absl::StatusOr<WaveExpr> Compile(std::string_view text) {
+    return WaveExpr::Compile(text, [&](std::string_view name) -> const WaveData::Signal * {
+      for (const WaveData::Signal *s : {&a_, &b_, &bus_}) {
+        if (s->name == name) return s;
+      }
+      return nullptr;
+    });
+  }
+
+  WaveData::Signal a_, b_, bus_;
+};
+
+TEST_F(WaveExprTest, CompileErrors) {
+  EXPECT_FALSE(Compile("a &&").ok());
+  EXPECT_FALSE(Compile("c").ok());
+  EXPECT_FALSE(Compile("(a").ok());
+  EXPECT_FALSE(Compile("bus[8]").ok());
+  EXPECT_FALSE(Compile("a b").ok());
+  EXPECT_FALSE(Compile("8'q1").ok());
+}
+
+TEST_F(WaveExprTest, Evaluate) {
+  auto expr = Compile("a && !b && bus[7:4] == 4'ha");
+  ASSERT_TRUE(expr.ok());
+  ASSERT_EQ(expr->Inputs().size(), 3);
+  expr->SetInput(0, "1");
+  expr->SetInput(1, "0");
+  expr->SetInput(2, "10100000");
+  EXPECT_TRUE(expr->Evaluate().IsTrue());
+  expr->SetInput(2, "10010000");
+  EXPECT_FALSE(expr->Evaluate().IsTrue());
+  // Short VCD style values are zero extended.
+  expr = Compile("bus == 3 && bus + 1 > 3'd3");
+  ASSERT_TRUE(expr.ok());
+  expr->SetInput(0, "11");
+  EXPECT_TRUE(expr->Evaluate().IsTrue());
+}
+
+TEST_F(WaveExprTest, ConcatAndText) {
+  auto expr = Compile("{a, bus[3:0]} + 5'd1");
+  ASSERT_TRUE(expr.ok());
+  EXPECT_EQ(expr->Width(), 5);
+  expr->SetInput(0, "1");
+  expr->SetInput(1, "0011");
+  EXPECT_EQ(FormatExprValue(expr->Evaluate()), "10100");
+  expr->SetInput(0, "x");
+  EXPECT_EQ(FormatExprValue(expr->Evaluate()), "xxxxx");
+  EXPECT_EQ(expr->Text([](const WaveData::Signal *s) { return "top." + s->name; }),
+            "{top.a, top.bus[3:0]} + 5'd1");
+  EXPECT_FALSE(Compile("{bus, bus, bus, bus, bus, bus, bus, bus, a}").ok());
+}
+
+TEST_F(WaveExprTest, FourState) {
+  auto expr = Compile("a | b");
+  ASSERT_TRUE(expr.ok());
+  expr->SetInput(0, "1");
+  expr->ClearInput(1);
+  EXPECT_TRUE(expr->Evaluate().IsTrue());
+  expr = Compile("a && b");
+  ASSERT_TRUE(expr.ok());
+  expr->SetInput(0, "0");
+  expr->SetInput(1, "x");
+  ExprValue v = expr->Evaluate();
+  EXPECT_EQ(v.bits, 0);
+  EXPECT_EQ(v.xz, 0);
+  expr->SetInput(0, "1");
+  EXPECT_EQ(expr->Evaluate().xz, 1);
+  // Known bits that differ make the comparison false, even with unknown bits.
+  expr = Compile("bus == 8'b1x");
+  ASSERT_TRUE(expr.ok());
+  expr->SetInput(0, "01");
+  v = expr->Evaluate();
+  EXPECT_EQ(v.bits, 0);
+  EXPECT_EQ(v.xz, 0);
+  expr->SetInput(0, "11");
+  EXPECT_EQ(expr->Evaluate().xz, 1);
+}
+
+TEST_F(WaveExprTest, FindAndCount) {
+  auto expr = Compile("a && b");
+  ASSERT_TRUE(expr.ok());
+  const std::vector<WaveData::Sample> a = {
+      {0, "0"}, {10, "1"}, {30, "0"}, {50, "1"}, {80, "0"},
+  };
+  const std::vector<WaveData::Sample> b = {
+      {0, "1"}, {20, "0"}, {25, "1"}, {60, "0"}, {60, "1"}, {70, "0"},
+  };
+  const ExprWaves waves = {&a, &b};
+  EXPECT_EQ(FindExprMatch(*expr, waves, 0, true), 10);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 10, true), 25);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 25, true), 50);
+  // The 60 glitch on b is not a new match.
+  EXPECT_EQ(FindExprMatch(*expr, waves, 50, true), std::nullopt);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 100, false), 50);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 50, false), 25);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 12, false), 10);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 10, false), std::nullopt);
+  EXPECT_EQ(CountExprMatches(*expr, waves, 0, 100), 3);
+  EXPECT_EQ(CountExprMatches(*expr, waves, 10, 25), 2);
+  EXPECT_EQ(CountExprMatches(*expr, waves, 11, 49), 1);
+}
+
+TEST_F(WaveExprTest, ExprWave) {
+  auto expr = Compile("a ^ b");
+  ASSERT_TRUE(expr.ok());
+  const std::vector<WaveData::Sample> a = {{0, "0"}, {10, "1"}, {30, "0"}};
+  const std::vector<WaveData::Sample> b = {{0, "0"}, {20, "1"}, {30, "1"}};
+  const std::vector<WaveData::Sample> wave = ExprWave(*expr, {&a, &b}, 5, 25);
+  ASSERT_EQ(wave.size(), 3);
+  EXPECT_EQ(wave[0].time, 5);
+  EXPECT_EQ(wave[0].value, "0");
+  EXPECT_EQ(wave[1].time, 10);
+  EXPECT_EQ(wave[1].value, "1");
+  EXPECT_EQ(wave[2].time, 20);
+  EXPECT_EQ(wave[2].value, "0");
+  // Sampled on the rising edges at 10 and 30, just before b changes at 30.
+  const std::vector<WaveData::Sample> clk = {{0, "0"}, {10, "1"}, {20, "0"}, {30, "1"}};
+  const std::vector<WaveData::Sample> b2 = {{0, "1"}, {30, "0"}};
+  const std::vector<WaveData::Sample> sampled = ExprWave(*expr, {&a, &b2}, 0, 40, &clk);
+  ASSERT_EQ(sampled.size(), 3);
+  EXPECT_EQ(sampled[0].value, "x");
+  EXPECT_EQ(sampled[1].time, 10);
+  EXPECT_EQ(sampled[1].value, "1");
+  EXPECT_EQ(sampled[2].time, 30);
+  EXPECT_EQ(sampled[2].value, "0");
+  // A range that starts after an edge holds the value sampled at that edge.
+  const std::vector<WaveData::Sample> later = ExprWave(*expr, {&a, &b2}, 15, 40, &clk);
+  ASSERT_EQ(later.size(), 2);
+  EXPECT_EQ(later[0].time, 15);
+  EXPECT_EQ(later[0].value, "1");
+  EXPECT_EQ(later[1].time, 30);
+  EXPECT_EQ(later[1].value, "0");
+}
+
+TEST_F(WaveExprTest, MatchAtTimeZero) {
+  auto expr = Compile("!a");
+  ASSERT_TRUE(expr.ok());
+  const std::vector<WaveData::Sample> a = {{0, "0"}, {10, "1"}};
+  const ExprWaves waves = {&a};
+  EXPECT_EQ(CountExprMatches(*expr, waves, 0, 100), 1);
+  EXPECT_EQ(FindExprMatch(*expr, waves, 50, false), 0);
+}
+
+} // namespace
+} // namespace sv
@@ -0,0 +1,393 @@
+#include "wave_property.h"
+
+#include "absl/strings/str_format.h"
+#include "parallel.h"
+#include "wave_search.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <span>
+
+namespace sv {
+namespace {
+
+// Attempts started per block of sampled cycles.
+constexpr int kBlockCycles = 4096;
+
+std::string_view Trim(std::string_view text) {
+  while (!text.empty() && std::isspace(text.front())) text.remove_prefix(1);
+  while (!text.empty() && std::isspace(text.back())) text.remove_suffix(1);
+  return text;
+}
+
+bool IsWordChar(char c) { return std::isalnum(c) || c == '_' || c == '$'; }
+
+// Removes a leading keyword, which must not be followed by more word characters.
+bool ConsumeWord(std::string_view *text, std::string_view word) {
+  const std::string_view t = Trim(*text);
+  if (!t.starts_with(word) || (t.size() > word.size() && IsWordChar(t[word.size()]))) {
+    return false;
+  }
+  *text = Trim(t.substr(word.size()));
+  return true;
+}
+
+// Position of the parenthesis that closes the one at open, or npos.
+size_t MatchingParen(std::string_view text, size_t open) {
+  int depth = 0;
+  for (size_t i = open; i < text.size(); ++i) {
+    if (text[i] == '(') {
+      depth++;
+    } else if (text[i] == ')' && --depth == 0) {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+// Takes the contents of a parenthesized group at the start of the text, leaving the rest.
+absl::StatusOr<std::string_view> ConsumeParens(std::string_view *text) {
+  const std::string_view t = Trim(*text);
+  const size_t close = t.empty() || t[0] != '(' ? std::string_view::npos : MatchingParen(t, 0);
+  if (close == std::string_view::npos) {
+    return absl::InvalidArgumentError(absl::StrFormat("Expected (...) at: %s", t));
+  }
+  *text = Trim(t.substr(close + 1));
+  return Trim(t.substr(1, close - 1));
+}
+
+// Finds a token outside of any brackets.
+size_t FindTopLevel(std::string_view text, std::string_view token, size_t from = 0) {
+  int depth = 0;
+  for (size_t i = from; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '(' || c == '[' || c == '{') {
+      depth++;
+    } else if (c == ')' || c == ']' || c == '}') {
+      depth--;
+    } else if (depth == 0 && text.substr(i).starts_with(token)) {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+uint64_t Mask(int width) { return width >= 64 ? ~uint64_t{0} : (uint64_t{1} << width) - 1; }
+
+ExprValue Unknown(int width) { return {.bits = 0, .xz = Mask(width), .width = width}; }
+
+} // namespace
+
+absl::StatusOr<WaveProperty> WaveProperty::Compile(std::string_view text,
+                                                   const WaveExpr::Resolver &resolve) {
+  WaveProperty prop;
+  prop.text_ = Trim(text);
+  std::string_view t = prop.text_;
+  // A label in front of the statement.
+  size_t label_end = 0;
+  while (label_end < t.size() && IsWordChar(t[label_end])) label_end++;
+  const std::string_view after_label = Trim(t.substr(label_end));
+  if (label_end > 0 && after_label.starts_with(':') && !after_label.starts_with("::")) {
+    t = Trim(after_label.substr(1));
+  }
+  if (ConsumeWord(&t, "assert") || ConsumeWord(&t, "assume")) {
+    if (!ConsumeWord(&t, "property")) {
+      return absl::InvalidArgumentError("Only assert property statements are supported.");
+    }
+    // The action block after the property is of no use here.
+    auto body = ConsumeParens(&t);
+    if (!body.ok()) return body.status();
+    t = *body;
+  } else if (t.ends_with(';')) {
+    t = Trim(t.substr(0, t.size() - 1));
+  }
+  // Clock.
+  if (!t.starts_with('@')) {
+    return absl::InvalidArgumentError("The property needs a clock, such as @(posedge clk).");
+  }
+  t.remove_prefix(1);
+  auto clocking = ConsumeParens(&t);
+  if (!clocking.ok()) return clocking.status();
+  if (!ConsumeWord(&*clocking, "posedge")) {
+    return absl::InvalidArgumentError("Only posedge clocks are supported.");
+  }
+  const WaveData::Signal *clock = resolve(*clocking);
+  if (clock == nullptr) {
+    return absl::InvalidArgumentError(absl::StrFormat("Unknown clock: %s", *clocking));
+  }
+  prop.inputs_.push_back(clock);
+  if (ConsumeWord(&t, "disable")) {
+    if (!ConsumeWord(&t, "iff")) return absl::InvalidArgumentError("Expected iff after disable.");
+    auto condition = ConsumeParens(&t);
+    if (!condition.ok()) return condition.status();
+    auto expr = prop.AddExpr(*condition, resolve);
+    if (!expr.ok()) return expr.status();
+    prop.disable_ = *expr;
+  }
+  // Implication.
+  size_t pos = FindTopLevel(t, "|->");
+  const bool overlapped = pos != std::string_view::npos;
+  if (!overlapped) pos = FindTopLevel(t, "|=>");
+  int consequent_offset = 0;
+  if (pos != std::string_view::npos) {
+    int antecedent_end = 0;
+    if (auto status = prop.ParseSequence(t.substr(0, pos), 0, &prop.antecedent_, &antecedent_end,
+                                         resolve);
+        !status.ok()) {
+      return status;
+    }
+    consequent_offset = antecedent_end + (overlapped ? 0 : 1);
+    t = t.substr(pos + 3);
+  }
+  if (auto status = prop.ParseSequence(t, consequent_offset, &prop.consequent_, &prop.length_,
+                                       resolve);
+      !status.ok()) {
+    return status;
+  }
+  // Checked in time order, so the reported failure is the first one.
+  std::stable_sort(prop.consequent_.begin(), prop.consequent_.end(),
+                   [](const Step &a, const Step &b) { return a.offset < b.offset; });
+  prop.input_values_.resize(prop.inputs_.size());
+  prop.sampled_values_.resize(prop.sampled_.size());
+  return prop;
+}
+
+absl::Status WaveProperty::ParseSequence(std::string_view text, int offset,
+                                         std::vector<Step> *steps, int *end_offset,
+                                         const WaveExpr::Resolver &resolve) {
+  text = Trim(text);
+  // Parentheses around a whole sequence.
+  while (text.starts_with('(') && MatchingParen(text, 0) == text.size() - 1) {
+    text = Trim(text.substr(1, text.size() - 2));
+  }
+  size_t pos = 0;
+  bool first = true;
+  while (true) {
+    const size_t delay = FindTopLevel(text, "##", pos);
+    const std::string_view term = Trim(text.substr(pos, delay - pos));
+    if (!term.empty()) {
+      auto expr = AddExpr(term, resolve);
+      if (!expr.ok()) return expr.status();
+      steps->push_back({.offset = offset, .expr = *expr});
+    } else if (!first || delay == std::string_view::npos) {
+      return absl::InvalidArgumentError(absl::StrFormat("Missing expression in: %s", text));
+    }
+    if (delay == std::string_view::npos) break;
+    first = false;
+    pos = delay + 2;
+    int cycles = 0;
+    const size_t digits = pos;
+    while (pos < text.size() && std::isdigit(text[pos])) {
+      cycles = cycles * 10 + (text[pos++] - '0');
+    }
+    if (pos == digits) {
+      return absl::InvalidArgumentError("Only fixed ##N delays are supported.");
+    }
+    offset += cycles;
+  }
+  *end_offset = offset;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int> WaveProperty::AddExpr(std::string_view text,
+                                          const WaveExpr::Resolver &resolve) {
+  // Sampled value functions are computed separately, and stand in as synthetic signals.
+  std::string rewritten;
+  std::vector<std::pair<std::string, const WaveData::Signal *>> synthetic;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    const size_t dollar = text.find('$', pos);
+    if (dollar == std::string_view::npos) break;
+    if (dollar > 0 && IsWordChar(text[dollar - 1])) {
+      // Part of an identifier.
+      rewritten.append(text.substr(pos, dollar + 1 - pos));
+      pos = dollar + 1;
+      continue;
+    }
+    size_t name_end = dollar + 1;
+    while (name_end < text.size() && IsWordChar(text[name_end])) name_end++;
+    const std::string_view name = text.substr(dollar, name_end - dollar);
+    Sampled kind;
+    if (name == "$rose") {
+      kind = Sampled::kRose;
+    } else if (name == "$fell") {
+      kind = Sampled::kFell;
+    } else if (name == "$stable") {
+      kind = Sampled::kStable;
+    } else if (name == "$past") {
+      kind = Sampled::kPast;
+    } else {
+      return absl::InvalidArgumentError(absl::StrFormat("Unsupported function: %s", name));
+    }
+    size_t open = name_end;
+    while (open < text.size() && std::isspace(text[open])) open++;
+    const bool has_args = open < text.size() && text[open] == '(';
+    const size_t close = has_args ? MatchingParen(text, open) : std::string_view::npos;
+    if (close == std::string_view::npos) {
+      return absl::InvalidArgumentError(absl::StrFormat("Expected (...) after %s", name));
+    }
+    const std::string_view arg = Trim(text.substr(open + 1, close - open - 1));
+    if (FindTopLevel(arg, ",") != std::string_view::npos) {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Only one argument is supported: %s", name));
+    }
+    auto inner = AddExpr(arg, resolve);
+    if (!inner.ok()) return inner.status();
+    auto signal = std::make_unique<WaveData::Signal>();
+    signal->name = absl::StrFormat("%s(%s)", name, arg);
+    signal->width = kind == Sampled::kPast ? exprs_[*inner].Width() : 1;
+    signal->id = std::numeric_limits<uint32_t>::max();
+    // Not a valid SystemVerilog name, but the expression lexer takes it as one.
+    const std::string stand_in = absl::StrFormat("__sampled%d", sampled_.size());
+    synthetic.emplace_back(stand_in, signal.get());
+    sampled_.push_back({.kind = kind, .expr = *inner, .signal = std::move(signal)});
+    rewritten.append(text.substr(pos, dollar - pos));
+    rewritten.append(stand_in);
+    pos = close + 1;
+  }
+  rewritten.append(text.substr(pos));
+  auto expr = WaveExpr::Compile(rewritten, [&](std::string_view name) {
+    for (const auto &[stand_in, signal] : synthetic) {
+      if (name == stand_in) return signal;
+    }
+    return resolve(name);
+  });
+  if (!expr.ok()) return expr.status();
+  std::vector<int> inputs;
+  for (const WaveData::Signal *signal : expr->Inputs()) {
+    const auto sampled = std::find_if(sampled_.begin(), sampled_.end(),
+                                      [&](const auto &s) { return s.signal.get() == signal; });
+    if (sampled != sampled_.end()) {
+      inputs.push_back(-1 - static_cast<int>(sampled - sampled_.begin()));
+      continue;
+    }
+    auto it = std::find(inputs_.begin(), inputs_.end(), signal);
+    if (it == inputs_.end()) it = inputs_.insert(it, signal);
+    inputs.push_back(it - inputs_.begin());
+  }
+  exprs_.push_back(*std::move(expr));
+  expr_inputs_.push_back(std::move(inputs));
+  return exprs_.size() - 1;
+}
+
+void WaveProperty::SetInputs(int expr, int cycle) {
+  for (int i = 0; i < expr_inputs_[expr].size(); ++i) {
+    const int input = expr_inputs_[expr][i];
+    const std::string_view value =
+        input >= 0 ? input_values_[input][cycle] : std::string_view(sampled_values_[-1 - input]);
+    if (value.empty()) {
+      exprs_[expr].ClearInput(i);
+    } else {
+      exprs_[expr].SetInput(i, value);
+    }
+  }
+}
+
+WaveProperty::Result WaveProperty::Check(const ExprWaves &waves, uint64_t start_time,
+                                         uint64_t end_time) {
+  Result result;
+  const std::vector<uint64_t> edges =
+      RisingEdges(*waves[0], 0, std::numeric_limits<uint64_t>::max());
+  const int first = std::lower_bound(edges.begin(), edges.end(), start_time) - edges.begin();
+  const int last = std::upper_bound(edges.begin(), edges.end(), end_time) - edges.begin();
+  // Truth of each expression at each cycle of the block. Expressions only used by sampled
+  // functions are left out.
+  std::vector<std::vector<uint8_t>> truth(exprs_.size());
+  std::vector<bool> checked(exprs_.size());
+  for (const Step &step : antecedent_) checked[step.expr] = true;
+  for (const Step &step : consequent_) checked[step.expr] = true;
+  if (disable_ >= 0) checked[disable_] = true;
+  std::vector<ExprValue> previous(sampled_.size());
+  // Previous values as of the last cycle of a block, for the next block to continue from. The
+  // cycles that a block samples past its end for the longer attempts leave previous beyond that.
+  std::vector<ExprValue> carried;
+  // Sampled functions need the cycles before the first attempt, one more for each level of
+  // nesting, which is at most the number of them.
+  const int lookback = sampled_.size();
+  for (int block = first; block < last; block += kBlockCycles) {
+    const int block_end = std::min(last, block + kBlockCycles);
+    // The cycles before the first block only provide the previous values of sampled functions.
+    const int from = block == first ? std::max(0, first - lookback) : block;
+    if (block != first) previous = carried;
+    const int to = std::min<int>(edges.size(), block_end + length_);
+    const std::span<const uint64_t> times(edges.data() + from, to - from);
+    for (int i = 0; i < inputs_.size(); ++i) {
+      SampleBefore(*waves[i], times, &input_values_[i]);
+    }
+    for (auto &t : truth) t.assign(times.size(), 0);
+    for (int c = 0; c < times.size(); ++c) {
+      for (int s = 0; s < sampled_.size(); ++s) {
+        const SampledFunction &f = sampled_[s];
+        SetInputs(f.expr, c);
+        const ExprValue now = exprs_[f.expr].Evaluate();
+        // Before the first clock edge, or the first cycle looked at, everything is unknown.
+        const ExprValue past = block == first && c == 0 ? Unknown(now.width) : previous[s];
+        const auto lsb = [](const ExprValue &v, int bit) {
+          return (v.xz & 1) == 0 && (v.bits & 1) == bit;
+        };
+        bool value = false;
+        switch (f.kind) {
+        case Sampled::kRose: value = lsb(now, 1) && !lsb(past, 1); break;
+        case Sampled::kFell: value = lsb(now, 0) && !lsb(past, 0); break;
+        case Sampled::kStable: value = now.bits == past.bits && now.xz == past.xz; break;
+        case Sampled::kPast: break;
+        }
+        sampled_values_[s] = f.kind == Sampled::kPast ? FormatExprValue(past) : value ? "1" : "0";
+        previous[s] = now;
+      }
+      if (from + c == block_end - 1) carried = previous;
+      for (int e = 0; e < exprs_.size(); ++e) {
+        if (!checked[e]) continue;
+        SetInputs(e, c);
+        truth[e][c] = exprs_[e].Evaluate().IsTrue();
+      }
+    }
+    for (int start = block; start < block_end; ++start) {
+      // The attempt does not complete within the waves.
+      if (start + length_ >= edges.size()) break;
+      const int c = start - from;
+      if (disable_ >= 0 &&
+          std::any_of(truth[disable_].begin() + c, truth[disable_].begin() + c + length_ + 1,
+                      [](uint8_t t) { return t != 0; })) {
+        continue;
+      }
+      result.num_attempts++;
+      const bool matched = std::all_of(antecedent_.begin(), antecedent_.end(), [&](const Step &s) {
+        return truth[s.expr][c + s.offset] != 0;
+      });
+      if (!matched) {
+        result.num_vacuous++;
+        continue;
+      }
+      for (const Step &step : consequent_) {
+        if (!truth[step.expr][c + step.offset]) {
+          result.failures.push_back({edges[start], edges[start + step.offset]});
+          break;
+        }
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<WaveProperty::Result> CheckProperties(std::vector<WaveProperty> *properties,
+                                                  const WaveData &waves, uint64_t start_time,
+                                                  uint64_t end_time) {
+  std::vector<ExprWaves> inputs;
+  for (const WaveProperty &prop : *properties) {
+    inputs.emplace_back();
+    for (const WaveData::Signal *signal : prop.Inputs()) {
+      inputs.back().push_back(&waves.LoadedWave(signal));
+    }
+  }
+  std::vector<WaveProperty::Result> results(properties->size());
+  ParallelChunks(properties->size(), 1, [&](int, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      results[i] = (*properties)[i].Check(inputs[i], start_time, end_time);
+    }
+  });
+  return results;
+}
+
+} // namespace sv
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "absl/status/statusor.h"
+#include "wave_data.h"
+#include "wave_expr.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// A concurrent assertion in a subset of SVA, checked against waves instead of a simulation, such
+// as "@(posedge clk) disable iff (rst) $rose(req) |-> ##2 ack". Supported are a posedge clock, an
+// optional disable iff condition, sequences of boolean expressions joined by fixed ##N delays, and
+// the |-> and |=> implications. The boolean expressions are WaveExpr expressions that may also use
+// $rose, $fell, $stable and $past of a sub-expression. Like in a simulator, an attempt starts at
+// every clock edge and values are sampled just before the edge. The disable condition is sampled
+// on the clock too, rather than asynchronously.
+class WaveProperty {
+ public:
+  // Accepts the bare property, or a whole "label: assert property (...) else ...;" statement.
+  static absl::StatusOr<WaveProperty> Compile(std::string_view text,
+                                              const WaveExpr::Resolver &resolve);
+  // Distinct signals used in the property, starting with the clock.
+  const std::vector<const WaveData::Signal *> &Inputs() const { return inputs_; }
+  // Number of clock cycles from the start of an attempt to its last check.
+  int Length() const { return length_; }
+  const std::string &Text() const { return text_; }
+
+  struct Failure {
+    uint64_t start_time; // Clock edge at which the attempt started.
+    uint64_t fail_time;  // Clock edge at which the first check failed.
+  };
+  struct Result {
+    std::vector<Failure> failures;
+    // Attempts that completed, and how many of those passed because the antecedent did not match.
+    uint64_t num_attempts = 0;
+    uint64_t num_vacuous = 0;
+  };
+  // Checks the attempts that start within [start_time, end_time], with the sample data of each
+  // input in the order of Inputs(). Attempts that run past the end of the waves are left out.
+  // Cycles are sampled a block at a time, so memory use does not grow with the length of the
+  // waves.
+  Result Check(const ExprWaves &waves, uint64_t start_time, uint64_t end_time);
+
+ private:
+  enum class Sampled { kRose, kFell, kStable, kPast };
+  struct SampledFunction {
+    Sampled kind;
+    int expr;
+    // Stands in for the function call in the expressions that use it.
+    std::unique_ptr<WaveData::Signal> signal;
+  };
+  // A boolean expression checked a number of cycles after the start of an attempt.
+  struct Step {
+    int offset;
+    int expr;
+  };
+  absl::Status ParseSequence(std::string_view text, int offset, std::vector<Step> *steps,
+                             int *end_offset, const WaveExpr::Resolver &resolve);
+  absl::StatusOr<int> AddExpr(std::string_view text, const WaveExpr::Resolver &resolve);
+  // Sets the inputs of an expression to their values at the given cycle of the current block.
+  void SetInputs(int expr, int cycle);
+
+  std::string text_;
+  std::vector<const WaveData::Signal *> inputs_;
+  std::vector<WaveExpr> exprs_;
+  // For each input of each expression, the index into inputs_, or -1 - the sampled function index.
+  std::vector<std::vector<int>> expr_inputs_;
+  std::vector<SampledFunction> sampled_;
+  std::vector<Step> antecedent_;
+  std::vector<Step> consequent_;
+  int disable_ = -1;
+  int length_ = 0;
+  // Scratch values of the current block, per input and per sampled function.
+  std::vector<std::vector<std::string_view>> input_values_;
+  std::vector<std::string> sampled_values_;
+};
+
+// Checks each property on its own thread. The waves of all their inputs must already be loaded.
+std::vector<WaveProperty::Result> CheckProperties(std::vector<WaveProperty> *properties,
+                                                  const WaveData &waves, uint64_t start_time,
+                                                  uint64_t end_time);
+
+} // namespace sv
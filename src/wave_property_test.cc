@@ -0,0 +1,149 @@
+#include "wave_property.h"
+
+#include "external/googletest/googletest/include/gtest/gtest.h"
+#include "test_waves.h"
+
+namespace sv {
+namespace {
+
+class WavePropertyTest : public testing::Test {
+ protected:
+  WavePropertyTest() {
+    for (const char *name : {"clk", "req", "ack", "rst"}) {
+      WaveData::Signal s;
+      s.name = name;
+      s.width = 1;
+      s.id = signals_.size();
+      signals_.push_back(s);
+    }
+  }
+  WaveProperty Compile(std::string_view text) {
+    auto prop = WaveProperty::Compile(text, [&](std::string_view name) {
+      for (const auto &s : signals_) {
+        if (s.name == name) return &s;
+      }
+      return static_cast<const WaveData::Signal *>(nullptr);
+    });
+    EXPECT_TRUE(prop.ok()) << prop.status();
+    return *std::move(prop);
+  }
+  WaveProperty::Result Check(WaveProperty &prop) {
+    ExprWaves inputs;
+    for (const WaveData::Signal *s : prop.Inputs()) {
+      inputs.push_back(&waves_[s->id]);
+    }
+    return prop.Check(inputs, 0, 1000);
+  }
+  std::vector<WaveData::Signal> signals_;
+  std::vector<std::vector<WaveData::Sample>> waves_ = {
+      MakeClock(8),
+      MakeWave({"0", "1", "0", "0", "1", "0", "0", "0"}),
+      MakeWave({"0", "0", "0", "1", "0", "0", "0", "0"}),
+      MakeWave({"0", "0", "0", "0", "1", "1", "1", "1"}),
+  };
+};
+
+TEST_F(WavePropertyTest, Implication) {
+  WaveProperty prop = Compile("@(posedge clk) req |-> ##2 ack");
+  EXPECT_EQ(prop.Length(), 2);
+  const auto result = Check(prop);
+  // Six attempts complete, of which two have req high. The second request is never acked.
+  EXPECT_EQ(result.num_attempts, 6);
+  EXPECT_EQ(result.num_vacuous, 4);
+  ASSERT_EQ(result.failures.size(), 1);
+  EXPECT_EQ(result.failures[0].start_time, 45);
+  EXPECT_EQ(result.failures[0].fail_time, 65);
+}
+
+TEST_F(WavePropertyTest, DisableAndStatement) {
+  WaveProperty prop =
+      Compile("chk: assert property (@(posedge clk) disable iff (rst) req |=> ##1 ack) else "
+              "$error(\"no ack\");");
+  const auto result = Check(prop);
+  EXPECT_TRUE(result.failures.empty());
+  EXPECT_EQ(result.num_attempts, 2);
+}
+
+TEST_F(WavePropertyTest, SampledFunctions) {
+  WaveProperty rose = Compile("@(posedge clk) $rose(rst) |-> !$past(req) && !$stable(rst)");
+  EXPECT_EQ(rose.Inputs().size(), 3);
+  const auto result = Check(rose);
+  EXPECT_EQ(result.num_attempts, 8);
+  EXPECT_EQ(result.num_vacuous, 7);
+  EXPECT_TRUE(result.failures.empty());
+  WaveProperty fell = Compile("@(posedge clk) $fell(req) |-> ack");
+  const auto fell_result = Check(fell);
+  // The unknown value before the first edge falling to 0 counts as well.
+  ASSERT_EQ(fell_result.failures.size(), 3);
+  EXPECT_EQ(fell_result.failures[0].start_time, 5);
+  EXPECT_EQ(fell_result.failures[1].start_time, 25);
+  EXPECT_EQ(fell_result.failures[2].start_time, 55);
+}
+
+TEST_F(WavePropertyTest, AcrossBlocks) {
+  // Requests at cycles that straddle the blocks the cycles are sampled in, each acked a cycle
+  // later except the one at 4096.
+  waves_[0] = MakeClock(10000);
+  waves_[1].clear();
+  waves_[2].clear();
+  for (const int cycle : {100, 4094, 4096, 8191, 9000}) {
+    waves_[1].push_back({.time = static_cast<uint64_t>(cycle * 10), .value = "1"});
+    waves_[1].push_back({.time = static_cast<uint64_t>(cycle * 10 + 10), .value = "0"});
+    if (cycle == 4096) continue;
+    waves_[2].push_back({.time = static_cast<uint64_t>(cycle * 10 + 10), .value = "1"});
+    waves_[2].push_back({.time = static_cast<uint64_t>(cycle * 10 + 20), .value = "0"});
+  }
+  WaveProperty prop = Compile("@(posedge clk) $rose(req) |=> ack");
+  ExprWaves inputs;
+  for (const WaveData::Signal *s : prop.Inputs()) {
+    inputs.push_back(&waves_[s->id]);
+  }
+  const auto result = prop.Check(inputs, 0, 100000);
+  EXPECT_EQ(result.num_attempts, 9999);
+  ASSERT_EQ(result.failures.size(), 1);
+  EXPECT_EQ(result.failures[0].start_time, 40965);
+  EXPECT_EQ(result.failures[0].fail_time, 40975);
+}
+
+TEST_F(WavePropertyTest, NestedSampledFunctionsAcrossBlocks) {
+  // Requests acked two cycles later, except the one whose $past rises on the first cycle of the
+  // second block.
+  waves_[0] = MakeClock(10000);
+  waves_[1].clear();
+  waves_[2].clear();
+  for (const int cycle : {100, 4095, 9000}) {
+    waves_[1].push_back({.time = static_cast<uint64_t>(cycle * 10), .value = "1"});
+    waves_[1].push_back({.time = static_cast<uint64_t>(cycle * 10 + 10), .value = "0"});
+    if (cycle == 4095) continue;
+    waves_[2].push_back({.time = static_cast<uint64_t>(cycle * 10 + 20), .value = "1"});
+    waves_[2].push_back({.time = static_cast<uint64_t>(cycle * 10 + 30), .value = "0"});
+  }
+  for (const char *text : {"@(posedge clk) $rose($past(req)) |=> ack",
+                           "@(posedge clk) $past($past(req)) |-> ack"}) {
+    WaveProperty prop = Compile(text);
+    ExprWaves inputs;
+    for (const WaveData::Signal *s : prop.Inputs()) {
+      inputs.push_back(&waves_[s->id]);
+    }
+    // Also starting part way, where the cycles before the start are needed.
+    for (const uint64_t start_time : {0, 40000}) {
+      const auto result = prop.Check(inputs, start_time, 100000);
+      ASSERT_EQ(result.failures.size(), 1) << text << " from " << start_time;
+      EXPECT_EQ(result.failures[0].fail_time, 40975) << text << " from " << start_time;
+    }
+  }
+}
+
+TEST_F(WavePropertyTest, Errors) {
+  const auto resolve = [&](std::string_view name) -> const WaveData::Signal * {
+    return name == "clk" ? &signals_[0] : nullptr;
+  };
+  EXPECT_FALSE(WaveProperty::Compile("clk |-> clk", resolve).ok());
+  EXPECT_FALSE(WaveProperty::Compile("@(negedge clk) clk", resolve).ok());
+  EXPECT_FALSE(WaveProperty::Compile("@(posedge clk) clk ##[1:2] clk", resolve).ok());
+  EXPECT_FALSE(WaveProperty::Compile("@(posedge clk) $countones(clk)", resolve).ok());
+  EXPECT_FALSE(WaveProperty::Compile("@(posedge clk) foo", resolve).ok());
+}
+
+} // namespace
+} // namespace sv
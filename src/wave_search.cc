@@ -0,0 +1,295 @@
+#include "wave_search.h"
+
+#include "absl/status/status.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+namespace sv {
+namespace {
+
+// Samples searched on the calling thread before going parallel. Most searches end nearby.
+constexpr int kSerialSamples = 1 << 16;
+// Smallest amount of samples worth handing to a separate thread.
+constexpr int kMinChunkSamples = 1 << 18;
+// How often a thread checks if an earlier part of the wave already had a match.
+constexpr int kAbortCheckInterval = 1 << 12;
+
+bool IsUnknown(char c) { return c == 'x' || c == 'z' || c == '?'; }
+
+std::string_view Trim(std::string_view s) {
+  while (!s.empty() && std::isspace(s.front())) s.remove_prefix(1);
+  while (!s.empty() && std::isspace(s.back())) s.remove_suffix(1);
+  return s;
+}
+
+// Searches count samples starting at the first index, stepping in the search direction. Returns
+// the step offset of the first sample where a match starts, or -1. When other threads are also
+// searching, gives up once one of them has found a match before base_offset.
+int Scan(const std::vector<WaveData::Sample> &wave, int first, int count, bool forward,
+         const ValueMatcher &matcher, const std::atomic<int> *best, int base_offset) {
+  const auto matches = [&](int idx) {
+    return idx >= 0 && idx < wave.size() && matcher.Matches(wave[idx].value);
+  };
+  const auto aborted = [&](int offset) {
+    return best != nullptr && offset % kAbortCheckInterval == 0 &&
+           best->load(std::memory_order_relaxed) < base_offset;
+  };
+  if (forward) {
+    bool prev = matches(first - 1);
+    for (int offset = 0; offset < count; ++offset) {
+      if (aborted(offset)) return -1;
+      const bool current = matches(first + offset);
+      if (current && !prev) return offset;
+      prev = current;
+    }
+  } else {
+    bool next = matches(first);
+    for (int offset = 0; offset < count; ++offset) {
+      if (aborted(offset)) return -1;
+      const bool prev = matches(first - offset - 1);
+      if (next && !prev) return offset;
+      next = prev;
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+absl::StatusOr<ValueMatcher> ValueMatcher::Parse(std::string_view text, int width, Radix radix) {
+  if (width <= 0) return absl::InvalidArgumentError("Signal has no width");
+  ValueMatcher m;
+  bool xz_wildcards = false;
+  text = Trim(text);
+  for (std::string_view op : {"==?", "!=?", "==", "!="}) {
+    if (text.starts_with(op)) {
+      m.negate_ = op[0] == '!';
+      xz_wildcards = op.size() == 3;
+      text = Trim(text.substr(op.size()));
+      break;
+    }
+  }
+  std::string digits;
+  for (char c : text) {
+    if (c != '_') digits += std::tolower(c);
+  }
+  // Bits per digit, with 0 meaning decimal and -1 meaning floating point.
+  int digit_bits = 0;
+  switch (radix) {
+  case Radix::kHex: digit_bits = 4; break;
+  case Radix::kBinary: digit_bits = 1; break;
+  case Radix::kUnsignedDecimal:
+  case Radix::kSignedDecimal: digit_bits = 0; break;
+  case Radix::kFloat: digit_bits = -1; break;
+  }
+  // Explicit bases, either Verilog style or C style. A Verilog size is ignored, the signal width is
+  // what counts.
+  if (const size_t tick = digits.find('\''); tick != std::string::npos) {
+    size_t pos = tick + 1;
+    if (pos < digits.size() && digits[pos] == 's') pos++;
+    if (pos >= digits.size()) return absl::InvalidArgumentError("Missing base");
+    switch (digits[pos]) {
+    case 'h': digit_bits = 4; break;
+    case 'o': digit_bits = 3; break;
+    case 'b': digit_bits = 1; break;
+    case 'd': digit_bits = 0; break;
+    default: return absl::InvalidArgumentError("Unknown base");
+    }
+    digits = digits.substr(pos + 1);
+  } else if (digits.size() > 2 && digits[0] == '0' &&
+             (digits[1] == 'x' || digits[1] == 'o' || digits[1] == 'b')) {
+    digit_bits = digits[1] == 'x' ? 4 : digits[1] == 'o' ? 3 : 1;
+    digits = digits.substr(2);
+  }
+  if (digits.empty()) return absl::InvalidArgumentError("Missing value");
+
+  std::string bits;
+  if (digit_bits > 0) {
+    for (char c : digits) {
+      if (IsUnknown(c)) {
+        bits.append(digit_bits, c);
+        continue;
+      }
+      const int val = std::isdigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : 99;
+      if (val >= (1 << digit_bits)) return absl::InvalidArgumentError("Invalid digit");
+      for (int b = digit_bits - 1; b >= 0; --b) {
+        bits += ((val >> b) & 1) ? '1' : '0';
+      }
+    }
+    // Like Verilog literals, values starting with x or z are extended with that.
+    const char pad = IsUnknown(bits[0]) ? bits[0] : '0';
+    if (bits.size() > width) {
+      const size_t excess = bits.size() - width;
+      if (bits.find_first_not_of(pad, 0) < excess) {
+        return absl::InvalidArgumentError("Value does not fit in " + std::to_string(width) +
+                                          " bits");
+      }
+      bits = bits.substr(excess);
+    } else {
+      bits.insert(0, width - bits.size(), pad);
+    }
+  } else if (digit_bits == 0) {
+    const bool negative = digits[0] == '-';
+    uint64_t magnitude = 0;
+    const char *begin = digits.data() + (negative ? 1 : 0);
+    const char *end = digits.data() + digits.size();
+    const auto result = std::from_chars(begin, end, magnitude);
+    if (result.ec != std::errc() || result.ptr != end) {
+      return absl::InvalidArgumentError("Invalid decimal value");
+    }
+    const uint64_t val = negative ? -magnitude : magnitude;
+    if (width < 64) {
+      const bool fits = negative ? magnitude <= (uint64_t{1} << (width - 1))
+                                 : (magnitude >> width) == 0;
+      if (!fits) {
+        return absl::InvalidArgumentError("Value does not fit in " + std::to_string(width) +
+                                          " bits");
+      }
+    }
+    for (int b = width - 1; b >= 0; --b) {
+      bits += (b < 64 ? (val >> b) & 1 : negative) ? '1' : '0';
+    }
+  } else {
+    char *end = nullptr;
+    const double d = std::strtod(digits.c_str(), &end);
+    if (end != digits.c_str() + digits.size()) {
+      return absl::InvalidArgumentError("Invalid floating point value");
+    }
+    uint64_t val;
+    if (width == 32) {
+      val = std::bit_cast<uint32_t>(static_cast<float>(d));
+    } else if (width == 64) {
+      val = std::bit_cast<uint64_t>(d);
+    } else {
+      return absl::InvalidArgumentError("Floating point values need 32 or 64 bits");
+    }
+    for (int b = width - 1; b >= 0; --b) {
+      bits += ((val >> b) & 1) ? '1' : '0';
+    }
+  }
+
+  m.care_.resize(bits.size());
+  for (int i = 0; i < bits.size(); ++i) {
+    const bool wildcard = bits[i] == '?' || (xz_wildcards && IsUnknown(bits[i]));
+    m.care_[i] = wildcard ? 0 : 0xff;
+    if (bits[i] == '?') bits[i] = '0';
+  }
+  m.bits_ = std::move(bits);
+  return m;
+}
+
+void ValueMatcher::PlaceAt(int width, int char_idx) {
+  const char bit = bits_.back();
+  const char care = care_.back();
+  bits_.assign(width, '0');
+  care_.assign(width, 0);
+  if (char_idx >= 0 && char_idx < width) {
+    bits_[char_idx] = bit;
+    care_[char_idx] = care;
+  }
+}
+
+bool ValueMatcher::Matches(std::string_view value) const {
+  if (value.size() != bits_.size()) return MatchesResized(value);
+  const size_t n = value.size();
+  // Compare 8 characters at a time, without branching so that the compiler can vectorize it. Or-ing
+  // in 0x20 makes upper case X and Z lower case, and leaves the digits unchanged.
+  constexpr uint64_t kLowerCase = 0x2020202020202020;
+  uint64_t diff = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t v, b, c;
+    std::memcpy(&v, value.data() + i, 8);
+    std::memcpy(&b, bits_.data() + i, 8);
+    std::memcpy(&c, care_.data() + i, 8);
+    diff |= ((v | kLowerCase) ^ b) & c;
+  }
+  for (; i < n; ++i) {
+    diff |= ((value[i] | 0x20) ^ bits_[i]) & static_cast<unsigned char>(care_[i]);
+  }
+  return (diff == 0) != negate_;
+}
+
+bool ValueMatcher::MatchesResized(std::string_view value) const {
+  if (value.empty()) return negate_;
+  std::string resized;
+  if (value.size() < bits_.size()) {
+    // Extend the same way as VCD files shorten values.
+    const char msb = std::tolower(value[0]);
+    resized.assign(bits_.size() - value.size(), msb == 'x' || msb == 'z' ? msb : '0');
+    resized += value;
+  } else {
+    const size_t excess = value.size() - bits_.size();
+    // Upper bits that are not zero can never match.
+    if (value.substr(0, excess).find_first_not_of('0') != std::string_view::npos) return negate_;
+    resized = value.substr(excess);
+  }
+  return Matches(resized);
+}
+
+int FindMatchingSample(const std::vector<WaveData::Sample> &wave, int start_idx, bool forward,
+                       const ValueMatcher &matcher) {
+  const int first = forward ? start_idx + 1 : start_idx - 1;
+  const int count = forward ? static_cast<int>(wave.size()) - first : first + 1;
+  if (count <= 0 || first < 0 || first >= wave.size()) return -1;
+  const auto index = [&](int offset) { return forward ? first + offset : first - offset; };
+  const int serial = std::min(count, kSerialSamples);
+  if (const int offset = Scan(wave, first, serial, forward, matcher, nullptr, 0); offset >= 0) {
+    return index(offset);
+  }
+  if (serial == count) return -1;
+  // Each thread takes a contiguous part of the rest, the earliest match in search order wins.
+  std::atomic<int> best = INT_MAX;
+  ParallelChunks(count - serial, kMinChunkSamples, [&](int, size_t begin, size_t end) {
+    const int base_offset = serial + begin;
+    const int offset =
+        Scan(wave, index(base_offset), end - begin, forward, matcher, &best, base_offset);
+    if (offset < 0) return;
+    int current = best.load();
+    while (base_offset + offset < current &&
+           !best.compare_exchange_weak(current, base_offset + offset)) {
+    }
+  });
+  return best == INT_MAX ? -1 : index(best);
+}
+
+std::vector<uint64_t> RisingEdges(const std::vector<WaveData::Sample> &clock, uint64_t start_time,
+                                  uint64_t end_time) {
+  std::vector<uint64_t> edges;
+  bool high = false;
+  for (const WaveData::Sample &s : clock) {
+    if (s.time > end_time) break;
+    const bool now_high = !s.value.empty() && s.value.back() == '1';
+    if (now_high && !high && s.time >= start_time) {
+      // Glitches can make several edges at one time.
+      if (edges.empty() || edges.back() != s.time) edges.push_back(s.time);
+    }
+    high = now_high;
+  }
+  return edges;
+}
+
+void SampleBefore(const std::vector<WaveData::Sample> &wave, std::span<const uint64_t> times,
+                  std::vector<std::string_view> *values) {
+  values->clear();
+  if (times.empty()) return;
+  values->reserve(times.size());
+  // Index of the last sample before the current time, -1 if there is none.
+  int idx = std::lower_bound(wave.begin(), wave.end(), times.front(),
+                             [](const WaveData::Sample &s, uint64_t t) { return s.time < t; }) -
+            wave.begin() - 1;
+  for (const uint64_t time : times) {
+    while (idx + 1 < wave.size() && wave[idx + 1].time < time) idx++;
+    values->push_back(idx < 0 ? std::string_view() : std::string_view(wave[idx].value));
+  }
+}
+
+} // namespace sv
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "absl/status/statusor.h"
+#include "radix.h"
+#include "wave_data.h"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// Compares sample values against a value given as text, such as "0xdead", "!= 0", "8'b1010_????"
+// or "==? 'h1x". The value is interpreted in the given radix unless it has a prefix of its own.
+// Like SystemVerilog, "==" and "!=" compare x and z literally, and "==?" and "!=?" treat x and z
+// in the given value as wildcards. A '?' digit is always a wildcard.
+class ValueMatcher {
+ public:
+  static absl::StatusOr<ValueMatcher> Parse(std::string_view text, int width, Radix radix);
+  // Restricts matching to a single bit of a wider value. The bit is a character index into the
+  // sample values, so 0 is the most significant bit.
+  void PlaceAt(int width, int char_idx);
+  bool Matches(std::string_view value) const;
+  // The value that was matched against, as it would appear in a sample.
+  const std::string &Bits() const { return bits_; }
+
+ private:
+  bool MatchesResized(std::string_view value) const;
+  // Bit characters, most significant first, lower case.
+  std::string bits_;
+  // 0xff for characters that must match, 0 for wildcards. Same length as bits_.
+  std::string care_;
+  bool negate_ = false;
+};
+
+// Index of the first sample after start_idx (or the last one before it when searching backwards)
+// where the value starts to match. Consecutive matching samples only count once, at the first
+// one. Returns -1 if there is none. Large waves are split across multiple threads.
+int FindMatchingSample(const std::vector<WaveData::Sample> &wave, int start_idx, bool forward,
+                       const ValueMatcher &matcher);
+
+// Times of the rising edges of a clock within [start_time, end_time]. Like clocked derived
+// signals, any change to a value ending in 1 from one that doesn't is a rising edge.
+std::vector<uint64_t> RisingEdges(const std::vector<WaveData::Sample> &clock, uint64_t start_time,
+                                  uint64_t end_time);
+// Values of a wave just before each of the given ascending times, as a flip-flop clocked at those
+// times captures them. Only the first time is searched for, the rest are found by walking the
+// times and samples together. Values are empty before the first sample.
+void SampleBefore(const std::vector<WaveData::Sample> &wave, std::span<const uint64_t> times,
+                  std::vector<std::string_view> *values);
+
+} // namespace sv
@@ -0,0 +1,132 @@
+#include "wave_search.h"
+
+#include "external/googletest/googletest/include/gtest/gtest.h"
+#include "test_waves.h"
+
+namespace sv {
+namespace {
+
+TEST(WaveSearch, ParseRadix) {
+  auto m = ValueMatcher::Parse("a5", 8, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(m->Bits(), "10100101");
+  m = ValueMatcher::Parse("0b101", 8, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(m->Bits(), "00000101");
+  m = ValueMatcher::Parse("8'h1_f", 8, Radix::kBinary);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(m->Bits(), "00011111");
+  m = ValueMatcher::Parse("-2", 4, Radix::kSignedDecimal);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(m->Bits(), "1110");
+  m = ValueMatcher::Parse("1.0", 32, Radix::kFloat);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(m->Bits(), "00111111100000000000000000000000");
+}
+
+TEST(WaveSearch, ParseErrors) {
+  EXPECT_FALSE(ValueMatcher::Parse("1ff", 8, Radix::kHex).ok());
+  EXPECT_FALSE(ValueMatcher::Parse("256", 8, Radix::kUnsignedDecimal).ok());
+  EXPECT_FALSE(ValueMatcher::Parse("12", 8, Radix::kBinary).ok());
+  EXPECT_FALSE(ValueMatcher::Parse("==", 8, Radix::kHex).ok());
+}
+
+TEST(WaveSearch, Matching) {
+  auto m = ValueMatcher::Parse("0xdead", 16, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_TRUE(m->Matches("1101111010101101"));
+  EXPECT_FALSE(m->Matches("1101111010101100"));
+  // Shorter values, as in VCD files, are extended.
+  m = ValueMatcher::Parse("3", 16, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_TRUE(m->Matches("11"));
+  EXPECT_FALSE(m->Matches("x1"));
+  m = ValueMatcher::Parse("!= 0", 4, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_TRUE(m->Matches("0100"));
+  EXPECT_FALSE(m->Matches("0000"));
+}
+
+TEST(WaveSearch, Wildcards) {
+  auto m = ValueMatcher::Parse("'b1?0?", 4, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_TRUE(m->Matches("1101"));
+  EXPECT_TRUE(m->Matches("1x0z"));
+  EXPECT_FALSE(m->Matches("1110"));
+  // Literal x/z for plain equality, wildcards for ==?.
+  m = ValueMatcher::Parse("'b1x", 2, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_TRUE(m->Matches("1X"));
+  EXPECT_FALSE(m->Matches("10"));
+  m = ValueMatcher::Parse("==? 'b1x", 2, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_TRUE(m->Matches("10"));
+  EXPECT_TRUE(m->Matches("11"));
+  EXPECT_FALSE(m->Matches("01"));
+}
+
+TEST(WaveSearch, SingleBit) {
+  auto m = ValueMatcher::Parse("1", 1, Radix::kBinary);
+  ASSERT_TRUE(m.ok());
+  m->PlaceAt(4, 1);
+  EXPECT_TRUE(m->Matches("0100"));
+  EXPECT_TRUE(m->Matches("x1zz"));
+  EXPECT_FALSE(m->Matches("1011"));
+}
+
+TEST(WaveSearch, FindNextPrev) {
+  const auto wave = MakeWave({"00", "01", "10", "11", "01", "00", "01"});
+  auto m = ValueMatcher::Parse("1", 2, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(FindMatchingSample(wave, 0, true, *m), 1);
+  EXPECT_EQ(FindMatchingSample(wave, 1, true, *m), 4);
+  EXPECT_EQ(FindMatchingSample(wave, 4, true, *m), 6);
+  EXPECT_EQ(FindMatchingSample(wave, 6, true, *m), -1);
+  EXPECT_EQ(FindMatchingSample(wave, 6, false, *m), 4);
+  EXPECT_EQ(FindMatchingSample(wave, 4, false, *m), 1);
+  EXPECT_EQ(FindMatchingSample(wave, 1, false, *m), -1);
+  // Runs of matching samples only match at their start.
+  m = ValueMatcher::Parse("==? 'b1x", 2, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(FindMatchingSample(wave, 0, true, *m), 2);
+  EXPECT_EQ(FindMatchingSample(wave, 2, true, *m), -1);
+  EXPECT_EQ(FindMatchingSample(wave, 6, false, *m), 2);
+}
+
+TEST(WaveSearch, LargeWave) {
+  // Big enough to be split over multiple threads.
+  std::vector<WaveData::Sample> wave;
+  constexpr int kNumSamples = 5'000'000;
+  wave.reserve(kNumSamples);
+  for (int i = 0; i < kNumSamples; ++i) {
+    wave.push_back({.time = static_cast<uint64_t>(i), .value = i % 2 ? "0101" : "1010"});
+  }
+  wave[1'234'567].value = "1111";
+  wave[4'000'001].value = "1111";
+  auto m = ValueMatcher::Parse("f", 4, Radix::kHex);
+  ASSERT_TRUE(m.ok());
+  EXPECT_EQ(FindMatchingSample(wave, 0, true, *m), 1'234'567);
+  EXPECT_EQ(FindMatchingSample(wave, 1'234'567, true, *m), 4'000'001);
+  EXPECT_EQ(FindMatchingSample(wave, kNumSamples - 1, false, *m), 4'000'001);
+  EXPECT_EQ(FindMatchingSample(wave, 4'000'001, false, *m), 1'234'567);
+  EXPECT_EQ(FindMatchingSample(wave, 4'000'001, true, *m), -1);
+}
+
+TEST(WaveSearch, ClockSampling) {
+  const std::vector<WaveData::Sample> clock = {
+      {0, "0"}, {5, "1"}, {10, "0"}, {15, "x"}, {17, "1"}, {20, "0"}, {25, "1"}, {30, "0"},
+  };
+  EXPECT_EQ(RisingEdges(clock, 0, 100), std::vector<uint64_t>({5, 17, 25}));
+  EXPECT_EQ(RisingEdges(clock, 6, 25), std::vector<uint64_t>({17, 25}));
+  // Changes at an edge are only seen by the next one.
+  const std::vector<WaveData::Sample> wave = MakeWave({"a", "b", "c"});
+  std::vector<std::string_view> values;
+  const std::vector<uint64_t> times = {0, 5, 10, 15, 20, 21, 40};
+  SampleBefore(wave, times, &values);
+  EXPECT_EQ(values, std::vector<std::string_view>({"", "a", "a", "b", "b", "c", "c"}));
+  SampleBefore(wave, std::span(times).subspan(3, 2), &values);
+  EXPECT_EQ(values, std::vector<std::string_view>({"b", "b"}));
+}
+
+} // namespace
+} // namespace sv
@@ -63,6 +63,7 @@ void WaveSignalsPanel::SetScope(const WaveData::SignalScope *s) {
   scope_ = s;
   data_.Clear();
   items_.clear();
+  Workspace::Get().Waves()->LoadScope(s);
   for (auto &sig : s->signals) {
     if ((hide_signals_ && sig.direction == WaveData::Signal::kInternal) ||
         (hide_outputs_ && sig.direction == WaveData::Signal::kOutput) ||
@@ -0,0 +1,122 @@
+#include "wave_stats.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace sv {
+namespace {
+
+// Index of the sample holding the value at the given time, or -1 if it is before all samples.
+int SampleAt(std::span<const WaveData::Sample> wave, uint64_t time) {
+  return std::upper_bound(wave.begin(), wave.end(), time,
+                          [](uint64_t t, const WaveData::Sample &s) { return t < s.time; }) -
+         wave.begin() - 1;
+}
+
+} // namespace
+
+uint64_t CountToggles(std::span<const WaveData::Sample> wave, uint64_t start_time,
+                      uint64_t end_time) {
+  uint64_t toggles = 0;
+  for (int i = std::max(0, SampleAt(wave, start_time)) + 1;
+       i < wave.size() && wave[i].time <= end_time; ++i) {
+    if (wave[i].value != wave[i - 1].value) toggles++;
+  }
+  return toggles;
+}
+
+std::optional<uint64_t> FirstDifference(std::span<const WaveData::Sample> a,
+                                        std::span<const WaveData::Sample> b, uint64_t start_time,
+                                        uint64_t end_time) {
+  const auto value = [](std::span<const WaveData::Sample> wave, int idx) -> std::string_view {
+    return idx < 0 ? std::string_view() : std::string_view(wave[idx].value);
+  };
+  const auto next_time = [](std::span<const WaveData::Sample> wave, int idx) {
+    return idx + 1 < wave.size() ? wave[idx + 1].time : std::numeric_limits<uint64_t>::max();
+  };
+  int a_idx = SampleAt(a, start_time);
+  int b_idx = SampleAt(b, start_time);
+  uint64_t time = start_time;
+  while (value(a, a_idx) == value(b, b_idx)) {
+    // Step to the next time either wave changes, past any glitches at that time.
+    time = std::min(next_time(a, a_idx), next_time(b, b_idx));
+    if (time > end_time) return std::nullopt;
+    while (next_time(a, a_idx) <= time) a_idx++;
+    while (next_time(b, b_idx) <= time) b_idx++;
+  }
+  return time;
+}
+
+WaveStats ComputeWaveStats(const std::vector<WaveData::Sample> &wave, int width,
+                           uint64_t start_time, uint64_t end_time, int num_top_values) {
+  WaveStats stats;
+  // Start at the sample holding the value at the start time, if there is one.
+  const int first_idx = std::max(0, SampleAt(wave, start_time));
+  absl::flat_hash_map<std::string_view, int> counts;
+  double weighted_sum = 0;
+  uint64_t known_time = 0;
+  for (int i = first_idx; i < wave.size() && wave[i].time <= end_time; ++i) {
+    const std::string &value = wave[i].value;
+    const uint64_t seg_start = std::max(wave[i].time, start_time);
+    const uint64_t seg_end = i + 1 < wave.size() ? std::min(wave[i + 1].time, end_time) : end_time;
+    const uint64_t duration = seg_end > seg_start ? seg_end - seg_start : 0;
+    if (i > first_idx && value != wave[i - 1].value) stats.toggles++;
+    counts[value]++;
+    stats.duration += duration;
+    bool has_one = false;
+    bool has_xz = false;
+    for (const char c : value) {
+      has_one |= c == '1';
+      has_xz |= c != '0' && c != '1';
+    }
+    if (has_one) stats.nonzero_time += duration;
+    if (has_xz) {
+      stats.xz_time += duration;
+    } else if (width <= 64) {
+      uint64_t v = 0;
+      for (const char c : value) {
+        v = (v << 1) | (c == '1');
+      }
+      stats.min = stats.numeric ? std::min(stats.min, v) : v;
+      stats.max = stats.numeric ? std::max(stats.max, v) : v;
+      stats.numeric = true;
+      weighted_sum += static_cast<double>(v) * duration;
+      known_time += duration;
+    }
+  }
+  if (known_time > 0) {
+    stats.mean = weighted_sum / known_time;
+  } else if (stats.numeric) {
+    // Only zero-length samples, weigh them equally.
+    stats.mean = (static_cast<double>(stats.min) + stats.max) / 2;
+  }
+  std::vector<std::pair<std::string_view, int>> sorted(counts.begin(), counts.end());
+  const int num_top = std::min<int>(num_top_values, sorted.size());
+  std::partial_sort(sorted.begin(), sorted.begin() + num_top, sorted.end(),
+                    [](const auto &a, const auto &b) {
+                      return a.second != b.second ? a.second > b.second : a.first < b.first;
+                    });
+  for (int i = 0; i < num_top; ++i) {
+    stats.top_values.push_back({std::string(sorted[i].first), sorted[i].second});
+  }
+  return stats;
+}
+
+std::vector<WaveStats>
+ComputeWaveStats(const std::vector<const std::vector<WaveData::Sample> *> &waves,
+                 const std::vector<int> &widths, uint64_t start_time, uint64_t end_time,
+                 int num_top_values) {
+  std::vector<WaveStats> stats(waves.size());
+  // Each wave is independent, so a chunk per thread needs no synchronization.
+  ParallelChunks(waves.size(), /*min_chunk*/ 1, [&](int, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      stats[i] = ComputeWaveStats(*waves[i], widths[i], start_time, end_time, num_top_values);
+    }
+  });
+  return stats;
+}
+
+} // namespace sv
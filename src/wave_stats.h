@@ -0,0 +1,49 @@
+#pragma once
+
+#include "wave_data.h"
+
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sv {
+
+// Activity and value statistics of a wave over a time window.
+struct WaveStats {
+  // Number of value changes inside the window, not counting the value it starts with.
+  uint64_t toggles = 0;
+  // Time in the window covered by samples, the denominator for the times below.
+  uint64_t duration = 0;
+  // Time with at least one known 1 bit. For single bit signals, this is the duty cycle.
+  uint64_t nonzero_time = 0;
+  // Time with at least one x or z bit.
+  uint64_t xz_time = 0;
+  // Statistics of fully known values, only for signals up to 64 bits wide.
+  bool numeric = false;
+  uint64_t min = 0;
+  uint64_t max = 0;
+  double mean = 0; // Weighted by time.
+  // Most frequent values, by number of occurrences, most frequent first.
+  std::vector<std::pair<std::string, int>> top_values;
+};
+
+// Just the toggle count of the statistics below, for going over many signals quickly.
+uint64_t CountToggles(std::span<const WaveData::Sample> wave, uint64_t start_time,
+                      uint64_t end_time);
+// Earliest time in [start_time, end_time] at which two waves of the same signal hold different
+// values, judged by the settled value at each time. Before its first sample a wave has no value.
+std::optional<uint64_t> FirstDifference(std::span<const WaveData::Sample> a,
+                                        std::span<const WaveData::Sample> b, uint64_t start_time,
+                                        uint64_t end_time);
+// Statistics over [start_time, end_time]. Time before the first sample is not covered.
+WaveStats ComputeWaveStats(const std::vector<WaveData::Sample> &wave, int width,
+                           uint64_t start_time, uint64_t end_time, int num_top_values);
+// Variant for many waves at once, computed in parallel. The waves and widths correspond.
+std::vector<WaveStats>
+ComputeWaveStats(const std::vector<const std::vector<WaveData::Sample> *> &waves,
+                 const std::vector<int> &widths, uint64_t start_time, uint64_t end_time,
+                 int num_top_values);
+
+} // namespace sv
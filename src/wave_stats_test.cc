@@ -0,0 +1,76 @@
+#include "wave_stats.h"
+
+#include "external/googletest/googletest/include/gtest/gtest.h"
+
+namespace sv {
+namespace {
+
+TEST(WaveStats, SingleBit) {
+  const std::vector<WaveData::Sample> wave = {
+      {0, "0"}, {10, "1"}, {20, "0"}, {30, "x"}, {35, "1"}, {40, "0"},
+  };
+  const WaveStats stats = ComputeWaveStats(wave, 1, 5, 45, 2);
+  EXPECT_EQ(stats.toggles, 5);
+  EXPECT_EQ(CountToggles(wave, 5, 45), 5);
+  EXPECT_EQ(CountToggles(wave, 10, 30), 2);
+  EXPECT_EQ(stats.duration, 40);
+  EXPECT_EQ(stats.nonzero_time, 15);
+  EXPECT_EQ(stats.xz_time, 5);
+  ASSERT_EQ(stats.top_values.size(), 2);
+  EXPECT_EQ(stats.top_values[0], std::make_pair(std::string("0"), 3));
+  EXPECT_EQ(stats.top_values[1], std::make_pair(std::string("1"), 2));
+}
+
+TEST(WaveStats, Numeric) {
+  const std::vector<WaveData::Sample> wave = {
+      {0, "0010"}, {10, "0110"}, {30, "0001"},
+  };
+  const WaveStats stats = ComputeWaveStats(wave, 4, 0, 40, 5);
+  EXPECT_TRUE(stats.numeric);
+  EXPECT_EQ(stats.min, 1);
+  EXPECT_EQ(stats.max, 6);
+  EXPECT_DOUBLE_EQ(stats.mean, (2 * 10 + 6 * 20 + 1 * 10) / 40.0);
+  EXPECT_EQ(stats.top_values.size(), 3);
+  // Time before the first sample is not covered.
+  const WaveStats late = ComputeWaveStats({{20, "1"}}, 1, 0, 40, 1);
+  EXPECT_EQ(late.duration, 20);
+  EXPECT_EQ(late.toggles, 0);
+}
+
+TEST(WaveStats, Parallel) {
+  std::vector<std::vector<WaveData::Sample>> waves(100);
+  std::vector<const std::vector<WaveData::Sample> *> wave_ptrs;
+  for (int i = 0; i < waves.size(); ++i) {
+    for (int t = 0; t <= i; ++t) {
+      waves[i].push_back({static_cast<uint64_t>(t), t % 2 ? "1" : "0"});
+    }
+    wave_ptrs.push_back(&waves[i]);
+  }
+  const std::vector<WaveStats> stats =
+      ComputeWaveStats(wave_ptrs, std::vector<int>(waves.size(), 1), 0, 1000, 1);
+  ASSERT_EQ(stats.size(), waves.size());
+  for (int i = 0; i < waves.size(); ++i) {
+    EXPECT_EQ(stats[i].toggles, i);
+  }
+}
+
+TEST(WaveStats, FirstDifference) {
+  const std::vector<WaveData::Sample> golden = {{0, "0"}, {10, "1"}, {20, "0"}, {30, "1"}};
+  EXPECT_EQ(FirstDifference(golden, golden, 0, 100), std::nullopt);
+  // Same values with a redundant sample and a glitch that settles.
+  const std::vector<WaveData::Sample> same = {{0, "0"}, {5, "0"}, {10, "0"}, {10, "1"},
+                                              {20, "0"}, {30, "1"}};
+  EXPECT_EQ(FirstDifference(golden, same, 0, 100), std::nullopt);
+  const std::vector<WaveData::Sample> late = {{0, "0"}, {10, "1"}, {25, "0"}, {30, "1"}};
+  EXPECT_EQ(FirstDifference(golden, late, 0, 100), 20);
+  EXPECT_EQ(FirstDifference(late, golden, 0, 100), 20);
+  EXPECT_EQ(FirstDifference(golden, late, 22, 100), 22);
+  EXPECT_EQ(FirstDifference(golden, late, 0, 15), std::nullopt);
+  EXPECT_EQ(FirstDifference(golden, late, 25, 100), std::nullopt);
+  // A wave that starts later differs until its first sample.
+  const std::vector<WaveData::Sample> missing_start = {{10, "1"}};
+  EXPECT_EQ(FirstDifference(golden, missing_start, 0, 100), 0);
+}
+
+} // namespace
+} // namespace sv
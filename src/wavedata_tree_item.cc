@@ -1,28 +1,65 @@
 #include "wavedata_tree_item.h"
+#include "utils.h"
 #include "workspace.h"
 
+#include <algorithm>
+
 namespace sv {
 
-WaveDataTreeItem::WaveDataTreeItem(const WaveData::SignalScope &signal_scope)
-    : signal_scope_(signal_scope) {
-  for (const auto &c : signal_scope_.children) {
-    children_.push_back(WaveDataTreeItem(c));
+WaveDataTreeItem::WaveDataTreeItem(const WaveData::SignalScope &signal_scope,
+                                   const std::optional<ActivityReport> *activity)
+    : signal_scope_(signal_scope), activity_(activity) {}
+
+const std::vector<WaveDataTreeItem> &WaveDataTreeItem::Children() const {
+  if (!children_built_) {
+    Workspace::Get().Waves()->LoadScope(&signal_scope_);
+    children_.reserve(signal_scope_.children.size());
+    for (const auto &c : signal_scope_.children) {
+      children_.push_back(WaveDataTreeItem(c, activity_));
+    }
+    children_built_ = true;
   }
+  return children_;
 }
+
 std::string_view WaveDataTreeItem::Name() const { return signal_scope_.name; }
 
+const ActivityReport::ScopeActivity *WaveDataTreeItem::Activity() const {
+  if (activity_ == nullptr || !activity_->has_value()) return nullptr;
+  const auto &scopes = (*activity_)->scopes;
+  const auto it = scopes.find(&signal_scope_);
+  return it == scopes.end() ? nullptr : &it->second;
+}
+
 std::string_view WaveDataTreeItem::Type() const {
-  static std::string empty;
-  return empty;
+  type_.clear();
+  if (const auto *activity = Activity()) {
+    // Heat bar with one mark per decade of toggles, followed by the count.
+    constexpr int kBarSize = 8;
+    int heat = 0;
+    for (uint64_t t = activity->toggles; t != 0 && heat < kBarSize; t /= 10) heat++;
+    type_ = "[" + std::string(heat, '#') + std::string(kBarSize - heat, ' ') + "] " +
+            AddDigitSeparators(activity->toggles);
+  }
+  return type_;
 }
 
 bool WaveDataTreeItem::AltType() const { return false; }
 
-bool WaveDataTreeItem::Expandable() const { return !children_.empty(); }
+bool WaveDataTreeItem::Expandable() const { return !Children().empty(); }
+
+int WaveDataTreeItem::NumChildren() const { return Children().size(); }
 
-int WaveDataTreeItem::NumChildren() const { return children_.size(); }
+TreeItem *WaveDataTreeItem::Child(int idx) {
+  Children();
+  return &children_[idx];
+}
 
-TreeItem *WaveDataTreeItem::Child(int idx) { return &children_[idx]; }
+bool WaveDataTreeItem::ErrType() const {
+  // Highlight scopes without any activity, likely dead logic.
+  const auto *activity = Activity();
+  return activity != nullptr && activity->toggles == 0;
+}
 
 bool WaveDataTreeItem::MatchColor() const {
   return &signal_scope_ == Workspace::Get().MatchedSignalScope();
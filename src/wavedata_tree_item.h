@@ -1,14 +1,20 @@
 #pragma once
 
+#include "batch_report.h"
 #include "tree_item.h"
 #include "wave_data.h"
 
+#include <optional>
+
 namespace sv {
 
 // Tree data for the WaveData, allowing browsing of the scopes in a WaveData object.
 class WaveDataTreeItem : public TreeItem {
  public:
-  explicit WaveDataTreeItem(const WaveData::SignalScope &signal_scope);
+  // When an activity report is given and has a value, the scope's toggle count is shown as its
+  // type.
+  explicit WaveDataTreeItem(const WaveData::SignalScope &signal_scope,
+                            const std::optional<ActivityReport> *activity = nullptr);
   std::string_view Name() const final;
   std::string_view Type() const final;
   bool AltType() const final;
@@ -16,12 +22,19 @@ class WaveDataTreeItem : public TreeItem {
   int NumChildren() const final;
   TreeItem *Child(int idx) final;
   bool MatchColor() const final;
+  bool ErrType() const final;
 
   const WaveData::SignalScope *SignalScope() const { return &signal_scope_; }
 
  private:
+  // Sub-scopes are only read from the wave data once the tree actually needs them.
+  const std::vector<WaveDataTreeItem> &Children() const;
+  const ActivityReport::ScopeActivity *Activity() const;
   const WaveData::SignalScope &signal_scope_;
-  std::vector<WaveDataTreeItem> children_;
+  const std::optional<ActivityReport> *activity_;
+  mutable std::string type_;
+  mutable std::vector<WaveDataTreeItem> children_;
+  mutable bool children_built_ = false;
 };
 
 } // namespace sv
@@ -1,13 +1,21 @@
 #include "wavedata_tree_panel.h"
 #include "workspace.h"
+#include <algorithm>
 #include <optional>
 
 namespace sv {
+namespace {
+
+// Without a window from the waves panel, activity is counted over this fraction of the waves
+// around the cursor.
+constexpr int kActivityWindowFraction = 64;
+
+} // namespace
 
 void WaveDataTreePanel::BuildInitialTree() {
   if (Workspace::Get().Waves() == nullptr) return;
   for (const auto &scope : Workspace::Get().Waves()->Roots()) {
-    roots_.push_back(std::make_unique<WaveDataTreeItem>(scope));
+    roots_.push_back(std::make_unique<WaveDataTreeItem>(scope, &activity_));
     data_.AddRoot(roots_.back().get());
   }
   // Expand a little bit if it's easy.
@@ -21,11 +29,39 @@ void WaveDataTreePanel::BuildInitialTree() {
 WaveDataTreePanel::WaveDataTreePanel() { BuildInitialTree(); }
 
 void WaveDataTreePanel::HandleReloadedWaves() {
+  // Scope pointers in the report are stale now.
+  activity_.reset();
   data_.Clear();
   BuildInitialTree();
   scope_for_signals_ = dynamic_cast<WaveDataTreeItem *>(data_[line_idx_])->SignalScope();
 }
 
+void WaveDataTreePanel::HandleAppendedWaves() {
+  // The counts are of what the waves held before.
+  activity_.reset();
+}
+
+void WaveDataTreePanel::ToggleActivity() {
+  if (activity_.has_value()) {
+    activity_.reset();
+    return;
+  }
+  const auto *waves = Workspace::Get().Waves();
+  if (waves == nullptr) return;
+  // Counting the whole waves of every scope would hold up the UI on large files.
+  std::pair<uint64_t, uint64_t> window;
+  if (const auto selected = Workspace::Get().WaveTimeWindow()) {
+    window = *selected;
+  } else {
+    const auto [first, last] = waves->TimeRange();
+    const uint64_t span = std::max<uint64_t>(1, (last - first) / kActivityWindowFraction);
+    const uint64_t cursor = std::clamp(Workspace::Get().WaveCursorTime(), first, last);
+    window = {cursor - std::min(cursor - first, span / 2), std::min(last, cursor + span / 2)};
+  }
+  activity_ = ComputeActivity(*waves, LoadedSignals(*waves), window.first, window.second,
+                              ReportOptions().memory_budget);
+}
+
 void WaveDataTreePanel::UIChar(int ch) {
   int initial_line = line_idx_;
   switch (ch) {
@@ -33,6 +69,7 @@ void WaveDataTreePanel::UIChar(int ch) {
     Workspace::Get().SetMatchedSignalScope(
         dynamic_cast<const WaveDataTreeItem *>(data_[line_idx_])->SignalScope());
     break;
+  case 'a': ToggleActivity(); break;
   default: TreePanel::UIChar(ch);
   }
   // If the selection moved, update the signals panel
@@ -42,7 +79,7 @@ void WaveDataTreePanel::UIChar(int ch) {
 }
 
 std::vector<Tooltip> WaveDataTreePanel::Tooltips() const {
-  return std::vector<Tooltip>{{"S", "set scope for source"}};
+  return std::vector<Tooltip>{{"S", "set scope for source"}, {"a", "activity"}};
 }
 
 std::optional<const WaveData::SignalScope *> WaveDataTreePanel::ScopeForSignals() {
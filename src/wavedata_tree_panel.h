@@ -17,11 +17,16 @@ class WaveDataTreePanel : public TreePanel {
   bool Searchable() const final { return true; }
   std::optional<const WaveData::SignalScope *> ScopeForSignals();
   void HandleReloadedWaves() final;
+  void HandleAppendedWaves() final;
+  // Toggles the activity heat column. Turning it on counts the activity of the scopes that were
+  // read already, over the time range selected in the waves panel or a window around the cursor.
+  void ToggleActivity();
 
  private:
   void BuildInitialTree();
   const WaveData::SignalScope *scope_for_signals_ = nullptr;
   std::vector<std::unique_ptr<WaveDataTreeItem>> roots_;
+  std::optional<ActivityReport> activity_;
 };
 
 } // namespace sv
@@ -1,16 +1,26 @@
 #include "waves_panel.h"
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/strings/ascii.h"
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "batch_report.h"
 #include "color.h"
+#include "slang/ast/symbols/CompilationUnitSymbols.h"
+#include "slang_utils.h"
 #include "utils.h"
 #include "wave_image.h"
+#include "wave_property.h"
+#include "wave_search.h"
+#include "wave_stats.h"
 #include "workspace.h"
 #include <algorithm>
 #include <curses.h>
 #include <fstream>
+#include <memory>
 #include <optional>
 #include <vector>
 
@@ -22,6 +32,7 @@ constexpr int kMaxAnalogHeight = 20;
 constexpr float kZoomStep = 0.75;
 constexpr int kSmallestUnit = -18;
 constexpr int kMinCharsPerTick = 12;
+constexpr int kMaxXConeNets = 20000;
 const char *kTimeUnits[] = {"as", "fs", "ps", "ns", "us", "ms", "s", "ks"};
 const char *kBlankMarkerInFile = "[blank]";
 
@@ -137,6 +148,13 @@ void WavesPanel::Resized() {
                         name_value_size_ - visible_items_[line_idx_]->depth);
   time_input_.SetDims(0, 0, getmaxx(w_));
   filename_input_.SetDims(0, 0, getmaxx(w_));
+  value_input_.SetDims(0, 0, getmaxx(w_));
+  trigger_input_.SetDims(0, 0, getmaxx(w_));
+  derived_input_.SetDims(0, 0, getmaxx(w_));
+  golden_input_.SetDims(0, 0, getmaxx(w_));
+  clock_input_.SetDims(0, 0, getmaxx(w_));
+  handshake_input_.SetDims(0, 0, getmaxx(w_));
+  property_input_.SetDims(0, 0, getmaxx(w_));
 }
 
 void WavesPanel::GoToTime(uint64_t time, bool *time_changed, bool *range_changed) {
@@ -188,6 +206,592 @@ void WavesPanel::FindEdge(bool forward, bool *time_changed, bool *range_changed)
   }
 }
 
+void WavesPanel::FindValue(const std::string &text, bool forward, bool *time_changed,
+                           bool *range_changed) {
+  const ListItem *item = visible_items_[line_idx_];
+  const WaveData::Signal *signal = item->signal;
+  if (signal == nullptr) return;
+  const bool single_bit = item->expanded_bit_idx >= 0;
+  std::string value_text = text;
+  // Enum labels can be used instead of values, after the optional comparison operator.
+  if (signal->enum_id >= 0 && !single_bit) {
+    const size_t value_pos = std::min(text.size(), text.find_first_not_of("=!? "));
+    const std::string_view label = std::string_view(text).substr(value_pos);
+    if (const auto val = wave_data_->GetEnumValue(signal->enum_id, label)) {
+      value_text = text.substr(0, value_pos) + "'b" + std::string(*val);
+    }
+  }
+  absl::StatusOr<ValueMatcher> matcher =
+      ValueMatcher::Parse(value_text, single_bit ? 1 : signal->width,
+                          single_bit ? Radix::kBinary : item->radix);
+  if (!matcher.ok()) {
+    error_message_ = std::string(matcher.status().message());
+    return;
+  }
+  if (single_bit) matcher->PlaceAt(signal->width, item->expanded_bit_idx);
+  // Search the whole wave, not just the part that is visible.
+  const auto [start_time, end_time] = wave_data_->TimeRange();
+  wave_data_->LoadSignalSamples(signal, start_time, end_time);
+  const auto &wave = wave_data_->Wave(signal);
+  if (wave.empty()) return;
+  int start_idx = wave_data_->FindSampleIndex(cursor_time_, signal);
+  // When the current sample started before the cursor, it is a candidate for a backwards search.
+  if (!forward && wave[start_idx].time < cursor_time_) start_idx++;
+  const int idx = FindMatchingSample(wave, start_idx, forward, *matcher);
+  if (idx < 0) {
+    error_message_ = "Value not found.";
+    return;
+  }
+  GoToTime(wave[idx].time, time_changed, range_changed);
+}
+
+const WaveData::Signal *WavesPanel::ResolveName(std::string_view name) const {
+  for (const ListItem &item : items_) {
+    if (item.signal != nullptr && item.signal->name == name) return item.signal;
+  }
+  if (auto signal = wave_data_->PathToSignal(name)) return *signal;
+  return nullptr;
+}
+
+void WavesPanel::SetTrigger(const std::string &text) {
+  absl::StatusOr<WaveExpr> expr = WaveExpr::Compile(
+      text, [this](std::string_view name) { return ResolveName(name); });
+  if (!expr.ok()) {
+    error_message_ = std::string(expr.status().message());
+    trigger_.reset();
+    trigger_text_.clear();
+    return;
+  }
+  trigger_ = *std::move(expr);
+  trigger_text_ = text;
+}
+
+void WavesPanel::DefineDerived(const std::string &text) {
+  const size_t eq_pos = text.find('=');
+  if (eq_pos == std::string::npos) {
+    error_message_ = "Expecting name = expression";
+    return;
+  }
+  const std::string_view name =
+      absl::StripAsciiWhitespace(std::string_view(text).substr(0, eq_pos));
+  const bool exists = wave_data_->PathToSignal(absl::StrCat("[derived].", name)).has_value();
+  absl::StatusOr<const WaveData::Signal *> signal = Workspace::Get().Waves()->AddDerivedSignal(
+      name, std::string_view(text).substr(eq_pos + 1),
+      [this](std::string_view n) { return ResolveName(n); });
+  if (!signal.ok()) {
+    error_message_ = std::string(signal.status().message());
+    return;
+  }
+  if (exists) {
+    // Everything showing it needs new samples.
+    UpdateWaves();
+    UpdateValues();
+  } else {
+    AddSignal(*signal);
+  }
+}
+
+std::pair<uint64_t, uint64_t> WavesPanel::SelectedTimeRange() const {
+  if (cursor_time_ == marker_time_) return {left_time_, right_time_};
+  return {std::min(cursor_time_, marker_time_), std::max(cursor_time_, marker_time_)};
+}
+
+std::vector<const WavesPanel::ListItem *> WavesPanel::SelectedSignalItems() const {
+  int first = line_idx_;
+  int last = multi_line_idx_ < 0 ? line_idx_ : multi_line_idx_;
+  if (last < first) std::swap(first, last);
+  std::vector<const ListItem *> items;
+  for (int i = first; i <= last; ++i) {
+    if (visible_items_[i]->signal == nullptr || visible_items_[i]->expanded_bit_idx >= 0) continue;
+    items.push_back(visible_items_[i]);
+  }
+  return items;
+}
+
+void WavesPanel::ShowStats() {
+  constexpr int kNumTopValues = 3;
+  const auto [start_time, end_time] = SelectedTimeRange();
+  const std::vector<const ListItem *> items = SelectedSignalItems();
+  if (items.empty()) return;
+  std::vector<const WaveData::Signal *> signals;
+  for (const ListItem *item : items) {
+    signals.push_back(item->signal);
+  }
+  wave_data_->LoadSignalSamples(signals, start_time, end_time);
+  std::vector<const std::vector<WaveData::Sample> *> waves;
+  std::vector<int> widths;
+  for (const WaveData::Signal *signal : signals) {
+    waves.push_back(&wave_data_->LoadedWave(signal));
+    widths.push_back(signal->width);
+  }
+  const std::vector<WaveStats> stats =
+      ComputeWaveStats(waves, widths, start_time, end_time, kNumTopValues);
+
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  table_.emplace(absl::StrFormat("Statistics from %s%s to %s%s",
+                                 AddDigitSeparators(start_time * time_factor), unit_string,
+                                 AddDigitSeparators(end_time * time_factor), unit_string),
+                 std::vector<std::string>{"Signal", "Toggles", "Non-zero", "X/Z", "Min", "Max",
+                                          "Mean", "Most frequent"});
+  const auto percent = [](uint64_t t, uint64_t total) {
+    return total == 0 ? std::string("-") : absl::StrFormat("%.1f%%", 100.0 * t / total);
+  };
+  for (int i = 0; i < items.size(); ++i) {
+    const ListItem *item = items[i];
+    const WaveStats &s = stats[i];
+    const auto format = [&](uint64_t v) {
+      std::string bin(item->signal->width, '0');
+      for (int b = 0; b < bin.size(); ++b) {
+        if ((v >> b) & 1) bin[bin.size() - 1 - b] = '1';
+      }
+      return FormatValue(bin, item->radix, leading_zeroes_);
+    };
+    std::string top;
+    for (const auto &[value, count] : s.top_values) {
+      if (!top.empty()) top += ", ";
+      top += absl::StrFormat("%s (%d)", FormatValue(value, item->radix, leading_zeroes_), count);
+    }
+    table_->AddRow({item->Name(), AddDigitSeparators(s.toggles),
+                    percent(s.nonzero_time, s.duration), percent(s.xz_time, s.duration),
+                    s.numeric ? format(s.min) : "-", s.numeric ? format(s.max) : "-",
+                    s.numeric ? absl::StrFormat("%.2f", s.mean) : "-", top});
+  }
+  tooltips_changed_ = true;
+}
+
+ExprWaves WavesPanel::TriggerWaves() {
+  const auto &inputs = trigger_->Inputs();
+  const auto [start_time, end_time] = wave_data_->TimeRange();
+  wave_data_->LoadSignalSamples(inputs, start_time, end_time);
+  ExprWaves waves;
+  for (const WaveData::Signal *signal : inputs) {
+    waves.push_back(&wave_data_->LoadedWave(signal));
+  }
+  return waves;
+}
+
+void WavesPanel::FindTrigger(bool forward, bool *time_changed, bool *range_changed) {
+  if (!trigger_) {
+    error_message_ = "No trigger, use & to set one.";
+    return;
+  }
+  const auto time = FindExprMatch(*trigger_, TriggerWaves(), cursor_time_, forward);
+  if (!time) {
+    error_message_ = "Trigger not found.";
+    return;
+  }
+  GoToTime(*time, time_changed, range_changed);
+}
+
+void WavesPanel::CountTriggers() {
+  if (!trigger_) {
+    error_message_ = "No trigger, use & to set one.";
+    return;
+  }
+  const int count = CountExprMatches(*trigger_, TriggerWaves(), left_time_, right_time_);
+  error_message_ = absl::StrFormat("%s trigger matches in view", AddDigitSeparators(count));
+}
+
+void WavesPanel::ShowCycleTable(const std::string &clock_name) {
+  const WaveData::Signal *clock = ResolveName(clock_name);
+  if (clock == nullptr) {
+    error_message_ = absl::StrFormat("Unknown clock: %s", clock_name);
+    return;
+  }
+  cycle_clock_ = clock_name;
+  const auto [start_time, end_time] = wave_data_->TimeRange();
+  wave_data_->LoadSignalSamples(clock, start_time, end_time);
+  // Edges are found once, the signals are only sampled for the cycles on screen.
+  auto edges = std::make_shared<const std::vector<uint64_t>>(
+      RisingEdges(wave_data_->Wave(clock), start_time, end_time));
+  if (edges->empty()) {
+    error_message_ = absl::StrFormat("%s has no rising edges", clock_name);
+    return;
+  }
+  std::vector<std::string> header = {"Cycle", "Time"};
+  for (const ListItem &item : cycle_items_) {
+    header.push_back(item.Name());
+  }
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  const auto source = [this, edges, items = cycle_items_, time_factor, unit_string](
+                          int first, int count, std::vector<std::vector<std::string>> *rows,
+                          std::vector<std::optional<uint64_t>> *times) {
+    const std::span<const uint64_t> cycle_times = std::span(*edges).subspan(first, count);
+    // Read just enough to know the values before the first and up to the last edge.
+    const uint64_t load_start = cycle_times.front() > 0 ? cycle_times.front() - 1 : 0;
+    std::vector<const WaveData::Signal *> to_load;
+    for (const ListItem &item : items) {
+      if (!wave_data_->SamplesValid(item.signal, load_start, cycle_times.back())) {
+        to_load.push_back(item.signal);
+      }
+    }
+    if (!to_load.empty()) wave_data_->LoadSignalSamples(to_load, load_start, cycle_times.back());
+    const size_t first_row = rows->size();
+    for (int i = 0; i < count; ++i) {
+      const double time = cycle_times[i] * time_factor;
+      rows->push_back({AddDigitSeparators(first + i),
+                       absl::StrCat(AddDigitSeparators(time), unit_string)});
+      times->push_back(cycle_times[i]);
+    }
+    std::vector<std::string_view> values;
+    for (const ListItem &item : items) {
+      SampleBefore(wave_data_->Wave(item.signal), cycle_times, &values);
+      for (int i = 0; i < count; ++i) {
+        std::string cell = values[i].empty() ? "-" : FormatItemValue(item, values[i]);
+        (*rows)[first_row + i].push_back(std::move(cell));
+      }
+    }
+  };
+  table_.emplace(absl::StrFormat("Values before each rising edge of %s, %s cycles", clock_name,
+                                 AddDigitSeparators(edges->size())),
+                 header, edges->size(), source);
+}
+
+void WavesPanel::ShowGlitches() {
+  const auto [start_time, end_time] = SelectedTimeRange();
+  const std::vector<const ListItem *> items = SelectedSignalItems();
+  if (items.empty()) return;
+  std::vector<const WaveData::Signal *> signals;
+  for (const ListItem *item : items) {
+    signals.push_back(item->signal);
+  }
+  wave_data_->LoadSignalSamples(signals, start_time, end_time);
+  struct Pulse {
+    const ListItem *item;
+    WaveData::Glitch glitch;
+  };
+  std::vector<Pulse> pulses;
+  for (const ListItem *item : items) {
+    for (WaveData::Glitch &g : wave_data_->Glitches(item->signal, start_time, end_time)) {
+      pulses.push_back({item, std::move(g)});
+    }
+  }
+  if (pulses.empty()) {
+    error_message_ = "No glitches";
+    return;
+  }
+  std::stable_sort(pulses.begin(), pulses.end(),
+                   [](const Pulse &a, const Pulse &b) { return a.glitch.time < b.glitch.time; });
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  table_.emplace(absl::StrFormat("%s zero-time pulses from %s%s to %s%s",
+                                 AddDigitSeparators(pulses.size()),
+                                 AddDigitSeparators(start_time * time_factor), unit_string,
+                                 AddDigitSeparators(end_time * time_factor), unit_string),
+                 std::vector<std::string>{"Time", "Signal", "Values", "Pulse", "Settles to"});
+  for (const Pulse &p : pulses) {
+    const std::vector<WaveData::Sample> &wave = wave_data_->Wave(p.item->signal);
+    const int idx = wave_data_->FindSampleIndex(p.glitch.time, p.item->signal);
+    const double time = p.glitch.time * time_factor;
+    table_->AddRow({absl::StrCat(AddDigitSeparators(time), unit_string), p.item->Name(),
+                    AddDigitSeparators(p.glitch.count), FormatItemValue(*p.item, p.glitch.value),
+                    idx < 0 ? "-" : FormatItemValue(*p.item, wave[idx].value)},
+                   p.glitch.time);
+  }
+}
+
+void WavesPanel::DecodeTransactions(const std::string &text) {
+  std::vector<const WaveData::Signal *> handshake;
+  const WaveData::Signal *clock = nullptr;
+  std::vector<ListItem> fields;
+  for (std::string_view token : absl::StrSplit(text, ' ', absl::SkipEmpty())) {
+    const bool is_clock = absl::ConsumePrefix(&token, "@");
+    const WaveData::Signal *signal = ResolveName(token);
+    if (signal == nullptr) {
+      error_message_ = absl::StrFormat("Unknown signal: %s", token);
+      return;
+    }
+    if (is_clock) {
+      clock = signal;
+    } else if (handshake.size() < 2) {
+      handshake.push_back(signal);
+    } else {
+      // Payload is shown like in the list, if it is there.
+      const auto it = std::find_if(items_.begin(), items_.end(), [&](const ListItem &item) {
+        return item.signal == signal && item.expanded_bit_idx < 0;
+      });
+      fields.push_back(it == items_.end() ? ListItem(signal) : *it);
+    }
+  }
+  if (handshake.size() < 2) {
+    error_message_ = "Expecting valid ready [@clock] [payload...]";
+    return;
+  }
+  handshake_text_ = text;
+  std::vector<const WaveData::Signal *> signals = handshake;
+  if (clock != nullptr) signals.push_back(clock);
+  for (const ListItem &field : fields) {
+    signals.push_back(field.signal);
+  }
+  const auto [start_time, end_time] = wave_data_->TimeRange();
+  wave_data_->LoadSignalSamples(signals, start_time, end_time);
+  HandshakeWaves waves;
+  waves.valid = &wave_data_->LoadedWave(handshake[0]);
+  waves.ready = &wave_data_->LoadedWave(handshake[1]);
+  if (clock != nullptr) waves.clock = &wave_data_->LoadedWave(clock);
+  for (const ListItem &field : fields) {
+    waves.payload.push_back(&wave_data_->LoadedWave(field.signal));
+  }
+  transactions_ = TransactionTable::Extract(waves, start_time, end_time);
+  if (transactions_->Size() == 0) {
+    error_message_ = "No transfers found";
+    transactions_.reset();
+    return;
+  }
+  transaction_fields_ = std::move(fields);
+  ShowTransactions(0);
+}
+
+void WavesPanel::ShowTransactions(int selected) {
+  const TransactionTable &t = *transactions_;
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  // Latencies are in cycles for clocked handshakes.
+  const auto format_latency = [=, clocked = t.Clocked()](double latency) {
+    return clocked ? AddDigitSeparators(latency)
+                   : absl::StrCat(AddDigitSeparators(latency * time_factor), unit_string);
+  };
+  std::string title = absl::StrFormat(
+      "%s transfers, latency %s min, %s max, %.1f mean", AddDigitSeparators(t.Size()),
+      format_latency(t.Latencies().Min()), format_latency(t.Latencies().Max()),
+      t.Clocked() ? t.Latencies().Mean() : t.Latencies().Mean() * time_factor);
+  if (t.Clocked() && t.Span() > 0) {
+    absl::StrAppendFormat(&title, ", %.3f per cycle", static_cast<double>(t.Size()) / t.Span());
+  }
+  std::vector<std::string> header = {"#", "Start", "End", "Latency"};
+  for (const ListItem &field : transaction_fields_) {
+    header.push_back(field.Name());
+  }
+  const auto source = [this, time_factor, unit_string, format_latency](
+                          int first, int count, std::vector<std::vector<std::string>> *rows,
+                          std::vector<std::optional<uint64_t>> *times) {
+    const TransactionTable &t = *transactions_;
+    for (int idx = first; idx < first + count; ++idx) {
+      const double start = t.StartTime(idx) * time_factor;
+      const double end = t.EndTime(idx) * time_factor;
+      std::vector<std::string> cells = {AddDigitSeparators(idx),
+                                        absl::StrCat(AddDigitSeparators(start), unit_string),
+                                        absl::StrCat(AddDigitSeparators(end), unit_string),
+                                        format_latency(t.Latency(idx))};
+      for (int f = 0; f < transaction_fields_.size(); ++f) {
+        cells.push_back(FormatItemValue(transaction_fields_[f], t.Payload(idx, f)));
+      }
+      rows->push_back(std::move(cells));
+      times->push_back(t.StartTime(idx));
+    }
+  };
+  table_.emplace(title, header, t.Size(), source);
+  table_->Select(selected);
+  showing_histograms_ = false;
+}
+
+void WavesPanel::ShowTransactionHistograms() {
+  constexpr int kBarSize = 20;
+  const TransactionTable &t = *transactions_;
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  const std::vector<uint64_t> &latencies = t.Latencies().Buckets();
+  const std::vector<uint64_t> &gaps = t.Gaps().Buckets();
+  const uint64_t max_count = std::max(
+      latencies.empty() ? 0 : *std::max_element(latencies.begin(), latencies.end()),
+      gaps.empty() ? 0 : *std::max_element(gaps.begin(), gaps.end()));
+  const auto bar = [&](const std::vector<uint64_t> &buckets, int b) {
+    const uint64_t count = b < buckets.size() ? buckets[b] : 0;
+    // Anything non-zero gets at least one mark.
+    const int size = count == 0 ? 0 : std::max<int>(1, count * kBarSize / max_count);
+    return std::make_pair(AddDigitSeparators(count), std::string(size, '#'));
+  };
+  table_.emplace(absl::StrFormat("Latency and gap between transfers, in %s",
+                                 t.Clocked() ? "cycles" : unit_string),
+                 std::vector<std::string>{"From", "Latency", "", "Gap", ""});
+  for (int b = 0; b < std::max(latencies.size(), gaps.size()); ++b) {
+    const uint64_t from = Histogram::BucketStart(b);
+    const auto [latency_count, latency_bar] = bar(latencies, b);
+    const auto [gap_count, gap_bar] = bar(gaps, b);
+    table_->AddRow({AddDigitSeparators(t.Clocked() ? from : from * time_factor), latency_count,
+                    latency_bar, gap_count, gap_bar});
+  }
+  showing_histograms_ = true;
+}
+
+void WavesPanel::FindTransaction(const std::string &text, bool forward) {
+  const TransactionTable &t = *transactions_;
+  const int from = table_->SelectedRow();
+  int found = -1;
+  bool parsed = false;
+  for (int f = 0; f < transaction_fields_.size(); ++f) {
+    const ListItem &field = transaction_fields_[f];
+    absl::StatusOr<ValueMatcher> matcher =
+        ValueMatcher::Parse(text, field.signal->width, field.radix);
+    if (!matcher.ok()) continue;
+    parsed = true;
+    // The closest match of any field wins.
+    const int idx = t.FindPayload(from, forward, f,
+                                  [&](std::string_view value) { return matcher->Matches(value); });
+    if (idx >= 0 && (found < 0 || (forward ? idx < found : idx > found))) found = idx;
+  }
+  if (!parsed) {
+    error_message_ = "Invalid value";
+  } else if (found < 0) {
+    error_message_ = "Payload not found";
+  } else {
+    table_->Select(found);
+  }
+}
+
+void WavesPanel::DiffGolden(const std::string &file_name) {
+  if (absl::Status status = Workspace::Get().LoadGoldenWaves(file_name); !status.ok()) {
+    error_message_ = std::string(status.message());
+    return;
+  }
+  const auto [start_time, end_time] = wave_data_->TimeRange();
+  const absl::StatusOr<WaveDiff> diff =
+      DiffWaves(*wave_data_, *Workspace::Get().GoldenWaves(), start_time, end_time,
+                ReportOptions().memory_budget);
+  if (!diff.ok()) {
+    error_message_ = std::string(diff.status().message());
+    return;
+  }
+  if (diff->mismatches.empty()) {
+    error_message_ = absl::StrFormat("All %s matching signals are identical",
+                                     AddDigitSeparators(diff->num_compared));
+    return;
+  }
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  table_.emplace(absl::StrFormat("%s of %s signals differ (%s only here, %s only in golden)",
+                                 AddDigitSeparators(diff->mismatches.size()),
+                                 AddDigitSeparators(diff->num_compared),
+                                 AddDigitSeparators(diff->num_only_compared),
+                                 AddDigitSeparators(diff->num_only_golden)),
+                 std::vector<std::string>{"First mismatch", "Signal"});
+  table_signals_.clear();
+  for (const WaveDiff::Mismatch &m : diff->mismatches) {
+    table_->AddRow({absl::StrCat(AddDigitSeparators(m.time * time_factor), unit_string),
+                    WaveData::SignalToPath(m.signal)},
+                   m.time);
+    table_signals_.push_back(m.signal);
+  }
+}
+
+void WavesPanel::CheckAssertions(const std::string &text) {
+  property_text_ = text;
+  std::vector<WaveProperty> properties;
+  std::vector<std::string> names;
+  int num_unsupported = 0;
+  if (text.empty()) {
+    const slang::ast::RootSymbol *design = Workspace::Get().Design();
+    if (design == nullptr) {
+      error_message_ = "No design loaded";
+      return;
+    }
+    for (const SlangAssertion &a : GetConcurrentAssertions(*design)) {
+      // Names are looked up from the assertion's scope, and then mapped to the waves.
+      auto prop = WaveProperty::Compile(a.property, [&](std::string_view name) {
+        const slang::ast::Symbol *sym = a.scope->lookupName(name);
+        if (sym == nullptr) return static_cast<const WaveData::Signal *>(nullptr);
+        const auto signals = Workspace::Get().DesignToSignals(sym);
+        return signals.empty() ? nullptr : signals.front();
+      });
+      if (!prop.ok()) {
+        num_unsupported++;
+        continue;
+      }
+      properties.push_back(*std::move(prop));
+      names.push_back(a.name);
+    }
+    if (properties.empty()) {
+      error_message_ = absl::StrFormat("No assertions to check, %d unsupported", num_unsupported);
+      return;
+    }
+  } else {
+    auto prop = WaveProperty::Compile(
+        text, [&](std::string_view name) { return ResolveName(name); });
+    if (!prop.ok()) {
+      error_message_ = std::string(prop.status().message());
+      return;
+    }
+    properties.push_back(*std::move(prop));
+    names.push_back(text);
+  }
+  const auto [start_time, end_time] = wave_data_->TimeRange();
+  std::vector<const WaveData::Signal *> inputs;
+  for (const WaveProperty &prop : properties) {
+    inputs.insert(inputs.end(), prop.Inputs().begin(), prop.Inputs().end());
+  }
+  wave_data_->LoadSignalSamples(inputs, start_time, end_time);
+  const std::vector<WaveProperty::Result> results =
+      CheckProperties(&properties, *wave_data_, start_time, end_time);
+  uint64_t num_failures = 0;
+  int num_failing = 0;
+  for (const WaveProperty::Result &r : results) {
+    num_failures += r.failures.size();
+    num_failing += !r.failures.empty();
+  }
+  if (num_failures == 0) {
+    error_message_ = absl::StrFormat("All %d properties hold", properties.size());
+    return;
+  }
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  table_.emplace(absl::StrFormat("%s failures of %d of %d properties (%d unsupported)",
+                                 AddDigitSeparators(num_failures), num_failing, properties.size(),
+                                 num_unsupported),
+                 std::vector<std::string>{"Failed", "Started", "Property"});
+  for (int i = 0; i < results.size(); ++i) {
+    for (const WaveProperty::Failure &f : results[i].failures) {
+      table_->AddRow({absl::StrCat(AddDigitSeparators(f.fail_time * time_factor), unit_string),
+                      absl::StrCat(AddDigitSeparators(f.start_time * time_factor), unit_string),
+                      names[i]},
+                     f.fail_time);
+    }
+  }
+}
+
+void WavesPanel::TraceUnknown() {
+  const ListItem *item = visible_items_[line_idx_];
+  if (item->signal == nullptr) return;
+  if (Workspace::Get().Design() == nullptr) {
+    error_message_ = "No design loaded";
+    return;
+  }
+  const DriverLoadIndex *index = Workspace::Get().DriverLoads();
+  if (index == nullptr) {
+    error_message_ = "Still indexing the design, try again shortly.";
+    return;
+  }
+  const slang::ast::Symbol *net = Workspace::Get().SignalToDesign(item->signal);
+  if (net == nullptr) {
+    error_message_ = "Signal not found in the design";
+    return;
+  }
+  const int idx = wave_data_->FindSampleIndex(cursor_time_, item->signal);
+  if (idx < 0 ||
+      wave_data_->Wave(item->signal)[idx].value.find_first_of("xXzZ") == std::string::npos) {
+    error_message_ = "Value is not unknown at the cursor";
+    return;
+  }
+  if (!x_tracer_ || &x_tracer_->Index() != index) x_tracer_.emplace(*index);
+  const std::vector<XSource> sources = x_tracer_->Trace(net, cursor_time_, kMaxXConeNets);
+  if (sources.empty()) {
+    error_message_ = "No source of the unknown value found";
+    return;
+  }
+  const double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
+  const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
+  table_.emplace(absl::StrFormat("Sources of the unknown value of %s", item->Name()),
+                 std::vector<std::string>{"Unknown since", "Depth", "Signal"});
+  table_signals_.clear();
+  for (const XSource &s : sources) {
+    table_->AddRow({absl::StrCat(AddDigitSeparators(s.since * time_factor), unit_string),
+                    absl::StrCat(s.depth), WaveData::SignalToPath(s.signal)},
+                   s.since);
+    table_signals_.push_back(s.signal);
+  }
+}
+
 void WavesPanel::SnapToValue() {
   const auto *item = visible_items_[line_idx_];
   if (item->signal == nullptr) return;
@@ -213,6 +817,13 @@ std::optional<std::pair<int, int>> WavesPanel::CursorLocation() const {
   if (inputting_time_) return time_input_.CursorPos();
   if (rename_item_ != nullptr) return rename_input_.CursorPos();
   if (inputting_open_ || inputting_save_) return filename_input_.CursorPos();
+  if (inputting_value_) return value_input_.CursorPos();
+  if (inputting_trigger_) return trigger_input_.CursorPos();
+  if (inputting_derived_) return derived_input_.CursorPos();
+  if (inputting_golden_) return golden_input_.CursorPos();
+  if (inputting_clock_) return clock_input_.CursorPos();
+  if (inputting_handshake_) return handshake_input_.CursorPos();
+  if (inputting_property_) return property_input_.CursorPos();
   return std::nullopt;
 }
 
@@ -243,7 +854,14 @@ void WavesPanel::UpdateVisibleSignals() {
 }
 
 void WavesPanel::Draw() {
+  Workspace::Get().WaveTimeWindow() = SelectedTimeRange();
   werase(w_);
+  if (table_) {
+    table_->Draw(w_);
+    // Transaction searches are typed over the title.
+    if (inputting_value_) value_input_.Draw(w_);
+    return;
+  }
   const int wave_x = name_value_size_;
   const int max_w = getmaxx(w_);
   const int max_h = getmaxy(w_);
@@ -297,6 +915,20 @@ void WavesPanel::Draw() {
     time_input_.Draw(w_);
   } else if (inputting_open_ || inputting_save_) {
     filename_input_.Draw(w_);
+  } else if (inputting_value_) {
+    value_input_.Draw(w_);
+  } else if (inputting_trigger_) {
+    trigger_input_.Draw(w_);
+  } else if (inputting_derived_) {
+    derived_input_.Draw(w_);
+  } else if (inputting_golden_) {
+    golden_input_.Draw(w_);
+  } else if (inputting_clock_) {
+    clock_input_.Draw(w_);
+  } else if (inputting_handshake_) {
+    handshake_input_.Draw(w_);
+  } else if (inputting_property_) {
+    property_input_.Draw(w_);
   } else {
     const char *unit_string = kTimeUnits[(time_unit_ - kSmallestUnit) / 3];
     double time_factor = pow(10, wave_data_->Log10TimeUnits() - time_unit_);
@@ -612,6 +1244,16 @@ void WavesPanel::Draw() {
           waddch(w_, (i == char_offset && char_offset != 0) ? '.' : wv.value[i]);
         }
       }
+      if (item->show_glitches) {
+        // Pulses that took no time are not in the samples, so they are marked separately.
+        SetColor(w_, kWavesXPair + highlight);
+        for (const WaveData::Glitch &g :
+             wave_data_->Glitches(item->signal, left_time_, right_time_)) {
+          const int x = (g.time - left_time_) / time_per_char;
+          if (wave_x + x >= max_w) break;
+          mvwaddch(w_, row - 1, wave_x + x, '!');
+        }
+      }
     }
     list_idx++;
   }
@@ -696,7 +1338,44 @@ void WavesPanel::UIChar(int ch) {
   bool edge_search = false;
   // Most actions cancel multi-line.
   bool cancel_multi_line = true;
-  if (showing_path_) {
+  if (table_ && transactions_ && !inputting_value_ &&
+      (ch == 'H' || (!showing_histograms_ && (ch == 'v' || ch == 'V')))) {
+    if (ch == 'H') {
+      if (showing_histograms_) {
+        ShowTransactions(0);
+      } else {
+        ShowTransactionHistograms();
+      }
+    } else {
+      value_search_forward_ = ch == 'v';
+      value_input_.SetPrompt(value_search_forward_ ? "Find next payload:" : "Find prev payload:");
+      inputting_value_ = true;
+    }
+    tooltips_changed_ = true;
+    cancel_multi_line = false;
+  } else if (table_ && !inputting_value_) {
+    const auto state = table_->HandleKey(ch);
+    if (state == TableOverlay::kSelected) {
+      GoToTime(*table_->SelectedTime(), &time_changed, &range_changed);
+      edge_search = true;
+      if (table_->SelectedRow() < table_signals_.size()) {
+        const WaveData::Signal *signal = table_signals_[table_->SelectedRow()];
+        if (std::none_of(items_.begin(), items_.end(),
+                         [&](const ListItem &item) { return item.signal == signal; })) {
+          AddSignal(signal);
+        }
+      }
+    }
+    if (state != TableOverlay::kOpen) {
+      table_.reset();
+      table_signals_.clear();
+      transactions_.reset();
+      // Tables may have loaded other time ranges of the signals on screen.
+      range_changed = true;
+      tooltips_changed_ = true;
+    }
+    cancel_multi_line = false;
+  } else if (showing_path_) {
     showing_path_ = false;
   } else if (color_selection_) {
     int start = line_idx_;
@@ -746,6 +1425,67 @@ void WavesPanel::UIChar(int ch) {
       inputting_save_ = false;
       filename_input_.Reset();
     }
+  } else if (inputting_value_) {
+    const auto state = value_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_value_ = false;
+      if (state == TextInput::kDone && transactions_) {
+        FindTransaction(value_input_.Text(), value_search_forward_);
+      } else if (state == TextInput::kDone) {
+        FindValue(value_input_.Text(), value_search_forward_, &time_changed, &range_changed);
+        edge_search = true;
+      }
+      value_input_.Reset();
+    }
+  } else if (inputting_trigger_) {
+    const auto state = trigger_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_trigger_ = false;
+      if (state == TextInput::kDone) {
+        SetTrigger(trigger_input_.Text());
+        if (trigger_) {
+          FindTrigger(/*forward*/ true, &time_changed, &range_changed);
+          edge_search = true;
+        }
+      }
+      trigger_input_.Reset();
+    }
+  } else if (inputting_derived_) {
+    const auto state = derived_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_derived_ = false;
+      if (state == TextInput::kDone) DefineDerived(derived_input_.Text());
+      derived_input_.Reset();
+    }
+  } else if (inputting_golden_) {
+    const auto state = golden_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_golden_ = false;
+      if (state == TextInput::kDone) DiffGolden(golden_input_.Text());
+      golden_input_.Reset();
+    }
+  } else if (inputting_clock_) {
+    const auto state = clock_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_clock_ = false;
+      if (state == TextInput::kDone) ShowCycleTable(clock_input_.Text());
+      cycle_items_.clear();
+      clock_input_.Reset();
+    }
+  } else if (inputting_handshake_) {
+    const auto state = handshake_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_handshake_ = false;
+      if (state == TextInput::kDone) DecodeTransactions(handshake_input_.Text());
+      handshake_input_.Reset();
+    }
+  } else if (inputting_property_) {
+    const auto state = property_input_.HandleKey(ch);
+    if (state != TextInput::kTyping) {
+      inputting_property_ = false;
+      if (state == TextInput::kDone) CheckAssertions(property_input_.Text());
+      property_input_.Reset();
+    }
   } else if (inputting_time_) {
     const auto state = time_input_.HandleKey(ch);
     if (state != TextInput::kTyping) {
@@ -926,6 +1666,77 @@ void WavesPanel::UIChar(int ch) {
       FindEdge(ch == 'e', &time_changed, &range_changed);
       edge_search = true;
       break;
+    case 'v':
+    case 'V':
+      if (item->signal != nullptr) {
+        value_search_forward_ = ch == 'v';
+        value_input_.SetPrompt(value_search_forward_ ? "Find next value:" : "Find prev value:");
+        inputting_value_ = true;
+      }
+      break;
+    case '&':
+      trigger_input_.SetPrompt("Trigger:");
+      inputting_trigger_ = true;
+      break;
+    case '>':
+    case '<':
+      FindTrigger(ch == '>', &time_changed, &range_changed);
+      edge_search = true;
+      break;
+    case '#': CountTriggers(); break;
+    case 'I':
+      ShowStats();
+      cancel_multi_line = false;
+      break;
+    case 'W':
+      ShowGlitches();
+      cancel_multi_line = false;
+      break;
+    case 'X': TraceUnknown(); break;
+    case '!':
+      if (item->signal != nullptr) item->show_glitches = !item->show_glitches;
+      break;
+    case '=':
+      derived_input_.SetPrompt("Derived signal:");
+      // Start from the current definition when on a derived signal.
+      if (item->signal != nullptr) {
+        if (const auto definition = wave_data_->DerivedDefinition(item->signal)) {
+          derived_input_.SetText(absl::StrCat(item->signal->name, " = ", *definition));
+        }
+      }
+      inputting_derived_ = true;
+      break;
+    case 'C': {
+      int first = 0;
+      int last = visible_items_.size() - 1;
+      if (multi_line_idx_ >= 0) {
+        first = std::min(line_idx_, multi_line_idx_);
+        last = std::max(line_idx_, multi_line_idx_);
+      }
+      cycle_items_.clear();
+      for (int i = first; i <= last; ++i) {
+        if (visible_items_[i]->signal != nullptr) cycle_items_.push_back(*visible_items_[i]);
+      }
+      if (cycle_items_.empty()) break;
+      clock_input_.SetPrompt("Clock for cycle table:");
+      clock_input_.SetText(cycle_clock_);
+      inputting_clock_ = true;
+    } break;
+    case 'P':
+      handshake_input_.SetPrompt("Handshake (valid ready [@clock] [payload...]):");
+      handshake_input_.SetText(handshake_text_);
+      inputting_handshake_ = true;
+      break;
+    case '%':
+      property_input_.SetPrompt("Property (empty for all design assertions):");
+      property_input_.SetText(property_text_);
+      inputting_property_ = true;
+      break;
+    case 'O':
+      golden_input_.SetPrompt("Compare with golden waves:");
+      golden_input_.SetText(Workspace::Get().GoldenFile());
+      inputting_golden_ = true;
+      break;
     case 'r':
       if (item->signal != nullptr) {
         item->CycleRadix();
@@ -944,7 +1755,7 @@ void WavesPanel::UIChar(int ch) {
       tooltips_changed_ = true;
       break;
     case 'd':
-      if (Workspace::Get().Design() != nullptr) {
+      if (Workspace::Get().Design() != nullptr || wave_data_->HasSourceLocations()) {
         signal_for_source_ = item->signal;
       }
       break;
@@ -972,6 +1783,13 @@ void WavesPanel::UIChar(int ch) {
     case 0x1: // Ctrl-a
       item->CycleAnalogType();
       break;
+    case 'i': {
+      const WaveData::MemoryUsage usage = wave_data_->SampleMemory();
+      error_message_ = absl::StrFormat(
+          "%s waves, %s samples, %s bytes, %s bytes saved by aliases",
+          AddDigitSeparators(usage.num_waves), AddDigitSeparators(usage.num_samples),
+          AddDigitSeparators(usage.bytes), AddDigitSeparators(usage.shared_bytes));
+    } break;
     default: Panel::UIChar(ch);
     }
   }
@@ -1177,18 +1995,21 @@ void WavesPanel::UpdateValue(ListItem *item) {
     return;
   }
   const uint64_t idx = wave_data_->FindSampleIndex(cursor_time_, item->signal);
-  if (item->expanded_bit_idx >= 0) {
-    item->value = wave[idx].value[item->expanded_bit_idx];
-  } else {
-    if (item->signal->enum_id >= 0) {
-      if (std::optional<std::string_view> label =
-              wave_data_->GetEnumLabel(item->signal->enum_id, wave[idx].value)) {
-        item->value = *label;
-        return;
-      }
+  item->value = FormatItemValue(*item, wave[idx].value);
+}
+
+std::string WavesPanel::FormatItemValue(const ListItem &item, std::string_view value) const {
+  if (item.expanded_bit_idx >= 0) {
+    return item.expanded_bit_idx < value.size() ? std::string(1, value[item.expanded_bit_idx])
+                                                : std::string();
+  }
+  if (item.signal->enum_id >= 0) {
+    if (std::optional<std::string_view> label =
+            wave_data_->GetEnumLabel(item.signal->enum_id, value)) {
+      return std::string(*label);
     }
-    item->value = FormatValue(wave[idx].value, item->radix, leading_zeroes_);
   }
+  return FormatValue(std::string(value), item.radix, leading_zeroes_);
 }
 
 void WavesPanel::UpdateValues() {
@@ -1203,10 +2024,7 @@ void WavesPanel::UpdateWaves() {
   for (auto *item : visible_items_) {
     if (item->signal == nullptr) continue;
     // Skip the update if all the data is already present.
-    if (item->signal->valid_start_time <= left_time_ &&
-        item->signal->valid_end_time >= right_time_) {
-      continue;
-    }
+    if (wave_data_->SamplesValid(item->signal, left_time_, right_time_)) continue;
     signal_list.push_back(item->signal);
     items_to_update.push_back(item);
   }
@@ -1244,12 +2062,24 @@ void WavesPanel::AddGroup() {
 }
 
 bool WavesPanel::Modal() const {
-  return rename_item_ != nullptr || inputting_time_ || showing_path_ || inputting_open_ ||
-         inputting_save_;
+  return table_ || rename_item_ != nullptr || inputting_time_ || showing_path_ || inputting_open_ ||
+         inputting_save_ || inputting_value_ || inputting_trigger_ || inputting_derived_ ||
+         inputting_golden_ || inputting_clock_ || inputting_handshake_ || inputting_property_;
 }
 
 std::vector<Tooltip> WavesPanel::Tooltips() const {
-  if (marker_selection_) {
+  if (table_) {
+    std::vector<Tooltip> tt{
+        {"jk", "Select row"},
+        {"Enter", "Go to time"},
+        {"q", "Close"},
+    };
+    if (transactions_) {
+      if (!showing_histograms_) tt.push_back({"vV", "Find payload"});
+      tt.push_back({"H", showing_histograms_ ? "Transactions" : "Histograms"});
+    }
+    return tt;
+  } else if (marker_selection_) {
     return {{"0-9", "marker selection"}};
   } else if (color_selection_) {
     return {
@@ -1263,6 +2093,19 @@ std::vector<Tooltip> WavesPanel::Tooltips() const {
       {"123", "align left/center/right"},
       {"C-z", "Zoom cursor-marker"},
       {"eE", "Prev/next edge"},
+      {"vV", "Find next/prev value"},
+      {"&", "Set trigger"},
+      {"<>", "Prev/next trigger"},
+      {"#", "Count triggers"},
+      {"=", "Derived signal"},
+      {"I", "Signal statistics"},
+      {"!", "Show glitches"},
+      {"W", "Glitch report"},
+      {"C", "Cycle table"},
+      {"P", "Decode transactions"},
+      {"O", "Compare with golden"},
+      {"%", "Check assertions"},
+      {"X", "Trace X source"},
       {"sS", "Adjust size"},
       {"aA", "Analog size"},
       {"C-a", "Analog type"},
@@ -1282,8 +2125,9 @@ std::vector<Tooltip> WavesPanel::Tooltips() const {
       {"C-u", "Toggle Unicode"},
       {"C-o", "Open list file"},
       {"C-s", "Save list file"},
+      {"i", "Wave memory info"},
   };
-  if (Workspace::Get().Design() != nullptr) {
+  if (Workspace::Get().Design() != nullptr || wave_data_->HasSourceLocations()) {
     tt.push_back({"d", "Declaration"});
   }
   return tt;
@@ -1352,6 +2196,12 @@ void WavesPanel::PrepareForWaveDataReload() {
       reload_waves_[i] = WaveData::SignalToPath(items_[i].signal);
     }
   }
+  // The trigger holds signal pointers too, it is compiled again from its text.
+  trigger_.reset();
+  table_.reset();
+  table_signals_.clear();
+  transactions_.reset();
+  x_tracer_.reset();
 }
 
 void WavesPanel::HandleReloadedWaves() {
@@ -1365,6 +2215,13 @@ void WavesPanel::HandleReloadedWaves() {
       item.unavailable_name = path;
     }
   }
+  if (!trigger_text_.empty()) SetTrigger(trigger_text_);
+  UpdateWaves();
+  UpdateValues();
+}
+
+void WavesPanel::HandleAppendedWaves() {
+  // Pointers are still good, just pick up any new samples.
   UpdateWaves();
   UpdateValues();
 }
@@ -1398,6 +2255,19 @@ void WavesPanel::LoadList(const std::string &file_name) {
         left_time_ = read_time(line);
       } else if (absl::StartsWith(line, "$tmax")) {
         right_time_ = read_time(line);
+      } else if (absl::StartsWith(line, "$derived=")) {
+        // Definitions use full paths, and come before any items that use them.
+        std::string_view text = line;
+        absl::ConsumePrefix(&text, "$derived=");
+        const size_t eq_pos = text.find('=');
+        absl::StatusOr<const WaveData::Signal *> signal =
+            Workspace::Get().Waves()->AddDerivedSignal(
+                text.substr(0, eq_pos), text.substr(std::min(eq_pos + 1, text.size())),
+                [this](std::string_view path) -> const WaveData::Signal * {
+                  if (auto signal = wave_data_->PathToSignal(path)) return *signal;
+                  return nullptr;
+                });
+        if (!signal.ok()) error_message_ = std::string(signal.status().message());
       } else if (absl::StartsWith(line, "$m")) {
         if (line[2] >= '0' && line[2] <= '9') {
           numbered_marker_times_[line[2] - '0'] = read_time(line);
@@ -1506,6 +2376,9 @@ void WavesPanel::SaveList(const std::string &file_name) {
       file << "$m" << i << "=" << numbered_marker_times_[i] << "\n";
     }
   }
+  for (const WaveData::Signal *signal : wave_data_->DerivedSignals()) {
+    file << "$derived=" << signal->name << "=" << *wave_data_->DerivedDefinition(signal) << "\n";
+  }
   // Don't write out the last item since that's the default blank.
   for (int i = 0; i < items_.size() - 1; ++i) {
     const auto &item = items_[i];
@@ -3,9 +3,13 @@
 #include "absl/container/flat_hash_map.h"
 #include "panel.h"
 #include "radix.h"
+#include "table_overlay.h"
 #include "text_input.h"
+#include "transactions.h"
 #include "wave_data.h"
+#include "wave_expr.h"
 #include "wave_image.h"
+#include "x_trace.h"
 
 namespace sv {
 
@@ -30,6 +34,8 @@ class WavesPanel : public Panel {
   std::optional<const WaveData::Signal *> SignalForSource();
   void PrepareForWaveDataReload() final;
   void HandleReloadedWaves() final;
+  void HandleAppendedWaves() final;
+  void PrepareForDesignReload() final { x_tracer_.reset(); }
   // Public because the main UI could call this on startup. This allows for wave listing restore on
   // startup via command line specified file.
   void LoadList(const std::string &file_name);
@@ -57,6 +63,8 @@ class WavesPanel : public Panel {
     int expanded_bit_idx = -1;
     bool is_group = false;
     bool collapsed = false;
+    // Mark zero-time transitions that were dropped from the samples.
+    bool show_glitches = false;
     // Saved here instead of searched and derived every time.
     std::string value;
     int Height() const { return analog_rows > 0 ? analog_rows : 1; }
@@ -69,11 +77,50 @@ class WavesPanel : public Panel {
   void UpdateValues();
   void UpdateWaves();
   void UpdateValue(ListItem *item);
+  // Text of a sample value as shown for the item, with its radix, enum labels or expanded bit.
+  std::string FormatItemValue(const ListItem &item, std::string_view value) const;
   void UpdateWave(ListItem *item);
   void SnapToValue();
   void ExpandMultiBit();
   void CheckMultiBit();
   void FindEdge(bool forward, bool *time_changed, bool *range_changed);
+  void FindValue(const std::string &text, bool forward, bool *time_changed, bool *range_changed);
+  // Signal names in expressions are matched against the signals in the list first, then taken as
+  // full paths.
+  const WaveData::Signal *ResolveName(std::string_view name) const;
+  void SetTrigger(const std::string &text);
+  // Defines (or redefines) a derived signal from "name = expression" text.
+  void DefineDerived(const std::string &text);
+  void FindTrigger(bool forward, bool *time_changed, bool *range_changed);
+  // Reports the number of trigger matches in the visible time range.
+  void CountTriggers();
+  // Between the cursor and the marker, or what is visible when they are the same.
+  std::pair<uint64_t, uint64_t> SelectedTimeRange() const;
+  // Selected lines with a signal, leaving out expanded bits since they share the whole signal.
+  std::vector<const ListItem *> SelectedSignalItems() const;
+  // Shows statistics of the selected signals between the cursor and the marker.
+  void ShowStats();
+  // Lists the zero-time pulses of the selected signals between the cursor and the marker.
+  void ShowGlitches();
+  // Shows the values of the selected signals (all when there is no selection) at each rising edge
+  // of the clock, a row per cycle.
+  void ShowCycleTable(const std::string &clock_name);
+  // Decodes the transfers of a handshake given as "valid ready [@clock] [payload...]", where
+  // leaving out the clock makes it a req/ack handshake.
+  void DecodeTransactions(const std::string &text);
+  void ShowTransactions(int selected);
+  void ShowTransactionHistograms();
+  // Selects the next (or previous) transaction with a payload field matching the value.
+  void FindTransaction(const std::string &text, bool forward);
+  // Compares all signals with the same ones in a golden wave file, listing the mismatches.
+  void DiffGolden(const std::string &file_name);
+  // Checks a property (or every assertion in the design when the text is empty) over the whole
+  // waves, listing the failing attempts.
+  void CheckAssertions(const std::string &text);
+  // Lists where in the design the unknown value of the selected signal at the cursor comes from.
+  void TraceUnknown();
+  // Loads the complete waves of all trigger inputs.
+  ExprWaves TriggerWaves();
   void GoToTime(uint64_t time, bool *time_changed, bool *range_changed);
   void SaveList(const std::string &file_name);
   std::pair<int, int> UIRowsOfLine(int line) const final;
@@ -99,11 +146,43 @@ class WavesPanel : public Panel {
   TextInput time_input_;
   TextInput rename_input_;
   TextInput filename_input_;
+  TextInput value_input_;
+  TextInput trigger_input_;
+  TextInput derived_input_;
+  TextInput golden_input_;
+  TextInput clock_input_;
+  TextInput handshake_input_;
+  TextInput property_input_;
   ListItem *rename_item_ = nullptr;
   bool inputting_time_ = false;
   bool showing_path_ = false;
   bool inputting_open_ = false;
   bool inputting_save_ = false;
+  bool inputting_value_ = false;
+  bool value_search_forward_ = true;
+  bool inputting_trigger_ = false;
+  bool inputting_derived_ = false;
+  bool inputting_golden_ = false;
+  bool inputting_clock_ = false;
+  bool inputting_handshake_ = false;
+  bool inputting_property_ = false;
+  std::optional<WaveExpr> trigger_;
+  std::string trigger_text_;
+  // Reports are shown in place of the waves until closed.
+  std::optional<TableOverlay> table_;
+  // Signal of each row of a golden comparison table, added to the list when its row is picked.
+  std::vector<const WaveData::Signal *> table_signals_;
+  // Signals for the cycle table, picked before the clock is entered.
+  std::vector<ListItem> cycle_items_;
+  std::string cycle_clock_;
+  // Decoded transfers, shown as a table (or their histograms) until it is closed.
+  std::optional<TransactionTable> transactions_;
+  std::vector<ListItem> transaction_fields_;
+  std::string handshake_text_;
+  bool showing_histograms_ = false;
+  std::string property_text_;
+  // Keeps the net values it looked up between traces.
+  std::optional<XTracer> x_tracer_;
   bool unicode_ = true;
   int time_unit_ = -9; // nanoseconds.
   bool leading_zeroes_ = true;
@@ -1,4 +1,6 @@
 #include "workspace.h"
+#include "absl/hash/hash.h"
+#include "absl/strings/str_format.h"
 #include "slang/analysis/AnalysisManager.h"
 #include "slang/ast/ASTVisitor.h"
 #include "slang/ast/Compilation.h"
@@ -8,15 +10,91 @@
 #include "slang/ast/symbols/MemberSymbols.h"
 #include "slang/ast/symbols/VariableSymbols.h"
 #include "slang/driver/Driver.h"
+#include "slang/syntax/SyntaxTree.h"
+#include "slang/text/SourceManager.h"
+#include "parallel.h"
 #include "slang_utils.h"
+#include "utils.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
 #include <iostream>
+#include <iterator>
 #include <memory>
 #include <stack>
+#include <thread>
 
 namespace sv {
 
+namespace {
+
+// Source manager buffers end with a null character that is not in the file itself.
+std::string_view SourceText(std::string_view text) {
+  if (!text.empty() && text.back() == '\0') text.remove_suffix(1);
+  return text;
+}
+
+// Threads that slang parses and analyzes with, as set with -j.
+int NumThreads(const slang::driver::Driver &driver) {
+  const int n = driver.options.numThreads.value_or(0);
+  return n > 0 ? n : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Limits on the scopes considered when matching the design with the waves.
+constexpr int kMaxMatchDepth = 8;
+constexpr size_t kMaxMatchScopes = 20000;
+constexpr size_t kMaxScopesPerName = 256;
+
+// Times a file is parsed again on its own before a full parse starts over with a new source
+// manager, which drops the buffers of the earlier versions.
+constexpr int kMaxReParsesPerFile = 4;
+
+// Options that simview adds to slang's.
+struct CommandLineOptions {
+  std::optional<bool> show_help;
+  std::optional<std::string> waves_file;
+  std::optional<std::string> list_file;
+  std::optional<bool> keep_glitches;
+  std::optional<std::string> golden_file;
+  std::optional<std::string> activity_report;
+  std::optional<uint64_t> report_start;
+  std::optional<uint64_t> report_end;
+  std::optional<uint32_t> report_memory;
+  std::optional<bool> analyze;
+};
+
+void AddCommandLineOptions(slang::driver::Driver *driver, CommandLineOptions *options) {
+  driver->cmdLine.add("-h,--help", options->show_help, "Display available options");
+  driver->cmdLine.add("-w,--waves", options->waves_file,
+                      "Waves file to load. Supported formats are FST and VCD.");
+  driver->cmdLine.add("--list", options->list_file, "Wave listing file to restore");
+  driver->cmdLine.add("--keep_glitches", options->keep_glitches,
+                      "Retain 0-time transitions in the wave data. Normally pruned.");
+  driver->cmdLine.add("--golden", options->golden_file,
+                      "Reference waves file to compare the waves against.", "<file>");
+  driver->cmdLine.add("--activity-report", options->activity_report,
+                      "Write the toggle counts of all signals and scopes in the waves to "
+                      "this file (- for stdout), instead of starting the UI.",
+                      "<file>");
+  driver->cmdLine.add("--report-start", options->report_start,
+                      "Start of the report time window, in wave time units.", "<time>");
+  driver->cmdLine.add("--report-end", options->report_end,
+                      "End of the report time window, in wave time units.", "<time>");
+  driver->cmdLine.add("--report-memory", options->report_memory,
+                      "Approximate memory limit for report wave data, in MB.", "<MB>");
+
+  driver->cmdLine.add("--analyze", options->analyze,
+                      "Run slang's analysis of the elaborated design, such as checks for "
+                      "multiple drivers. Uses as many threads as parsing (-j).");
+}
+
+} // namespace
+
 Workspace::Workspace() = default;
 Workspace::~Workspace() = default;
 
@@ -24,7 +102,25 @@ const slang::SourceManager *Workspace::SourceManager() const {
   return slang_compilation_->getSourceManager();
 }
 
+const DriverLoadIndex *Workspace::DriverLoads() const {
+  if (driver_load_index_ == nullptr && driver_load_future_.valid() &&
+      driver_load_future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    driver_load_index_ = driver_load_future_.get();
+  }
+  return driver_load_index_.get();
+}
+
 bool Workspace::ReParse() {
+  // The index is built from the old design, so it has to be done before that goes away.
+  if (driver_load_future_.valid()) driver_load_future_.wait();
+  driver_load_future_ = {};
+  driver_load_index_ = nullptr;
+  // The design scopes go away, the index is built again once the new design is matched.
+  signal_index_ = {};
+  if (slang_compilation_ != nullptr) {
+    if (const std::optional<bool> success = ReParseChanged()) return *success;
+  }
+  slang_analysis_ = nullptr;
   slang_compilation_ = nullptr;
   design_root_ = nullptr;
   const bool parse_ok = ParseDesign(/*initial*/ false);
@@ -32,6 +128,158 @@ bool Workspace::ReParse() {
   return parse_ok && success;
 }
 
+void Workspace::Elaborate(bool initial, PhaseTimer *timer) {
+  slang_compilation_ = slang_driver_->createCompilation();
+  // This print all tops, and collects diagnostics.
+  slang_driver_->reportCompilation(*slang_compilation_, /* quiet */ !initial);
+  timer->Finish("elaborate");
+  if (run_analysis_) {
+    // Checks such as multiple drivers, spread over the same threads as the parsing.
+    slang_analysis_ = slang_driver_->runAnalysis(*slang_compilation_);
+    timer->Finish("analyze");
+  }
+  if (initial) {
+    const bool success = slang_driver_->reportDiagnostics(/* quiet */ !initial);
+    timer->Finish("report");
+    // Give the user a chance to see any errors before proceeding. The wait isn't timed.
+    if (!success) {
+      std::cout << "Errors encountered, press Enter to continue anyway...\n";
+      std::cin.get();
+      timer->Restart();
+    }
+  }
+  design_root_ = &slang_compilation_->getRoot();
+  // Binds whatever is still lazy and freezes the compilation, as the analysis does, so that the
+  // index can visit the design on another thread while the UI keeps reading it.
+  slang_compilation_->getAllDiagnostics();
+  if (!slang_compilation_->isFrozen()) slang_compilation_->freeze();
+  driver_load_future_ = std::async(std::launch::async, [root = design_root_] {
+    return DriverLoadIndex::Build(*root);
+  });
+  timer->Finish("bind");
+}
+
+std::string_view Workspace::FileName(slang::SourceLocation loc) const {
+  const std::string_view name = SourceManager()->getFileName(loc);
+  const auto it = reparse_aliases_.find(name);
+  return it == reparse_aliases_.end() ? name : it->second;
+}
+
+std::optional<absl::flat_hash_set<std::string>> Workspace::CommandLineFiles() const {
+  // The driver that parsed the design has used up its list of files, so this one reads them again.
+  slang::driver::Driver driver;
+  CommandLineOptions options;
+  AddCommandLineOptions(&driver, &options);
+  driver.addStandardArgs();
+  if (!driver.parseCommandLine(command_line_.argc, command_line_.argv) ||
+      !driver.processOptions()) {
+    return std::nullopt;
+  }
+  absl::flat_hash_set<std::string> files;
+  for (const slang::SourceBuffer &buffer : driver.sourceLoader.loadSources()) {
+    files.insert(driver.sourceManager.getFullPath(buffer.id).lexically_normal().string());
+  }
+  return files;
+}
+
+void Workspace::RecordSourceHashes() {
+  source_hashes_.clear();
+  const slang::SourceManager &sm = slang_driver_->sourceManager;
+  const auto record = [&](slang::BufferID id) {
+    source_hashes_[sm.getFullPath(id).lexically_normal().string()] =
+        absl::HashOf(SourceText(sm.getSourceText(id)));
+  };
+  for (const auto &tree : slang_driver_->syntaxTrees) {
+    for (const slang::BufferID id : tree->getSourceBufferIds()) record(id);
+    for (const auto &include : tree->getIncludeDirectives()) record(include.buffer.id);
+  }
+}
+
+std::optional<bool> Workspace::ReParseChanged() {
+  PhaseTimer timer;
+  slang::SourceManager &sm = slang_driver_->sourceManager;
+  auto &trees = slang_driver_->syntaxTrees;
+  // Files added to or removed from the command line, or the lists it reads with -f, need the full
+  // parse to be picked up.
+  const auto files = CommandLineFiles();
+  if (!files || *files != command_line_files_) return std::nullopt;
+  // Files whose contents are no longer what was parsed.
+  absl::flat_hash_map<std::string, std::string> changed;
+  // Files that can't be read are left to the full parse, which reports them.
+  bool unreadable = false;
+  const auto check = [&](slang::BufferID id) {
+    const std::string path = sm.getFullPath(id).lexically_normal().string();
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      unreadable = true;
+      return true;
+    }
+    std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const auto it = source_hashes_.find(path);
+    if (it == source_hashes_.end() || it->second != absl::HashOf(SourceText(text))) {
+      changed.emplace(path, std::move(text));
+      return true;
+    }
+    return false;
+  };
+  std::vector<int> to_parse;
+  for (int i = 0; i < trees.size(); ++i) {
+    // Macros and includes make a file depend on more than its own text. Those cases get a full
+    // parse, which redoes all of the preprocessing.
+    const auto buffers = trees[i]->getSourceBufferIds();
+    if (buffers.size() != 1) return std::nullopt;
+    for (const auto &include : trees[i]->getIncludeDirectives()) {
+      if (check(include.buffer.id)) return std::nullopt;
+    }
+    if (!check(buffers[0])) continue;
+    const std::string path = sm.getFullPath(buffers[0]).lexically_normal().string();
+    if (unreadable || reparse_counts_[path] == kMaxReParsesPerFile) return std::nullopt;
+    to_parse.push_back(i);
+  }
+  timer.Finish("check");
+  const slang::Bag options = slang_driver_->createOptionBag();
+  std::vector<slang::SourceBuffer> buffers(to_parse.size());
+  for (int j = 0; j < to_parse.size(); ++j) {
+    const int i = to_parse[j];
+    const std::filesystem::path path = sm.getFullPath(trees[i]->getSourceBufferIds()[0]);
+    const std::string normal_path = path.lexically_normal().string();
+    // The source manager keeps the buffer of every path, so the new text needs a path it has not
+    // seen yet. Extra "." components still name the same file, and there are only a few of them
+    // before the full parse starts over.
+    std::filesystem::path alias = path.lexically_normal().parent_path();
+    for (int n = ++reparse_counts_[normal_path]; n > 0; --n) alias /= ".";
+    alias /= path.filename();
+    // File names are shown as the first parse saw them.
+    const std::string_view name = sm.getRawFileName(trees[i]->getSourceBufferIds()[0]);
+    const auto it = reparse_aliases_.find(name);
+    const std::string first_name = it == reparse_aliases_.end() ? std::string(name) : it->second;
+    reparse_aliases_[alias.string()] = first_name;
+    buffers[j] = sm.assignText(alias.string(), changed[normal_path]);
+  }
+  // The source manager can be shared between threads, which is how slang parses in parallel too.
+  if (to_parse.size() > 1) {
+    WorkerPool pool(std::min<int>(NumThreads(*slang_driver_), to_parse.size()));
+    for (int j = 0; j < to_parse.size(); ++j) {
+      pool.Submit([&, j] {
+        trees[to_parse[j]] = slang::syntax::SyntaxTree::fromBuffer(buffers[j], sm, options);
+      });
+    }
+    pool.Wait();
+  } else if (!to_parse.empty()) {
+    trees[to_parse[0]] = slang::syntax::SyntaxTree::fromBuffer(buffers[0], sm, options);
+  }
+  timer.Finish(absl::StrFormat("parse %d of %d files", to_parse.size(), trees.size()));
+  slang_analysis_ = nullptr;
+  slang_compilation_ = nullptr;
+  design_root_ = nullptr;
+  slang_driver_->diagEngine.clearCounts();
+  Elaborate(/*initial*/ false, &timer);
+  RecordSourceHashes();
+  timer.Finish("hash");
+  design_timings_ = timer.Report(/*all_cpu*/ true);
+  return slang_driver_->diagEngine.getNumErrors() == 0;
+}
+
 bool Workspace::ParseDesign(int argc, char *argv[]) {
   command_line_.argc = argc;
   command_line_.argv = argv;
@@ -40,63 +288,80 @@ bool Workspace::ParseDesign(int argc, char *argv[]) {
 
 bool Workspace::ParseDesign(bool initial) {
   slang_driver_ = std::make_unique<slang::driver::Driver>();
-  // Additional options from simview:
-  std::optional<bool> show_help;
-  std::optional<std::string> waves_file;
-  std::optional<std::string> list_file;
-  std::optional<bool> keep_glitches;
-  slang_driver_->cmdLine.add("-h,--help", show_help, "Display available options");
-  slang_driver_->cmdLine.add("-w,--waves", waves_file,
-                             "Waves file to load. Supported formats are FST and VCD.");
-  slang_driver_->cmdLine.add("--list", list_file, "Wave listing file to restore");
-  slang_driver_->cmdLine.add("--keep_glitches", keep_glitches,
-                             "Retain 0-time transitions in the wave data. Normally pruned.");
-
+  // The new source manager has none of the earlier paths.
+  reparse_counts_.clear();
+  reparse_aliases_.clear();
+  CommandLineOptions options;
+  AddCommandLineOptions(slang_driver_.get(), &options);
   slang_driver_->addStandardArgs();
   if (!slang_driver_->parseCommandLine(command_line_.argc, command_line_.argv)) return false;
-  if (show_help == true && initial) {
+  if (options.show_help == true && initial) {
     std::cout << slang_driver_->cmdLine.getHelpText(
                      "simview: a terminal-based verilog design browser and waves viewer.")
               << "\n";
     return 0;
   }
   // Anytime there are more arguments besides the wave ones, try to read the design.
-  const bool has_design_args = command_line_.argc - 1 > (waves_file.has_value() ? 2 : 0) +
-                                                            (list_file.has_value() ? 2 : 0) +
-                                                            (keep_glitches.has_value() ? 1 : 0);
+  const bool has_design_args =
+      command_line_.argc - 1 >
+      (options.waves_file.has_value() ? 2 : 0) + (options.list_file.has_value() ? 2 : 0) +
+          (options.keep_glitches.has_value() ? 1 : 0) +
+          (options.golden_file.has_value() ? 2 : 0) +
+          (options.activity_report.has_value() ? 2 : 0) +
+          (options.report_start.has_value() ? 2 : 0) + (options.report_end.has_value() ? 2 : 0) +
+          (options.report_memory.has_value() ? 2 : 0) + (options.analyze.has_value() ? 1 : 0);
+  run_analysis_ = options.analyze.value_or(false);
 
   bool design_ok = false;
   if (has_design_args && slang_driver_->processOptions()) {
-    if (initial) std::cout << "Parsing files...\n";
+    PhaseTimer timer;
+    const int num_threads = NumThreads(*slang_driver_);
+    if (initial) std::cout << "Parsing files on " << num_threads << " threads...\n";
+    // Files are spread over the threads, when there are enough of them.
     if (!slang_driver_->parseAllSources()) return false;
+    timer.Finish(absl::StrFormat("parse %d files", slang_driver_->syntaxTrees.size()));
     if (initial) std::cout << "Elaborating...\n";
-    slang_compilation_ = slang_driver_->createCompilation();
-    // This print all tops, and collects diagnostics.
-    slang_driver_->reportCompilation(*slang_compilation_, /* quiet */ !initial);
-    if (initial) {
-      const bool success = slang_driver_->reportDiagnostics(/* quiet */ !initial);
-      // Give the user a chance to see any errors before proceeding.
-      if (!success) {
-        std::cout << "Errors encountered, press Enter to continue anyway...\n";
-        std::cin.get();
-      }
-    }
-    design_root_ = &slang_compilation_->getRoot();
+    Elaborate(initial, &timer);
+    RecordSourceHashes();
+    timer.Finish("hash");
+    command_line_files_ = CommandLineFiles().value_or(absl::flat_hash_set<std::string>());
+    timer.Finish("files");
+    design_timings_ = timer.Report(/*all_cpu*/ true);
+    if (initial) std::cout << "Design: " << design_timings_ << "\n";
     design_ok = true;
   }
 
+  if (initial && options.activity_report && !options.waves_file) {
+    std::cout << "--activity-report needs a waves file.\n";
+    return false;
+  }
   bool waves_ok = false;
   // Waves are only read on initial load. There's a separate mechanism that triggers wave reload.
-  if (initial && waves_file) {
+  if (initial && options.waves_file) {
     absl::StatusOr<std::unique_ptr<WaveData>> waves_or =
-        WaveData::ReadWaveFile(*waves_file, keep_glitches.value_or(false));
+        WaveData::ReadWaveFile(*options.waves_file, options.keep_glitches.value_or(false));
     if (!waves_or.ok()) {
       std::cout << "Problem reading waves: " << waves_or.status().message() << "\n";
       return false;
     }
     wave_data_ = std::move(*waves_or);
-    startup_waves_list_ = list_file.value_or("");
+    // The UI is not up yet, so this can still go to the terminal.
+    if (!wave_data_->OpenTimings().empty()) {
+      std::cout << "Opened " << *options.waves_file << ": " << wave_data_->OpenTimings() << "\n";
+    }
+    startup_waves_list_ = options.list_file.value_or("");
+    golden_file_ = options.golden_file.value_or("");
+    keep_glitches_ = options.keep_glitches.value_or(false);
     waves_ok = true;
+    if (options.activity_report) {
+      headless_report_.emplace();
+      headless_report_->output_file = *options.activity_report;
+      headless_report_->start_time = options.report_start;
+      headless_report_->end_time = options.report_end;
+      if (options.report_memory) {
+        headless_report_->memory_budget = size_t{*options.report_memory} << 20;
+      }
+    }
     // Try to match the two up.
     sv::Workspace::Get().TryMatchDesignWithWaves();
   }
@@ -104,134 +369,206 @@ bool Workspace::ParseDesign(bool initial) {
   return design_ok || waves_ok;
 }
 
+absl::Status Workspace::LoadGoldenWaves(const std::string &file_name) {
+  // Golden waves don't change, so they are only read once.
+  if (golden_data_ != nullptr && file_name == golden_file_) return absl::OkStatus();
+  absl::StatusOr<std::unique_ptr<WaveData>> golden_or =
+      WaveData::ReadWaveFile(file_name, keep_glitches_);
+  if (!golden_or.ok()) return golden_or.status();
+  golden_data_ = std::move(*golden_or);
+  golden_file_ = file_name;
+  return absl::OkStatus();
+}
+
 void Workspace::TryMatchDesignWithWaves() {
   // Don't do anything unless there are both waves and design.
   if (wave_data_ == nullptr || design_root_ == nullptr) return;
   // Reset initial to unmatched, to avoid stale pointers after wave-reload.
   matched_design_scope_ = nullptr;
   matched_signal_scope_ = nullptr;
-  // Look for a scope with stuff in it, go 3 levels in.
+  // Gather candidate scopes on both sides breadth first, so that the shallow ones are seen first
+  // and win ties. Deep hierarchies are cut off by depth and count, since loading wave scopes can be
+  // slow.
   std::vector<const WaveData::SignalScope *> signal_scopes;
+  std::deque<std::pair<const WaveData::SignalScope *, int>> signal_queue;
   for (const WaveData::SignalScope &root_scope : wave_data_->Roots()) {
-    signal_scopes.push_back(&root_scope);
-    for (const WaveData::SignalScope &sub : root_scope.children) {
-      signal_scopes.push_back(&sub);
-      for (const WaveData::SignalScope &subsub : sub.children) {
-        signal_scopes.push_back(&subsub);
-      }
+    signal_queue.push_back({&root_scope, 0});
+  }
+  while (!signal_queue.empty() && signal_scopes.size() < kMaxMatchScopes) {
+    const auto [scope, depth] = signal_queue.front();
+    signal_queue.pop_front();
+    wave_data_->LoadScope(scope);
+    signal_scopes.push_back(scope);
+    if (depth == kMaxMatchDepth) continue;
+    for (const WaveData::SignalScope &sub : scope->children) {
+      signal_queue.push_back({&sub, depth + 1});
     }
   }
-  // Okay, good enough. Now try to build a list of design scopes that aren't too far from the top.
   std::vector<const slang::ast::Scope *> design_scopes;
-  int depth = 0;
+  std::deque<std::pair<const slang::ast::Scope *, int>> design_queue;
   for (const slang::ast::InstanceSymbol *top : design_root_->topInstances) {
-    design_scopes.push_back(&top->body);
-    top->visit(slang::ast::makeVisitor(
-        [&](auto &visitor, const slang::ast::InstanceSymbol &inst) {
-          design_scopes.push_back(&inst.body);
-          if (depth < 3) {
-            depth++;
-            visitor.visitDefault(inst);
-            depth--;
-          }
-        },
-        [&](auto &visitor, const slang::ast::GenerateBlockSymbol &gen) {
-          design_scopes.push_back(&gen);
-          if (depth < 3) {
-            depth++;
-            visitor.visitDefault(gen);
-            depth--;
-          }
-        }));
+    design_queue.push_back({&top->body, 0});
   }
-
-  // Try to match the two candidate scopes against each other by looking for
-  // matching signals.
-  int max_common = 0;
-  // Default scope is just the first root.
-  if (!wave_data_->Roots().empty()) matched_signal_scope_ = &wave_data_->Roots()[0];
-  for (const slang::ast::Scope *design_scope : design_scopes) {
-    for (const WaveData::SignalScope *signal_scope : signal_scopes) {
-      if (signal_scope->signals.empty()) continue;
-      int num_common_signals = 0;
-      for (const auto &net : design_scope->membersOfType<slang::ast::NetSymbol>()) {
-        for (const auto &s : signal_scope->signals) {
-          if (net.name == s.name) {
-            num_common_signals++;
-          }
+  while (!design_queue.empty() && design_scopes.size() < kMaxMatchScopes) {
+    const slang::ast::Scope *scope = design_queue.front().first;
+    const int depth = design_queue.front().second;
+    design_queue.pop_front();
+    design_scopes.push_back(scope);
+    if (depth == kMaxMatchDepth) continue;
+    const auto add_instance = [&](auto &self, const slang::ast::Symbol *sym) -> void {
+      if (const auto *inst = sym->as_if<slang::ast::InstanceSymbol>()) {
+        design_queue.push_back({&inst->body, depth + 1});
+      } else if (const auto *array = sym->as_if<slang::ast::InstanceArraySymbol>()) {
+        for (const slang::ast::Symbol *element : array->elements) self(self, element);
+      }
+    };
+    for (const slang::ast::Symbol &member : scope->members()) {
+      if (const auto *gen = member.as_if<slang::ast::GenerateBlockSymbol>()) {
+        if (!gen->isUninstantiated) design_queue.push_back({gen, depth + 1});
+      } else if (const auto *array = member.as_if<slang::ast::GenerateBlockArraySymbol>()) {
+        for (const slang::ast::GenerateBlockSymbol *entry : array->entries) {
+          if (!entry->isUninstantiated) design_queue.push_back({entry, depth + 1});
         }
+      } else {
+        add_instance(add_instance, &member);
       }
-      for (const auto &var : design_scope->membersOfType<slang::ast::VariableSymbol>()) {
-        for (const auto &s : signal_scope->signals) {
-          if (var.name == s.name) {
-            num_common_signals++;
-          }
+    }
+  }
+
+  // Wave scopes that have each signal name, without array suffixes. Names that are in a lot of
+  // scopes, like clocks and resets, say little about which scope matches and would make up most of
+  // the scoring time, so they are left out.
+  absl::flat_hash_map<std::string_view, std::vector<int>> scopes_with_name;
+  for (int i = 0; i < signal_scopes.size(); ++i) {
+    for (const WaveData::Signal &s : signal_scopes[i]->signals) {
+      const std::string_view name = std::string_view(s.name).substr(0, s.name.find_first_of(" ["));
+      auto &scopes = scopes_with_name[name];
+      if (scopes.empty() || scopes.back() != i) scopes.push_back(i);
+    }
+  }
+  for (auto it = scopes_with_name.begin(); it != scopes_with_name.end();) {
+    if (it->second.size() > kMaxScopesPerName) {
+      scopes_with_name.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+
+  // Score every pair by the number of design nets and variables that have a signal of the same
+  // name, for a chunk of the design scopes at a time. Ties go to the first pair.
+  struct Match {
+    int score = 0;
+    int design_idx = -1;
+    int signal_idx = -1;
+  };
+  std::vector<Match> best(std::max(1u, std::thread::hardware_concurrency()));
+  ParallelChunks(design_scopes.size(), 64, [&](int chunk, size_t begin, size_t end) {
+    std::vector<int> counts(signal_scopes.size());
+    std::vector<int> touched;
+    Match &chunk_best = best[chunk];
+    for (size_t d = begin; d < end; ++d) {
+      const auto count = [&](std::string_view name) {
+        const auto it = scopes_with_name.find(name);
+        if (it == scopes_with_name.end()) return;
+        for (const int s : it->second) {
+          if (counts[s]++ == 0) touched.push_back(s);
         }
+      };
+      for (const auto &net : design_scopes[d]->membersOfType<slang::ast::NetSymbol>()) {
+        count(net.name);
+      }
+      for (const auto &var : design_scopes[d]->membersOfType<slang::ast::VariableSymbol>()) {
+        count(var.name);
       }
-      // Save the best result.
-      if (num_common_signals > max_common) {
-        max_common = num_common_signals;
-        matched_design_scope_ = design_scope;
-        matched_signal_scope_ = signal_scope;
+      std::sort(touched.begin(), touched.end());
+      for (const int s : touched) {
+        if (counts[s] > chunk_best.score) {
+          chunk_best = {.score = counts[s], .design_idx = static_cast<int>(d), .signal_idx = s};
+        }
+        counts[s] = 0;
       }
+      touched.clear();
     }
+  });
+  // Default scope is just the first root.
+  if (!wave_data_->Roots().empty()) matched_signal_scope_ = &wave_data_->Roots()[0];
+  // Chunks are in design scope order, so the first best one wins ties here too.
+  Match match;
+  for (const Match &m : best) {
+    if (m.score > match.score) match = m;
+  }
+  if (match.score > 0) {
+    matched_design_scope_ = design_scopes[match.design_idx];
+    matched_signal_scope_ = signal_scopes[match.signal_idx];
   }
+  signal_index_ = {};
 }
 
-std::vector<const WaveData::Signal *>
-Workspace::DesignToSignals(const slang::ast::Symbol *item) const {
-  if (matched_signal_scope_ == nullptr) return {};
-  std::vector<const WaveData::Signal *> signals;
-  // Make sure it's actually something that would have ended up in a wave.
-  if (!IsTraceable(item)) return signals;
-  // Build a stack of all parents up to the top module, or the matched design scope, whichever comes
-  // first.
-  std::stack<const slang::ast::Scope *> stack;
-  const slang::ast::Scope *parent = item->getParentScope();
-  while (parent != nullptr) {
-    if (parent == matched_design_scope_) break;
-    stack.push(parent);
-    parent = parent->asSymbol().getHierarchicalParent();
+void Workspace::IndexSignals(const WaveData::SignalScope *signal_scope) const {
+  if (!signal_index_.indexed.insert(signal_scope).second) return;
+  wave_data_->LoadScope(signal_scope);
+  for (const WaveData::Signal &signal : signal_scope->signals) {
+    signal_index_.signals[{signal_scope, signal.name}].push_back(&signal);
+    const size_t suffix = signal.name.find_first_of(" [");
+    if (suffix == std::string::npos || suffix == 0) continue;
+    const std::string_view name = std::string_view(signal.name).substr(0, suffix);
+    signal_index_.signals[{signal_scope, name}].push_back(&signal);
   }
+}
 
-  const WaveData::SignalScope *signal_scope = matched_signal_scope_;
-  while (!stack.empty()) {
-    const slang::ast::Scope *design_scope = stack.top();
+const WaveData::SignalScope *
+Workspace::FindSignalScope(const slang::ast::Scope *design_scope) const {
+  // Scopes above the matched one are walked down from the matched wave scope as well, which only
+  // works out when the names happen to line up.
+  if (design_scope == nullptr || design_scope == matched_design_scope_) {
+    return matched_signal_scope_;
+  }
+  if (const auto it = signal_index_.scopes.find(design_scope); it != signal_index_.scopes.end()) {
+    return it->second;
+  }
+  // Found a step at a time down from the parent, and kept for the next lookup.
+  const WaveData::SignalScope *found = nullptr;
+  // Generate blocks that were not instantiated have nothing in the waves.
+  const auto *gen = design_scope->asSymbol().as_if<slang::ast::GenerateBlockSymbol>();
+  const WaveData::SignalScope *signal_scope =
+      gen != nullptr && gen->isUninstantiated
+          ? nullptr
+          : FindSignalScope(design_scope->asSymbol().getHierarchicalParent());
+  if (signal_scope != nullptr) {
     std::string_view scope_name;
     if (const auto *body = design_scope->asSymbol().as_if<slang::ast::InstanceBodySymbol>()) {
       scope_name = body->parentInstance->name;
     } else {
       scope_name = design_scope->asSymbol().name;
     }
-    bool found = false;
+    wave_data_->LoadScope(signal_scope);
     if (scope_name == signal_scope->name) {
-      found = true;
+      found = signal_scope;
     } else {
       for (const WaveData::SignalScope &sub : signal_scope->children) {
         if (scope_name == sub.name) {
-          signal_scope = &sub;
-          found = true;
+          found = &sub;
           break;
         }
       }
     }
-    // Total abort if there is no matching scope in the wave data.
-    if (!found) return signals;
-    stack.pop();
-  }
-  // Now add any signals in the drilled-down scope that match the net name exactly, with optional
-  // square bracket suffixes.
-  for (const auto &signal : signal_scope->signals) {
-    auto pos = signal.name.find(item->name);
-    if (pos != 0) continue;
-    // If the next character starts an array index, accept it. Otherwise move on.
-    if (signal.name.size() > item->name.size() &&
-        signal.name.find_first_of(" [", item->name.size()) != item->name.size()) {
-      continue;
-    }
-    signals.push_back(&signal);
   }
+  signal_index_.scopes[design_scope] = found;
+  return found;
+}
 
+std::vector<const WaveData::Signal *>
+Workspace::DesignToSignals(const slang::ast::Symbol *item) const {
+  if (matched_signal_scope_ == nullptr) return {};
+  std::vector<const WaveData::Signal *> signals;
+  // Make sure it's actually something that would have ended up in a wave.
+  if (!IsTraceable(item)) return signals;
+  const WaveData::SignalScope *signal_scope = FindSignalScope(item->getParentScope());
+  // Total abort if there is no matching scope in the wave data.
+  if (signal_scope == nullptr) return signals;
+  IndexSignals(signal_scope);
+  const auto it = signal_index_.signals.find({signal_scope, item->name});
+  if (it != signal_index_.signals.end()) signals = it->second;
   return signals;
 }
 
@@ -304,11 +641,13 @@ const slang::ast::Symbol *Workspace::SignalToDesign(const WaveData::Signal *sign
 
 void Workspace::SetMatchedDesignScope(const slang::ast::Scope *s) {
   matched_design_scope_ = s;
+  signal_index_ = {};
   // ApplyDesignData(matched_design_scope_, matched_signal_scope_);
 }
 
 void Workspace::SetMatchedSignalScope(const WaveData::SignalScope *s) {
   matched_signal_scope_ = s;
+  signal_index_ = {};
   // ApplyDesignData(matched_design_scope_, matched_signal_scope_);
 }
 
@@ -1,11 +1,21 @@
 #pragma once
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "batch_report.h"
 #include "wave_data.h"
 #include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 // Forward-declare slang types since otherwise the huge slang headers have to be pulled in.
 namespace slang {
+class SourceLocation;
 class SourceManager;
 namespace analysis {
 class AnalysisManager;
@@ -23,6 +33,9 @@ class RootSymbol;
 
 namespace sv {
 
+class DriverLoadIndex;
+class PhaseTimer;
+
 // Holds the application-level global data, namely the slang design and / or the wave file.
 class Workspace {
  public:
@@ -40,14 +53,26 @@ class Workspace {
 
   // Find the definition of the module that contains the given item.
   uint64_t &WaveCursorTime() { return wave_cursor_time_; }
+  // Time range selected in the waves panel, for other panels that work over a window of time. Set
+  // whenever the waves panel draws.
+  std::optional<std::pair<uint64_t, uint64_t>> &WaveTimeWindow() { return wave_time_window_; }
 
   const slang::SourceManager *SourceManager() const;
+  // Name of the file of a location, as it was named when first parsed. Files that are parsed again
+  // on their own get a different spelling of their path, see ReParseChanged.
+  std::string_view FileName(slang::SourceLocation loc) const;
 
   const WaveData *Waves() const { return wave_data_.get(); }
 
   // Non-const version allows for reload.
   WaveData *Waves() { return wave_data_.get(); }
 
+  // Reference waves to compare against, null until loaded. The file name from the command line is
+  // kept as the default.
+  const WaveData *GoldenWaves() const { return golden_data_.get(); }
+  const std::string &GoldenFile() const { return golden_file_; }
+  absl::Status LoadGoldenWaves(const std::string &file_name);
+
   void TryMatchDesignWithWaves();
 
   const slang::ast::Scope *MatchedDesignScope() const { return matched_design_scope_; }
@@ -60,32 +85,86 @@ class Workspace {
 
   const std::string& StartupWavesList() const { return startup_waves_list_; }
 
-  // Design nets/variables could map to multiple signals if the waves contain unrolled arrays.
+  // Set when a report was requested on the command line, to be run instead of the UI.
+  const std::optional<ReportOptions> &HeadlessReport() const { return headless_report_; }
+
+  // Design nets/variables could map to multiple signals if the waves contain unrolled arrays. This
+  // is a hash lookup, after the first one in each scope.
   std::vector<const WaveData::Signal *> DesignToSignals(const slang::ast::Symbol *item) const;
 
   const slang::ast::Symbol *SignalToDesign(const WaveData::Signal *signal) const;
 
+  // Wall and CPU time of each phase of the last design parse, such as
+  // "parse 2 of 130 files 85.3ms (cpu 250.2ms)".
+  const std::string &DesignTimings() const { return design_timings_; }
+
+  // Drivers and loads of the whole design, built in the background after elaboration. Null until
+  // it is ready.
+  const DriverLoadIndex *DriverLoads() const;
+
  private:
   // Singleton
   Workspace();
   ~Workspace();
 
   bool ParseDesign(bool initial);
+  // Creates the compilation from the driver's syntax trees, runs the analysis if requested, and
+  // starts indexing it. Each of those is timed as a phase, and so is reporting the diagnostics.
+  void Elaborate(bool initial, PhaseTimer *timer);
+  // Parses only the files that changed since the last parse, reusing the syntax trees of the rest.
+  // Returns nullopt when that is not possible, such as when files were added or removed, an
+  // included file changed or a file can't be read.
+  std::optional<bool> ReParseChanged();
+  // Normalized paths of the source files the command line names, or nullopt if it doesn't parse.
+  std::optional<absl::flat_hash_set<std::string>> CommandLineFiles() const;
+  void RecordSourceHashes();
+  // Indexes the signals of a wave scope by name for DesignToSignals, the first time it is asked.
+  void IndexSignals(const WaveData::SignalScope *signal_scope) const;
+  // Wave scope that corresponds to a design scope, or null. Kept in the index once found, so the
+  // wave hierarchy is only read as far as the design is looked at.
+  const WaveData::SignalScope *FindSignalScope(const slang::ast::Scope *scope) const;
 
   std::unique_ptr<slang::driver::Driver> slang_driver_;
   std::unique_ptr<slang::ast::Compilation> slang_compilation_;
   std::unique_ptr<slang::analysis::AnalysisManager> slang_analysis_;
+  bool run_analysis_ = false;
   const slang::ast::RootSymbol *design_root_;
+  mutable std::future<std::unique_ptr<DriverLoadIndex>> driver_load_future_;
+  mutable std::unique_ptr<DriverLoadIndex> driver_load_index_;
   const slang::ast::Scope *matched_design_scope_ = nullptr;
   std::unique_ptr<WaveData> wave_data_;
+  std::unique_ptr<WaveData> golden_data_;
+  std::string golden_file_;
+  bool keep_glitches_ = false;
   const WaveData::SignalScope *matched_signal_scope_ = nullptr;
+  // Filled in by lookups, and cleared whenever the matched scopes change.
+  mutable struct {
+    absl::flat_hash_map<const slang::ast::Scope *, const WaveData::SignalScope *> scopes;
+    // Signals of the indexed wave scopes by name, and by name without the array suffix.
+    absl::flat_hash_set<const WaveData::SignalScope *> indexed;
+    absl::flat_hash_map<std::pair<const WaveData::SignalScope *, std::string_view>,
+                        std::vector<const WaveData::Signal *>>
+        signals;
+  } signal_index_;
   // Wave time is used in source too, so it's held here.
   uint64_t wave_cursor_time_ = 0;
+  std::optional<std::pair<uint64_t, uint64_t>> wave_time_window_;
   struct {
     int argc;
     char **argv;
   } command_line_;
   std::string startup_waves_list_;
+  std::optional<ReportOptions> headless_report_;
+  // Contents of every parsed file and include, by path, to find what changed on a reload.
+  absl::flat_hash_map<std::string, size_t> source_hashes_;
+  // How many times each file was parsed again since the last full parse, for a new spelling of its
+  // path.
+  absl::flat_hash_map<std::string, int> reparse_counts_;
+  // The paths given to files that were parsed again, mapped to the name they were first parsed as.
+  absl::flat_hash_map<std::string, std::string> reparse_aliases_;
+  // Source files that the command line named at the last full parse.
+  absl::flat_hash_set<std::string> command_line_files_;
+  std::string design_timings_;
 };
 
 } // namespace sv
@@ -0,0 +1,122 @@
+#include "x_trace.h"
+
+#include "absl/container/flat_hash_set.h"
+#include "slang_utils.h"
+#include "workspace.h"
+
+#include <algorithm>
+
+namespace sv {
+namespace {
+
+// Values at the traced time are read over this fraction of the time range around it, so that
+// tracing again nearby finds them loaded.
+constexpr int kValueWindowFraction = 1000;
+
+} // namespace
+
+void XTracer::LoadValues(const std::vector<const slang::ast::Symbol *> &nets, uint64_t time) {
+  const WaveData &waves = *Workspace::Get().Waves();
+  std::vector<const slang::ast::Symbol *> new_nets;
+  std::vector<const WaveData::Signal *> to_load;
+  for (const slang::ast::Symbol *n : nets) {
+    if (values_.contains({n, time})) continue;
+    const auto mapped = Workspace::Get().DesignToSignals(n);
+    new_nets.push_back(n);
+    values_[{n, time}].signal = mapped.empty() ? nullptr : mapped.front();
+    if (!mapped.empty()) to_load.push_back(mapped.front());
+  }
+  const auto [first, last] = waves.TimeRange();
+  const uint64_t span = std::max<uint64_t>(1, (last - first) / kValueWindowFraction);
+  const uint64_t at = std::clamp(time, first, last);
+  waves.LoadSignalWindow(to_load, at - std::min(at - first, span / 2), std::min(last, at + span / 2));
+  for (const slang::ast::Symbol *n : new_nets) {
+    Value &v = values_[{n, time}];
+    const int idx = v.signal == nullptr ? -1 : waves.FindSampleIndex(time, v.signal);
+    if (idx < 0) {
+      v.signal = nullptr;
+      continue;
+    }
+    v.unknown = waves.Wave(v.signal)[idx].value.find_first_of("xXzZ") != std::string::npos;
+  }
+}
+
+std::vector<XSource> XTracer::Trace(const slang::ast::Symbol *net, uint64_t time, int max_nets) {
+  // The cone is walked a level at a time, reading the values of each level at once. Only unknown
+  // nets, and those without waves, are expanded further.
+  absl::flat_hash_map<const slang::ast::Symbol *, std::vector<const slang::ast::Symbol *>> fanin;
+  absl::flat_hash_map<const slang::ast::Symbol *, int> depth = {{net, 0}};
+  std::vector<const slang::ast::Symbol *> level = {net};
+  while (!level.empty()) {
+    LoadValues(level, time);
+    std::vector<const slang::ast::Symbol *> next;
+    for (const slang::ast::Symbol *n : level) {
+      const Value &v = values_.at({n, time});
+      if (!v.unknown && v.signal != nullptr) continue;
+      for (const slang::ast::Symbol *input : fanin[n] = index_.FanIn(n)) {
+        if (depth.size() >= max_nets) break;
+        if (depth.emplace(input, depth[n] + 1).second) next.push_back(input);
+      }
+    }
+    level = std::move(next);
+  }
+  static const std::vector<const slang::ast::Symbol *> kNoInputs;
+  const auto inputs_of = [&](const slang::ast::Symbol *n) -> const auto & {
+    const auto it = fanin.find(n);
+    return it == fanin.end() ? kNoInputs : it->second;
+  };
+
+  // Whether unknown values reach the net from its fan-in. In-progress nets count as known, which
+  // ends loops.
+  absl::flat_hash_map<const slang::ast::Symbol *, bool> reached;
+  const auto unknown_input = [&](auto &self, const slang::ast::Symbol *n) -> bool {
+    if (const auto it = reached.find(n); it != reached.end()) return it->second;
+    reached[n] = false;
+    bool result = false;
+    for (const slang::ast::Symbol *input : inputs_of(n)) {
+      if (!depth.contains(input)) continue;
+      const Value &v = values_.at({input, time});
+      if (v.unknown || (v.signal == nullptr && self(self, input))) {
+        result = true;
+        break;
+      }
+    }
+    reached[n] = result;
+    return result;
+  };
+  // Follow the unknown (and unmapped) nets from the traced one.
+  std::vector<XSource> sources;
+  absl::flat_hash_set<const slang::ast::Symbol *> visited = {net};
+  std::vector<const slang::ast::Symbol *> stack = {net};
+  while (!stack.empty()) {
+    const slang::ast::Symbol *n = stack.back();
+    stack.pop_back();
+    const Value &v = values_.at({n, time});
+    if (v.unknown && !unknown_input(unknown_input, n)) {
+      sources.push_back({.net = n, .signal = v.signal, .since = time, .depth = depth[n]});
+    }
+    for (const slang::ast::Symbol *input : inputs_of(n)) {
+      if (!depth.contains(input) || visited.contains(input)) continue;
+      const Value &iv = values_.at({input, time});
+      if (iv.unknown || iv.signal == nullptr) {
+        visited.insert(input);
+        stack.push_back(input);
+      }
+    }
+  }
+  // Only the sources are read from the start, for the time at which their value started.
+  const WaveData &waves = *Workspace::Get().Waves();
+  std::vector<const WaveData::Signal *> source_signals;
+  for (const XSource &source : sources) source_signals.push_back(source.signal);
+  waves.LoadSignalWindow(source_signals, waves.TimeRange().first, time);
+  for (XSource &source : sources) {
+    const int idx = waves.FindSampleIndex(time, source.signal);
+    if (idx >= 0) source.since = waves.Wave(source.signal)[idx].time;
+  }
+  std::sort(sources.begin(), sources.end(), [](const XSource &a, const XSource &b) {
+    return a.since != b.since ? a.since < b.since : a.depth < b.depth;
+  });
+  return sources;
+}
+
+} // namespace sv
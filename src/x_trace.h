@@ -0,0 +1,52 @@
+#pragma once
+
+#include "absl/container/flat_hash_map.h"
+#include "wave_data.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace slang::ast {
+class Symbol;
+} // namespace slang::ast
+
+namespace sv {
+
+class DriverLoadIndex;
+
+// An unknown net found while walking back through the fan-in of another unknown net.
+struct XSource {
+  const slang::ast::Symbol *net;
+  const WaveData::Signal *signal;
+  // Start of the unknown value that the net has at the traced time.
+  uint64_t since;
+  // Fan-in levels away from the traced net.
+  int depth;
+};
+
+// Looks for where an unknown value comes from, by walking the fan-in cone of a net through the
+// design and checking the values of its nets in the waves. Values are cached per net and time, so
+// that tracing again around the same place is cheap.
+class XTracer {
+ public:
+  explicit XTracer(const DriverLoadIndex &index) : index_(index) {}
+  // Unknown nets in the cone that have no unknown nets in their own fan-in, which is where the X
+  // starts, earliest first. Only unknown nets are followed, and nets without waves are passed
+  // through. The cone is limited to max_nets nets. Their values are read a level at a time over a
+  // small window around the time, and only the sources are read back to where their value started.
+  std::vector<XSource> Trace(const slang::ast::Symbol *net, uint64_t time, int max_nets);
+  const DriverLoadIndex &Index() const { return index_; }
+
+ private:
+  struct Value {
+    const WaveData::Signal *signal = nullptr; // Null when the net is not in the waves.
+    bool unknown = false;
+  };
+  // Reads the values at the time of the nets that are not cached yet.
+  void LoadValues(const std::vector<const slang::ast::Symbol *> &nets, uint64_t time);
+  const DriverLoadIndex &index_;
+  absl::flat_hash_map<std::pair<const slang::ast::Symbol *, uint64_t>, Value> values_;
+};
+
+} // namespace sv